@@ -0,0 +1,882 @@
+#include "AabbTree.h"
+#include "CpuTracer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+AabbTree::AabbTree(float margin) : margin(margin) {}
+
+
+AabbTree::~AabbTree(){
+
+	if (rebuildJob) {
+		JobSystem::getDefault().wait(rebuildJob->counter);
+	}
+}
+
+
+uint32_t AabbTree::insert(const float min[3], const float max[3], uint32_t userData){
+
+	uint32_t proxy;
+
+	if (!freeProxies.empty()) {
+
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else {
+
+		proxy = static_cast<uint32_t>(proxyNodes.size());
+		proxyNodes.push_back(INVALID_NODE);
+	}
+
+
+	uint32_t leaf = allocateNode();
+	nodes[leaf].box = makeFatBox(min, max);
+	nodes[leaf].proxy = proxy;
+	nodes[leaf].userData = userData;
+
+	proxyNodes[proxy] = leaf;
+	insertLeaf(leaf);
+
+	objectCount++;
+	markChanged(proxy);
+
+	return proxy;
+}
+
+
+void AabbTree::remove(uint32_t proxy){
+
+	uint32_t leaf = proxyNodes[proxy];
+
+	removeLeaf(leaf);
+	freeNode(leaf);
+
+	proxyNodes[proxy] = INVALID_NODE;
+	freeProxies.push_back(proxy);
+
+	objectCount--;
+	markChanged(proxy);
+}
+
+
+bool AabbTree::move(uint32_t proxy, const float min[3], const float max[3]){
+
+	uint32_t leaf = proxyNodes[proxy];
+
+	Box box;
+
+	for (int axis = 0; axis < 3; axis++) {
+
+		box.min[axis] = min[axis];
+		box.max[axis] = max[axis];
+	}
+
+	if (contains(nodes[leaf].box, box)) {
+		return false;
+	}
+
+
+	removeLeaf(leaf);
+
+	nodes[leaf].box = makeFatBox(min, max);
+	insertLeaf(leaf);
+
+	markChanged(proxy);
+
+	return true;
+}
+
+
+void AabbTree::clear(){
+
+	if (rebuildJob) {
+
+		JobSystem::getDefault().wait(rebuildJob->counter);
+		rebuildJob.reset();
+	}
+
+	nodes.clear();
+	freeNodes.clear();
+	root = INVALID_NODE;
+
+	proxyNodes.clear();
+	freeProxies.clear();
+	objectCount = 0;
+
+	proxyChanged.clear();
+	changedProxies.clear();
+}
+
+
+void AabbTree::rebuild(){
+
+	TRACE_FUNCTION();
+
+	//The live tree already holds every edit, so a running rebuild has nothing left to contribute.
+	if (rebuildJob) {
+
+		JobSystem::getDefault().wait(rebuildJob->counter);
+		rebuildJob.reset();
+
+		proxyChanged.clear();
+		changedProxies.clear();
+	}
+
+	std::vector<Leaf> leaves = collectLeaves();
+
+	Tree tree;
+	build(leaves, static_cast<uint32_t>(proxyNodes.size()), tree);
+
+	nodes.swap(tree.nodes);
+	proxyNodes.swap(tree.proxyNodes);
+	freeNodes.clear();
+	root = tree.root;
+}
+
+
+void AabbTree::startRebuild(){
+
+	if (rebuildJob) {
+		return;
+	}
+
+	rebuildJob = std::make_unique<RebuildJob>();
+	rebuildJob->leaves = collectLeaves();
+	rebuildJob->proxyCount = static_cast<uint32_t>(proxyNodes.size());
+
+	proxyChanged.assign(proxyNodes.size(), 0);
+	changedProxies.clear();
+
+
+	//Only touches the job's own snapshot, so the live tree stays usable meanwhile.
+	RebuildJob* job = rebuildJob.get();
+
+	auto buildSnapshot = [job]() {
+
+		TRACE_ZONE("AabbTreeRebuild");
+
+		try {
+			build(job->leaves, job->proxyCount, job->tree);
+		}
+		catch (...) {
+			job->error = std::current_exception();
+		}
+	};
+
+	//A job on a single-threaded system only runs when someone waits, which update() never does.
+	if (JobSystem::getDefault().getThreadCount() > 1) {
+		JobSystem::getDefault().spawn(buildSnapshot, &job->counter);
+	}
+	else {
+		buildSnapshot();
+	}
+}
+
+
+bool AabbTree::update(){
+
+	if (!rebuildJob || !rebuildJob->counter.isDone()) {
+		return false;
+	}
+
+	std::unique_ptr<RebuildJob> job = std::move(rebuildJob);
+
+	if (job->error) {
+
+		proxyChanged.clear();
+		changedProxies.clear();
+
+		std::rethrow_exception(job->error);
+	}
+
+	swapIn(job->tree);
+
+	return true;
+}
+
+
+void AabbTree::swapIn(Tree& tree){
+
+	TRACE_FUNCTION();
+
+	//The current state of every proxy edited since the snapshot, taken before the live tree is replaced.
+	struct Replay {
+
+		uint32_t proxy;
+		bool alive;
+		Leaf leaf;
+	};
+
+	std::vector<Replay> replays;
+	replays.reserve(changedProxies.size());
+
+	for (uint32_t proxy : changedProxies) {
+
+		Replay replay{ proxy, proxyNodes[proxy] != INVALID_NODE, {} };
+
+		if (replay.alive) {
+
+			const Node& node = nodes[proxyNodes[proxy]];
+			replay.leaf = { node.box, proxy, node.userData };
+		}
+
+		replays.push_back(replay);
+	}
+
+
+	size_t proxyCount = proxyNodes.size();
+
+	nodes.swap(tree.nodes);
+	proxyNodes.swap(tree.proxyNodes);
+	freeNodes.clear();
+	root = tree.root;
+
+	//Proxies created after the snapshot have no leaf in the new tree yet.
+	proxyNodes.resize(proxyCount, INVALID_NODE);
+
+
+	for (const Replay& replay : replays) {
+
+		uint32_t snapshotLeaf = proxyNodes[replay.proxy];
+
+		if (snapshotLeaf != INVALID_NODE) {
+
+			removeLeaf(snapshotLeaf);
+			freeNode(snapshotLeaf);
+			proxyNodes[replay.proxy] = INVALID_NODE;
+		}
+
+		if (replay.alive) {
+
+			uint32_t leaf = allocateNode();
+			nodes[leaf].box = replay.leaf.box;
+			nodes[leaf].proxy = replay.proxy;
+			nodes[leaf].userData = replay.leaf.userData;
+
+			proxyNodes[replay.proxy] = leaf;
+			insertLeaf(leaf);
+		}
+	}
+
+	proxyChanged.clear();
+	changedProxies.clear();
+}
+
+
+void AabbTree::markChanged(uint32_t proxy){
+
+	if (!rebuildJob) {
+		return;
+	}
+
+	if (proxy >= proxyChanged.size()) {
+		proxyChanged.resize(proxy + 1, 0);
+	}
+
+	if (!proxyChanged[proxy]) {
+
+		proxyChanged[proxy] = 1;
+		changedProxies.push_back(proxy);
+	}
+}
+
+
+std::vector<AabbTree::Leaf> AabbTree::collectLeaves() const{
+
+	std::vector<Leaf> leaves;
+	leaves.reserve(objectCount);
+
+	for (uint32_t proxy = 0; proxy < proxyNodes.size(); proxy++) {
+
+		if (proxyNodes[proxy] != INVALID_NODE) {
+
+			const Node& node = nodes[proxyNodes[proxy]];
+			leaves.push_back({ node.box, proxy, node.userData });
+		}
+	}
+
+	return leaves;
+}
+
+
+void AabbTree::build(std::vector<Leaf>& leaves, uint32_t proxyCount, Tree& tree){
+
+	tree.nodes.clear();
+	tree.nodes.reserve(leaves.empty() ? 0 : leaves.size() * 2 - 1);
+	tree.proxyNodes.assign(proxyCount, INVALID_NODE);
+
+	tree.root = leaves.empty() ? INVALID_NODE : buildNode(leaves, 0, static_cast<uint32_t>(leaves.size()), INVALID_NODE, 0, tree);
+}
+
+
+uint32_t AabbTree::buildNode(std::vector<Leaf>& leaves, uint32_t begin, uint32_t end, uint32_t parent, uint32_t depth, Tree& tree){
+
+	uint32_t node = static_cast<uint32_t>(tree.nodes.size());
+
+	tree.nodes.emplace_back();
+	tree.nodes[node].parent = parent;
+
+	if (end - begin == 1) {
+
+		tree.nodes[node].box = leaves[begin].box;
+		tree.nodes[node].proxy = leaves[begin].proxy;
+		tree.nodes[node].userData = leaves[begin].userData;
+
+		tree.proxyNodes[leaves[begin].proxy] = node;
+
+		return node;
+	}
+
+
+	auto centroid = [](const Leaf& leaf, int axis) { return 0.5f * (leaf.box.min[axis] + leaf.box.max[axis]); };
+
+	float centroidMin[3], centroidMax[3];
+
+	for (int axis = 0; axis < 3; axis++) {
+
+		centroidMin[axis] = std::numeric_limits<float>::max();
+		centroidMax[axis] = -std::numeric_limits<float>::max();
+	}
+
+	for (uint32_t i = begin; i < end; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+
+			centroidMin[axis] = std::min(centroidMin[axis], centroid(leaves[i], axis));
+			centroidMax[axis] = std::max(centroidMax[axis], centroid(leaves[i], axis));
+		}
+	}
+
+
+	//Binned SAH: the split between bins minimizing leftCount * leftArea + rightCount * rightArea over all three axes.
+	int bestAxis = -1;
+	uint32_t bestBin = 0;
+	float bestCost = std::numeric_limits<float>::max();
+
+	auto binOf = [&](const Leaf& leaf, int axis) {
+
+		float extent = centroidMax[axis] - centroidMin[axis];
+		uint32_t bin = static_cast<uint32_t>((centroid(leaf, axis) - centroidMin[axis]) / extent * SAH_BIN_COUNT);
+
+		return std::min(bin, SAH_BIN_COUNT - 1);
+	};
+
+	for (int axis = 0; axis < 3 && depth < MAX_SAH_DEPTH; axis++) {
+
+		if (!(centroidMax[axis] > centroidMin[axis])) {
+			continue;
+		}
+
+		Box binBoxes[SAH_BIN_COUNT];
+		uint32_t binCounts[SAH_BIN_COUNT] = {};
+
+		for (uint32_t i = begin; i < end; i++) {
+
+			uint32_t bin = binOf(leaves[i], axis);
+
+			binBoxes[bin] = binCounts[bin] == 0 ? leaves[i].box : merge(binBoxes[bin], leaves[i].box);
+			binCounts[bin]++;
+		}
+
+
+		//Right-hand costs first, then sweep from the left.
+		float rightAreas[SAH_BIN_COUNT];
+		uint32_t rightCounts[SAH_BIN_COUNT];
+		Box rightBox{};
+		uint32_t rightCount = 0;
+
+		for (uint32_t bin = SAH_BIN_COUNT - 1; bin > 0; bin--) {
+
+			if (binCounts[bin] > 0) {
+
+				rightBox = rightCount == 0 ? binBoxes[bin] : merge(rightBox, binBoxes[bin]);
+				rightCount += binCounts[bin];
+			}
+
+			rightAreas[bin] = rightCount > 0 ? area(rightBox) : 0.0f;
+			rightCounts[bin] = rightCount;
+		}
+
+		Box leftBox{};
+		uint32_t leftCount = 0;
+
+		for (uint32_t bin = 0; bin + 1 < SAH_BIN_COUNT; bin++) {
+
+			if (binCounts[bin] > 0) {
+
+				leftBox = leftCount == 0 ? binBoxes[bin] : merge(leftBox, binBoxes[bin]);
+				leftCount += binCounts[bin];
+			}
+
+			if (leftCount == 0 || rightCounts[bin + 1] == 0) {
+				continue;
+			}
+
+			float cost = leftCount * area(leftBox) + rightCounts[bin + 1] * rightAreas[bin + 1];
+
+			if (cost < bestCost) {
+
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = bin;
+			}
+		}
+	}
+
+
+	uint32_t middle = begin + (end - begin) / 2;
+
+	if (bestAxis >= 0) {
+
+		middle = static_cast<uint32_t>(std::partition(leaves.begin() + begin, leaves.begin() + end,
+			[&](const Leaf& leaf) { return binOf(leaf, bestAxis) <= bestBin; }) - leaves.begin());
+	}
+	else {
+
+		//Too deep, or every centroid in the same place: halve along the widest axis instead.
+		int axis = 0;
+
+		for (int i = 1; i < 3; i++) {
+
+			if (centroidMax[i] - centroidMin[i] > centroidMax[axis] - centroidMin[axis]) {
+				axis = i;
+			}
+		}
+
+		std::nth_element(leaves.begin() + begin, leaves.begin() + middle, leaves.begin() + end,
+			[&](const Leaf& a, const Leaf& b) { return centroid(a, axis) < centroid(b, axis); });
+	}
+
+
+	uint32_t left = buildNode(leaves, begin, middle, node, depth + 1, tree);
+	uint32_t right = buildNode(leaves, middle, end, node, depth + 1, tree);
+
+	tree.nodes[node].children[0] = left;
+	tree.nodes[node].children[1] = right;
+	tree.nodes[node].box = merge(tree.nodes[left].box, tree.nodes[right].box);
+
+	return node;
+}
+
+
+void AabbTree::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& userData) const{
+
+	userData.clear();
+
+	if (root == INVALID_NODE) {
+		return;
+	}
+
+	float absolutePlanes[Frustum::PLANE_COUNT][3];
+
+	for (int plane = 0; plane < Frustum::PLANE_COUNT; plane++) {
+		for (int i = 0; i < 3; i++) {
+			absolutePlanes[plane][i] = std::fabs(frustum.planes[plane][i]);
+		}
+	}
+
+
+	//Each entry carries the planes its box still straddles; a box entirely inside a plane skips it below.
+	const uint32_t ALL_PLANES = (1u << Frustum::PLANE_COUNT) - 1;
+
+	std::vector<std::pair<uint32_t, uint32_t>> stack;
+	stack.reserve(64);
+	stack.push_back({ root, ALL_PLANES });
+
+	while (!stack.empty()) {
+
+		uint32_t index = stack.back().first;
+		uint32_t planeMask = stack.back().second;
+		stack.pop_back();
+
+		const Node& node = nodes[index];
+		bool outside = false;
+
+		//The same test as FrustumCuller's box kernels.
+		float center[3], extent[3];
+
+		for (int axis = 0; axis < 3; axis++) {
+
+			center[axis] = 0.5f * (node.box.min[axis] + node.box.max[axis]);
+			extent[axis] = 0.5f * (node.box.max[axis] - node.box.min[axis]);
+		}
+
+		for (int plane = 0; plane < Frustum::PLANE_COUNT && planeMask != 0; plane++) {
+
+			if ((planeMask & (1u << plane)) == 0) {
+				continue;
+			}
+
+			const float* p = frustum.planes[plane];
+
+			float distance = p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3];
+			float reach = absolutePlanes[plane][0] * extent[0] + absolutePlanes[plane][1] * extent[1] + absolutePlanes[plane][2] * extent[2];
+
+			if (distance + reach < 0.0f) {
+
+				outside = true;
+				break;
+			}
+
+			if (distance - reach >= 0.0f) {
+				planeMask &= ~(1u << plane);
+			}
+		}
+
+		if (outside) {
+			continue;
+		}
+
+		if (node.isLeaf()) {
+
+			userData.push_back(node.userData);
+		}
+		else {
+
+			stack.push_back({ node.children[0], planeMask });
+			stack.push_back({ node.children[1], planeMask });
+		}
+	}
+}
+
+
+void AabbTree::queryFrustums(const Frustum* frustums, uint32_t count, std::vector<uint32_t>* userData) const{
+
+	JobSystem::getDefault().parallelFor(count, 1, [&](uint32_t begin, uint32_t end) {
+
+		for (uint32_t i = begin; i < end; i++) {
+			queryFrustum(frustums[i], userData[i]);
+		}
+	});
+}
+
+
+AabbRayHit AabbTree::raycast(const AabbRay& ray) const{
+
+	AabbRayHit hit{ INVALID_USER_DATA, ray.maxDistance };
+
+	if (root == INVALID_NODE) {
+		return hit;
+	}
+
+	float inverseDirection[3];
+
+	for (int axis = 0; axis < 3; axis++) {
+		inverseDirection[axis] = 1.0f / ray.direction[axis];
+	}
+
+	//Slab test: the ray's entry distance into the box (clamped to 0), or infinity if it misses within hit.distance.
+	auto entryDistance = [&](const Box& box) {
+
+		float enter = 0.0f;
+		float exit = hit.distance;
+
+		for (int axis = 0; axis < 3; axis++) {
+
+			float t0 = (box.min[axis] - ray.origin[axis]) * inverseDirection[axis];
+			float t1 = (box.max[axis] - ray.origin[axis]) * inverseDirection[axis];
+
+			enter = std::max(enter, std::min(t0, t1));
+			exit = std::min(exit, std::max(t0, t1));
+		}
+
+		return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+	};
+
+
+	std::vector<std::pair<uint32_t, float>> stack;
+	stack.reserve(64);
+
+	float rootDistance = entryDistance(nodes[root].box);
+
+	if (rootDistance != std::numeric_limits<float>::infinity()) {
+		stack.push_back({ root, rootDistance });
+	}
+
+	while (!stack.empty()) {
+
+		uint32_t index = stack.back().first;
+		float distance = stack.back().second;
+		stack.pop_back();
+
+		//A closer hit was found since the node was pushed.
+		if (distance > hit.distance) {
+			continue;
+		}
+
+		const Node& node = nodes[index];
+
+		if (node.isLeaf()) {
+
+			hit.userData = node.userData;
+			hit.distance = distance;
+			continue;
+		}
+
+
+		//Nearer child on top, so it is visited first and can prune the farther one.
+		float distances[2] = { entryDistance(nodes[node.children[0]].box), entryDistance(nodes[node.children[1]].box) };
+		int nearer = distances[1] < distances[0] ? 1 : 0;
+
+		for (int child : { 1 - nearer, nearer }) {
+
+			if (distances[child] != std::numeric_limits<float>::infinity()) {
+				stack.push_back({ node.children[child], distances[child] });
+			}
+		}
+	}
+
+	return hit;
+}
+
+
+void AabbTree::raycast(const AabbRay* rays, uint32_t count, AabbRayHit* hits) const{
+
+	JobSystem::getDefault().parallelFor(count, RAYS_PER_JOB, [&](uint32_t begin, uint32_t end) {
+
+		for (uint32_t i = begin; i < end; i++) {
+			hits[i] = raycast(rays[i]);
+		}
+	});
+}
+
+
+uint32_t AabbTree::getHeight() const{
+
+	if (root == INVALID_NODE) {
+		return 0;
+	}
+
+	uint32_t height = 0;
+
+	std::vector<std::pair<uint32_t, uint32_t>> stack = { { root, 1 } };
+
+	while (!stack.empty()) {
+
+		auto entry = stack.back();
+		stack.pop_back();
+
+		height = std::max(height, entry.second);
+
+		if (!nodes[entry.first].isLeaf()) {
+
+			stack.push_back({ nodes[entry.first].children[0], entry.second + 1 });
+			stack.push_back({ nodes[entry.first].children[1], entry.second + 1 });
+		}
+	}
+
+	return height;
+}
+
+
+float AabbTree::getSahCost() const{
+
+	if (root == INVALID_NODE || nodes[root].isLeaf() || area(nodes[root].box) <= 0.0f) {
+		return 0.0f;
+	}
+
+	double internalArea = 0.0;
+
+	std::vector<uint32_t> stack = { root };
+
+	while (!stack.empty()) {
+
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!node.isLeaf()) {
+
+			internalArea += area(node.box);
+			stack.push_back(node.children[0]);
+			stack.push_back(node.children[1]);
+		}
+	}
+
+	return static_cast<float>(internalArea / area(nodes[root].box));
+}
+
+
+float AabbTree::area(const Box& box){
+
+	float x = box.max[0] - box.min[0];
+	float y = box.max[1] - box.min[1];
+	float z = box.max[2] - box.min[2];
+
+	//Half the surface area; only ratios of it matter.
+	return x * y + y * z + z * x;
+}
+
+
+AabbTree::Box AabbTree::merge(const Box& a, const Box& b){
+
+	Box box;
+
+	for (int axis = 0; axis < 3; axis++) {
+
+		box.min[axis] = std::min(a.min[axis], b.min[axis]);
+		box.max[axis] = std::max(a.max[axis], b.max[axis]);
+	}
+
+	return box;
+}
+
+
+bool AabbTree::contains(const Box& outer, const Box& inner){
+
+	for (int axis = 0; axis < 3; axis++) {
+
+		if (inner.min[axis] < outer.min[axis] || inner.max[axis] > outer.max[axis]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+AabbTree::Box AabbTree::makeFatBox(const float min[3], const float max[3]) const{
+
+	Box box;
+
+	for (int axis = 0; axis < 3; axis++) {
+
+		box.min[axis] = min[axis] - margin;
+		box.max[axis] = max[axis] + margin;
+	}
+
+	return box;
+}
+
+
+uint32_t AabbTree::allocateNode(){
+
+	if (freeNodes.empty()) {
+
+		nodes.emplace_back();
+		return static_cast<uint32_t>(nodes.size() - 1);
+	}
+
+	uint32_t node = freeNodes.back();
+	freeNodes.pop_back();
+
+	nodes[node] = Node();
+
+	return node;
+}
+
+
+void AabbTree::freeNode(uint32_t node){
+
+	freeNodes.push_back(node);
+}
+
+
+void AabbTree::insertLeaf(uint32_t leaf){
+
+	nodes[leaf].parent = INVALID_NODE;
+
+	if (root == INVALID_NODE) {
+
+		root = leaf;
+		return;
+	}
+
+
+	//Walk down towards the sibling whose pairing adds the least surface area, counting the growth of every ancestor
+	//on the way (Catto's branch cost heuristic).
+	Box leafBox = nodes[leaf].box;
+	uint32_t index = root;
+
+	while (!nodes[index].isLeaf()) {
+
+		const Node& node = nodes[index];
+
+		float nodeArea = area(node.box);
+		float combinedArea = area(merge(node.box, leafBox));
+
+		//Pairing with this node makes a new parent; descending grows this node by the leaf.
+		float cost = 2.0f * combinedArea;
+		float inheritanceCost = 2.0f * (combinedArea - nodeArea);
+
+		float childCosts[2];
+
+		for (int i = 0; i < 2; i++) {
+
+			const Node& child = nodes[node.children[i]];
+			float mergedArea = area(merge(leafBox, child.box));
+
+			childCosts[i] = (child.isLeaf() ? mergedArea : mergedArea - area(child.box)) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1]) {
+			break;
+		}
+
+		index = childCosts[0] < childCosts[1] ? node.children[0] : node.children[1];
+	}
+
+
+	uint32_t sibling = index;
+	uint32_t oldParent = nodes[sibling].parent;
+	uint32_t newParent = allocateNode();
+
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].box = merge(leafBox, nodes[sibling].box);
+	nodes[newParent].children[0] = sibling;
+	nodes[newParent].children[1] = leaf;
+
+	if (oldParent == INVALID_NODE) {
+
+		root = newParent;
+	}
+	else {
+
+		int childIndex = nodes[oldParent].children[0] == sibling ? 0 : 1;
+		nodes[oldParent].children[childIndex] = newParent;
+	}
+
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+
+	//Refit the ancestors.
+	for (index = nodes[newParent].parent; index != INVALID_NODE; index = nodes[index].parent) {
+		nodes[index].box = merge(nodes[nodes[index].children[0]].box, nodes[nodes[index].children[1]].box);
+	}
+}
+
+
+void AabbTree::removeLeaf(uint32_t leaf){
+
+	if (leaf == root) {
+
+		root = INVALID_NODE;
+		return;
+	}
+
+	uint32_t parent = nodes[leaf].parent;
+	uint32_t grandParent = nodes[parent].parent;
+	uint32_t sibling = nodes[parent].children[0] == leaf ? nodes[parent].children[1] : nodes[parent].children[0];
+
+	freeNode(parent);
+
+
+	//The sibling takes the parent's place.
+	if (grandParent == INVALID_NODE) {
+
+		root = sibling;
+		nodes[sibling].parent = INVALID_NODE;
+		return;
+	}
+
+	int childIndex = nodes[grandParent].children[0] == parent ? 0 : 1;
+	nodes[grandParent].children[childIndex] = sibling;
+	nodes[sibling].parent = grandParent;
+
+	for (uint32_t index = grandParent; index != INVALID_NODE; index = nodes[index].parent) {
+		nodes[index].box = merge(nodes[nodes[index].children[0]].box, nodes[nodes[index].children[1]].box);
+	}
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <exception>
+#include <cstdint>
+
+#include "Frustum.h"
+#include "JobSystem.h"
+
+
+struct AabbRay {
+
+	float origin[3];
+
+	//Needn't be normalized; distances are in multiples of it.
+	float direction[3];
+
+	float maxDistance;
+};
+
+struct AabbRayHit {
+
+	//INVALID_USER_DATA if the ray hit nothing.
+	uint32_t userData;
+	float distance;
+};
+
+
+//Dynamic bounding volume hierarchy over axis-aligned boxes, one leaf per object (proxy). Objects are inserted next to
+//the sibling that grows the tree's surface area least, removed in O(1) and re-inserted only once they move out of their
+//leaf's box, which is grown by a margin so small movements cost nothing. Incremental edits slowly degrade the tree, so
+//a binned SAH rebuild can run on the job system while the tree stays in use; edits made meanwhile are replayed onto the
+//new tree when update() swaps it in. Queries are const and may run concurrently with each other (not with edits).
+class AabbTree {
+
+public:
+	static constexpr uint32_t INVALID_USER_DATA = ~0u;
+
+	//Bins per axis of the SAH rebuild.
+	static constexpr uint32_t SAH_BIN_COUNT = 16;
+
+	//Queries of a batch handed to one job.
+	static constexpr uint32_t RAYS_PER_JOB = 64;
+
+	explicit AabbTree(float margin = 0.0f);
+
+	//Waits for a running rebuild.
+	~AabbTree();
+
+	AabbTree(const AabbTree&) = delete;
+	AabbTree& operator=(const AabbTree&) = delete;
+
+	//Returns the proxy, which stays valid until remove() (also across rebuilds).
+	uint32_t insert(const float min[3], const float max[3], uint32_t userData);
+
+	void remove(uint32_t proxy);
+
+	//Refits the object's box. Returns true if it left its leaf's (margin-grown) box and was re-inserted.
+	bool move(uint32_t proxy, const float min[3], const float max[3]);
+
+	//Removes every object (waiting for a running rebuild).
+	void clear();
+
+	//Rebuilds the tree with the SAH on the calling thread.
+	void rebuild();
+
+	//Starts rebuilding the current objects on the job system (right away with a single job system thread). Does nothing
+	//if a rebuild is already running.
+	void startRebuild();
+
+	//Swaps in a finished background rebuild; returns true if it did. Call once per frame. Rethrows a failed rebuild.
+	bool update();
+
+	bool isRebuilding() const { return rebuildJob != nullptr; }
+
+	//Replaces userData with the user data of every object whose box touches the frustum (in no particular order).
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& userData) const;
+
+	//One query per frustum, in parallel.
+	void queryFrustums(const Frustum* frustums, uint32_t count, std::vector<uint32_t>* userData) const;
+
+	//The nearest object whose box the ray enters within maxDistance (0 if it starts inside one).
+	AabbRayHit raycast(const AabbRay& ray) const;
+
+	//One raycast per ray, in parallel.
+	void raycast(const AabbRay* rays, uint32_t count, AabbRayHit* hits) const;
+
+	uint32_t getObjectCount() const { return objectCount; }
+
+	uint32_t getHeight() const;
+
+	//Sum of the internal nodes' surface areas relative to the root's: the expected node visits of a random ray that
+	//hits the root, lower is better.
+	float getSahCost() const;
+
+private:
+	static constexpr uint32_t INVALID_NODE = ~0u;
+
+	struct Box {
+
+		float min[3];
+		float max[3];
+	};
+
+	struct Node {
+
+		Box box;
+		uint32_t parent = INVALID_NODE;
+
+		//INVALID_NODE for leaves.
+		uint32_t children[2] = { INVALID_NODE, INVALID_NODE };
+
+		//Leaves only.
+		uint32_t proxy = 0;
+		uint32_t userData = 0;
+
+		bool isLeaf() const { return children[0] == INVALID_NODE; }
+	};
+
+	struct Leaf {
+
+		Box box;
+		uint32_t proxy;
+		uint32_t userData;
+	};
+
+	//A tree built (by a rebuild job) apart from the live one.
+	struct Tree {
+
+		std::vector<Node> nodes;
+		std::vector<uint32_t> proxyNodes;
+		uint32_t root = INVALID_NODE;
+	};
+
+	struct RebuildJob {
+
+		JobCounter counter;
+		std::vector<Leaf> leaves;
+		uint32_t proxyCount = 0;
+		Tree tree;
+		std::exception_ptr error;
+	};
+
+	static float area(const Box& box);
+
+	static Box merge(const Box& a, const Box& b);
+
+	static bool contains(const Box& outer, const Box& inner);
+
+	Box makeFatBox(const float min[3], const float max[3]) const;
+
+	uint32_t allocateNode();
+
+	void freeNode(uint32_t node);
+
+	void insertLeaf(uint32_t leaf);
+
+	void removeLeaf(uint32_t leaf);
+
+	//Marks a proxy edited since the running rebuild's snapshot.
+	void markChanged(uint32_t proxy);
+
+	std::vector<Leaf> collectLeaves() const;
+
+	static void build(std::vector<Leaf>& leaves, uint32_t proxyCount, Tree& tree);
+
+	//Past this depth nodes are split at the median, which bounds the recursion on pathological inputs.
+	static constexpr uint32_t MAX_SAH_DEPTH = 64;
+
+	static uint32_t buildNode(std::vector<Leaf>& leaves, uint32_t begin, uint32_t end, uint32_t parent, uint32_t depth, Tree& tree);
+
+	//Makes tree the live tree, then replays the edits of changedProxies onto it.
+	void swapIn(Tree& tree);
+
+	float margin;
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> freeNodes;
+	uint32_t root = INVALID_NODE;
+
+	//Leaf node of every proxy, INVALID_NODE for unused ones.
+	std::vector<uint32_t> proxyNodes;
+	std::vector<uint32_t> freeProxies;
+	uint32_t objectCount = 0;
+
+	std::unique_ptr<RebuildJob> rebuildJob;
+	std::vector<uint8_t> proxyChanged;
+	std::vector<uint32_t> changedProxies;
+};
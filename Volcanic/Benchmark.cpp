@@ -0,0 +1,80 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstdio>
+
+
+SampleStats Benchmark::computeStats(std::vector<double> samples){
+
+	SampleStats stats{};
+
+	if (samples.empty()) {
+		return stats;
+	}
+
+
+	std::sort(samples.begin(), samples.end());
+
+	stats.count = samples.size();
+	stats.min = samples.front();
+	stats.max = samples.back();
+	stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+	stats.p50 = percentile(samples, 50.0);
+	stats.p95 = percentile(samples, 95.0);
+	stats.p99 = percentile(samples, 99.0);
+
+	return stats;
+}
+
+
+double Benchmark::percentile(const std::vector<double>& sortedSamples, double p){
+
+	if (sortedSamples.empty()) {
+		return 0.0;
+	}
+
+
+	//Linear interpolation between the closest ranks.
+	double rank = (p / 100.0) * static_cast<double>(sortedSamples.size() - 1);
+	size_t lower = static_cast<size_t>(std::floor(rank));
+	size_t upper = std::min(lower + 1, sortedSamples.size() - 1);
+	double fraction = rank - static_cast<double>(lower);
+
+	return sortedSamples[lower] + (sortedSamples[upper] - sortedSamples[lower]) * fraction;
+}
+
+
+void Benchmark::writeJson(std::ostream& out, const SampleStats& stats){
+
+	char buffer[256];
+
+	snprintf(buffer, sizeof(buffer), "{\"count\":%zu,\"min\":%.4f,\"max\":%.4f,\"mean\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f}",
+		stats.count, stats.min, stats.max, stats.mean, stats.p50, stats.p95, stats.p99);
+
+	out << buffer;
+}
+
+
+std::string Benchmark::escapeJson(const std::string& text){
+
+	std::string escaped;
+	escaped.reserve(text.size());
+
+	for (char c : text) {
+
+		switch (c) {
+		case '"': escaped += "\\\""; break;
+		case '\\': escaped += "\\\\"; break;
+		case '\n': escaped += "\\n"; break;
+		case '\t': escaped += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) >= 0x20) {
+				escaped += c;
+			}
+		}
+	}
+
+	return escaped;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <ostream>
+
+
+//Summary statistics for a set of timing samples (all values in milliseconds).
+struct SampleStats {
+
+	size_t count = 0;
+	double min = 0.0;
+	double max = 0.0;
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+};
+
+
+class Benchmark {
+
+public:
+	static SampleStats computeStats(std::vector<double> samples);
+
+	static double percentile(const std::vector<double>& sortedSamples, double p);
+
+	//Writes the stats as a JSON object, e.g. {"count":100,"min":1.2,...}
+	static void writeJson(std::ostream& out, const SampleStats& stats);
+
+	static std::string escapeJson(const std::string& text);
+};
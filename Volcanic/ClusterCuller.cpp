@@ -0,0 +1,519 @@
+#include "ClusterCuller.h"
+#include "CpuTracer.h"
+
+#include <stdexcept>
+#include <array>
+#include <cstring>
+#include <algorithm>
+#include <cstddef>
+
+
+void ClusterCuller::init(VkDevice device, VkPhysicalDevice physicalDevice, GpuAllocator* allocator, PipelineCache* pipelineCache,
+	const std::vector<char>& shaderCode, uint32_t frameCount, bool multiDrawIndirect){
+
+	TRACE_FUNCTION();
+
+	this->device = device;
+	this->allocator = allocator;
+	this->multiDrawIndirect = multiDrawIndirect;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	maxWorkGroupCount = deviceProperties.limits.maxComputeWorkGroupCount[0];
+
+
+	//Instances, meshlets, source indices, visible indices, draw commands, statistics & slots.
+	std::array<VkDescriptorSetLayoutBinding, 7> bindings{};
+
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create cluster culling descriptor set layout!");
+	}
+
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = frameCount * static_cast<uint32_t>(bindings.size());
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = frameCount;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create cluster culling descriptor pool!");
+	}
+
+
+	frames.resize(frameCount);
+
+	std::vector<VkDescriptorSetLayout> layouts(frameCount, descriptorSetLayout);
+	std::vector<VkDescriptorSet> descriptorSets(frameCount);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = frameCount;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to allocate cluster culling descriptor sets!");
+	}
+
+	//The statistics & slots don't depend on the mesh, so they live as long as the culler (and another pass can bind the
+	//slots before there are meshlets).
+	for (uint32_t i = 0; i < frameCount; i++) {
+
+		Frame& frame = frames[i];
+		frame.descriptorSet = descriptorSets[i];
+
+		frame.statisticsBuffer = createBuffer(sizeof(StatisticsCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		frame.slotBuffer = createBuffer(sizeof(SlotCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+
+		std::array<VkDescriptorBufferInfo, 2> bufferInfos{};
+		bufferInfos[0] = { frame.statisticsBuffer.buffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { frame.slotBuffer.buffer, 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+
+		for (uint32_t j = 0; j < descriptorWrites.size(); j++) {
+
+			descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[j].dstSet = frame.descriptorSet;
+			descriptorWrites[j].dstBinding = 5 + j;
+			descriptorWrites[j].dstArrayElement = 0;
+			descriptorWrites[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[j].descriptorCount = 1;
+			descriptorWrites[j].pBufferInfo = &bufferInfos[j];
+		}
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ClusterConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create cluster culling pipeline layout!");
+	}
+
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = shaderCode.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+	VkShaderModule shaderModule;
+
+	if (vkCreateShaderModule(device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create cluster culling shader module!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+
+	VkResult result = pipelineCache->createComputePipelines(1, &pipelineInfo, &pipeline);
+
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create cluster culling pipeline!");
+	}
+}
+
+
+void ClusterCuller::cleanup(){
+
+	destroyBuffers();
+
+	for (Frame& frame : frames) {
+
+		destroyBuffer(frame.statisticsBuffer);
+		destroyBuffer(frame.slotBuffer);
+	}
+
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+
+	frames.clear();
+	slotCount = 0;
+}
+
+
+void ClusterCuller::setMeshlets(VkBuffer instanceBuffer, VkBuffer meshletBuffer, uint32_t meshletCount, VkBuffer indexBuffer, VkIndexType indexType,
+	uint32_t segmentIndexCount, int32_t vertexOffset){
+
+	TRACE_FUNCTION();
+
+	destroyBuffers();
+
+	//One invocation per meshlet, all of an instance's in a single row of workgroups.
+	if ((meshletCount + LOCAL_SIZE - 1) / LOCAL_SIZE > maxWorkGroupCount) {
+
+		throw std::runtime_error("Too many meshlets to cull!");
+	}
+
+	this->meshletCount = meshletCount;
+	this->segmentIndexCount = segmentIndexCount;
+	this->vertexOffset = vertexOffset;
+	shortIndices = indexType == VK_INDEX_TYPE_UINT16;
+
+	VkDeviceSize segmentBytes = static_cast<VkDeviceSize>(segmentIndexCount) * sizeof(uint32_t);
+	slotCount = meshletCount == 0 || segmentBytes == 0 ? 0 : static_cast<uint32_t>(std::min<VkDeviceSize>(MAX_SLOTS, MAX_VISIBLE_INDEX_BYTES / segmentBytes));
+
+	for (Frame& frame : frames) {
+		frame.slotsUsed = 0;
+	}
+
+	if (slotCount == 0) {
+		return;
+	}
+
+
+	//Each slot draws its instance from the start of its segment, where the shader copies the surviving indices to. The
+	//shader also fills in the instance, from the slot buffer.
+	std::vector<VkDrawIndexedIndirectCommand> commands(slotCount);
+
+	for (uint32_t slot = 0; slot < slotCount; slot++) {
+
+		commands[slot].indexCount = 0;
+		commands[slot].instanceCount = 1;
+		commands[slot].firstIndex = slot * segmentIndexCount;
+		commands[slot].vertexOffset = vertexOffset;
+		commands[slot].firstInstance = 0;
+	}
+
+	VkDeviceSize commandBytes = slotCount * sizeof(VkDrawIndexedIndirectCommand);
+	VkDeviceSize readbackBytes = commandBytes + sizeof(StatisticsCounters) + sizeof(uint32_t);
+
+	templateBuffer = createBuffer(commandBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	memcpy(templateBuffer.allocation.mappedData, commands.data(), commandBytes);
+
+	for (Frame& frame : frames) {
+
+		frame.visibleIndexBuffer = createBuffer(slotCount * segmentBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		frame.drawCommandBuffer = createBuffer(commandBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+			| VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		frame.readbackBuffer = createBuffer(readbackBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		//Nothing was culled before the frame's first submission.
+		memset(frame.readbackBuffer.allocation.mappedData, 0, readbackBytes);
+
+
+		std::array<VkDescriptorBufferInfo, 5> bufferInfos{};
+		bufferInfos[0] = { instanceBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { meshletBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[2] = { indexBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[3] = { frame.visibleIndexBuffer.buffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[4] = { frame.drawCommandBuffer.buffer, 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, 5> descriptorWrites{};
+
+		for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+
+			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[i].dstSet = frame.descriptorSet;
+			descriptorWrites[i].dstBinding = i;
+			descriptorWrites[i].dstArrayElement = 0;
+			descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[i].descriptorCount = 1;
+			descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+
+void ClusterCuller::recordSlots(VkCommandBuffer commandBuffer, uint32_t frame, const uint32_t* instances, uint32_t instanceCount){
+
+	Frame& target = frames[frame];
+	target.slotsUsed = std::min(instanceCount, slotCount);
+
+	if (target.slotsUsed == 0) {
+		return;
+	}
+
+	SlotCounters slots;
+	slots.count = target.slotsUsed;
+	memcpy(slots.instances, instances, target.slotsUsed * sizeof(uint32_t));
+
+	//A few hundred bytes at most, well within vkCmdUpdateBuffer's limit.
+	vkCmdUpdateBuffer(commandBuffer, target.slotBuffer.buffer, 0, offsetof(SlotCounters, instances) + target.slotsUsed * sizeof(uint32_t), &slots);
+}
+
+
+void ClusterCuller::recordSlotReset(VkCommandBuffer commandBuffer, uint32_t frame){
+
+	Frame& target = frames[frame];
+	target.slotsUsed = slotCount;
+
+	if (target.slotsUsed == 0) {
+		return;
+	}
+
+	vkCmdFillBuffer(commandBuffer, target.slotBuffer.buffer, 0, sizeof(uint32_t), 0);
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = target.slotBuffer.buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+
+void ClusterCuller::recordCulling(VkCommandBuffer commandBuffer, uint32_t frame, const Frustum& frustum, const float cameraPosition[3]){
+
+	Frame& target = frames[frame];
+
+	if (target.slotsUsed == 0) {
+		return;
+	}
+
+	VkDeviceSize commandBytes = target.slotsUsed * sizeof(VkDrawIndexedIndirectCommand);
+
+
+	//The index counts and statistics start at 0; the shader's atomics count the surviving indices and the culled.
+	VkBufferCopy resetRegion{ 0, 0, commandBytes };
+	vkCmdCopyBuffer(commandBuffer, templateBuffer.buffer, target.drawCommandBuffer.buffer, 1, &resetRegion);
+	vkCmdFillBuffer(commandBuffer, target.statisticsBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+	//The slots were either updated by a transfer or claimed by another compute pass.
+	std::array<VkBufferMemoryBarrier, 3> resetBarriers{};
+
+	for (VkBufferMemoryBarrier& barrier : resetBarriers) {
+
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+	}
+
+	resetBarriers[0].buffer = target.drawCommandBuffer.buffer;
+	resetBarriers[1].buffer = target.statisticsBuffer.buffer;
+	resetBarriers[2].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	resetBarriers[2].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	resetBarriers[2].buffer = target.slotBuffer.buffer;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr,
+		static_cast<uint32_t>(resetBarriers.size()), resetBarriers.data(), 0, nullptr);
+
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &target.descriptorSet, 0, nullptr);
+
+	ClusterConstants constants{};
+	memcpy(constants.frustumPlanes, frustum.planes, sizeof(constants.frustumPlanes));
+	memcpy(constants.cameraPosition, cameraPosition, sizeof(constants.cameraPosition));
+	constants.meshletCount = meshletCount;
+	constants.shortIndices = shortIndices ? 1 : 0;
+
+	//Workgroups of slots nobody claimed return straight away.
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ClusterConstants), &constants);
+	vkCmdDispatch(commandBuffer, (meshletCount + LOCAL_SIZE - 1) / LOCAL_SIZE, target.slotsUsed, 1);
+
+
+	//The draws read the commands & visible indices, the readback copy reads the commands, statistics & slot count.
+	std::array<VkBufferMemoryBarrier, 4> cullBarriers{};
+
+	for (VkBufferMemoryBarrier& barrier : cullBarriers) {
+
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+	}
+
+	cullBarriers[0].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	cullBarriers[0].buffer = target.drawCommandBuffer.buffer;
+	cullBarriers[1].dstAccessMask = VK_ACCESS_INDEX_READ_BIT;
+	cullBarriers[1].buffer = target.visibleIndexBuffer.buffer;
+	cullBarriers[2].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	cullBarriers[2].buffer = target.statisticsBuffer.buffer;
+	cullBarriers[3].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	cullBarriers[3].buffer = target.slotBuffer.buffer;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, static_cast<uint32_t>(cullBarriers.size()), cullBarriers.data(), 0, nullptr);
+
+
+	vkCmdCopyBuffer(commandBuffer, target.drawCommandBuffer.buffer, target.readbackBuffer.buffer, 1, &resetRegion);
+
+	VkBufferCopy statisticsRegion{ 0, commandBytes, sizeof(StatisticsCounters) };
+	vkCmdCopyBuffer(commandBuffer, target.statisticsBuffer.buffer, target.readbackBuffer.buffer, 1, &statisticsRegion);
+
+	VkBufferCopy slotCountRegion{ 0, commandBytes + sizeof(StatisticsCounters), sizeof(uint32_t) };
+	vkCmdCopyBuffer(commandBuffer, target.slotBuffer.buffer, target.readbackBuffer.buffer, 1, &slotCountRegion);
+
+	VkBufferMemoryBarrier readbackBarrier = resetBarriers[0];
+	readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	readbackBarrier.buffer = target.readbackBuffer.buffer;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &readbackBarrier, 0, nullptr);
+}
+
+
+void ClusterCuller::recordDraws(VkCommandBuffer commandBuffer, uint32_t frame) const{
+
+	uint32_t slotsUsed = frames[frame].slotsUsed;
+
+	if (multiDrawIndirect && slotsUsed > 0) {
+
+		vkCmdDrawIndexedIndirect(commandBuffer, frames[frame].drawCommandBuffer.buffer, 0, slotsUsed, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else {
+
+		for (uint32_t slot = 0; slot < slotsUsed; slot++) {
+			recordDraw(commandBuffer, frame, slot);
+		}
+	}
+}
+
+
+void ClusterCuller::recordDraw(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t slot) const{
+
+	uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	vkCmdDrawIndexedIndirect(commandBuffer, frames[frame].drawCommandBuffer.buffer, slot * stride, 1, stride);
+}
+
+
+ClusterStatistics ClusterCuller::readStatistics(uint32_t frame) const{
+
+	ClusterStatistics statistics;
+	uint32_t slotsUsed = frames[frame].slotsUsed;
+
+	if (slotsUsed == 0) {
+		return statistics;
+	}
+
+	const VkDrawIndexedIndirectCommand* commands = static_cast<const VkDrawIndexedIndirectCommand*>(frames[frame].readbackBuffer.allocation.mappedData);
+
+	for (uint32_t slot = 0; slot < slotsUsed; slot++) {
+		statistics.drawnTriangleCount += commands[slot].indexCount / 3;
+	}
+
+	StatisticsCounters counters;
+	memcpy(&counters, commands + slotsUsed, sizeof(counters));
+
+	//A pass claiming slots keeps counting once they run out.
+	uint32_t claimedCount;
+	memcpy(&claimedCount, reinterpret_cast<const char*>(commands + slotsUsed) + sizeof(counters), sizeof(claimedCount));
+
+	statistics.instanceCount = std::min(claimedCount, slotsUsed);
+	statistics.frustumCulledCount = counters.frustumCulledCount;
+	statistics.backfaceCulledCount = counters.backfaceCulledCount;
+	statistics.visibleCount = statistics.instanceCount * meshletCount - counters.frustumCulledCount - counters.backfaceCulledCount;
+
+	return statistics;
+}
+
+
+ClusterCuller::Buffer ClusterCuller::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties){
+
+	Buffer buffer;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer.buffer) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create cluster culling buffer!");
+	}
+
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer.buffer, &memRequirements);
+
+	uint32_t memoryType = allocator->findMemoryType(memRequirements.memoryTypeBits, properties);
+
+	buffer.allocation = allocator->allocate(memRequirements, memoryType, GpuAllocator::ResourceType::Linear);
+
+	vkBindBufferMemory(device, buffer.buffer, buffer.allocation.memory, buffer.allocation.offset);
+
+	return buffer;
+}
+
+
+void ClusterCuller::destroyBuffer(Buffer& buffer){
+
+	if (buffer.buffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkDestroyBuffer(device, buffer.buffer, nullptr);
+	allocator->free(buffer.allocation);
+
+	buffer.buffer = VK_NULL_HANDLE;
+}
+
+
+void ClusterCuller::destroyBuffers(){
+
+	for (Frame& frame : frames) {
+
+		destroyBuffer(frame.visibleIndexBuffer);
+		destroyBuffer(frame.drawCommandBuffer);
+		destroyBuffer(frame.readbackBuffer);
+	}
+
+	destroyBuffer(templateBuffer);
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+#include "GpuAllocator.h"
+#include "PipelineCache.h"
+#include "Frustum.h"
+#include "MeshletBuilder.h"
+
+
+//What a frame's cluster culling did with the meshlets it tested (those of every instance it culled).
+struct ClusterStatistics {
+
+	uint32_t instanceCount = 0;
+	uint32_t visibleCount = 0;
+	uint32_t frustumCulledCount = 0;
+	uint32_t backfaceCulledCount = 0;
+
+	//Triangles of the surviving meshlets.
+	uint64_t drawnTriangleCount = 0;
+};
+
+
+//Culls the meshlets of a mesh's instances on the GPU, without mesh shaders: a compute pass tests every meshlet of each
+//instance against the frustum and its normal cone, and copies the survivors' indices into the instance's segment of
+//the frame's visible index buffer, counting them into a VkDrawIndexedIndirectCommand per instance. The graphics pass
+//binds that index buffer and draws each instance indirectly, so only its clusters facing the camera inside the frustum
+//are rasterized. Instances are culled in slots (one segment each, sized for the full mesh), filled either by the CPU
+//or by GpuCuller's pass with the instances that survived it; buffers written by the GPU are per frame in flight.
+class ClusterCuller {
+
+public:
+	//Invocations per workgroup, as declared by ClusterCull.comp.
+	static constexpr uint32_t LOCAL_SIZE = 64;
+
+	//Upper bounds on the instances culled per frame, and on each frame's visible index buffer.
+	static constexpr uint32_t MAX_SLOTS = 64;
+	static constexpr VkDeviceSize MAX_VISIBLE_INDEX_BYTES = 32 << 20;
+
+	//multiDrawIndirect must be the device feature's enabled state; without it every slot is its own indirect call.
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, GpuAllocator* allocator, PipelineCache* pipelineCache,
+		const std::vector<char>& shaderCode, uint32_t frameCount, bool multiDrawIndirect);
+
+	void cleanup();
+
+	//(Re)creates the buffers for the meshlets in meshletBuffer (laid out as Meshlet), whose ranges index indexBuffer.
+	//instanceBuffer, meshletBuffer and indexBuffer need STORAGE_BUFFER usage, and a 16-bit indexBuffer a size rounded
+	//up to 4 bytes. segmentIndexCount is the most indices an instance can draw (the meshlets' total). Only call while
+	//the GPU uses none of the culler's buffers.
+	void setMeshlets(VkBuffer instanceBuffer, VkBuffer meshletBuffer, uint32_t meshletCount, VkBuffer indexBuffer, VkIndexType indexType,
+		uint32_t segmentIndexCount, int32_t vertexOffset);
+
+	//Instances a frame can cull: 0 without meshlets, or when a single segment would overflow MAX_VISIBLE_INDEX_BYTES.
+	uint32_t getSlotCount() const { return slotCount; }
+
+	//Fills the frame's slots with the first getSlotCount() of instances (indices into the instance buffer), slot i
+	//drawing instances[i].
+	void recordSlots(VkCommandBuffer commandBuffer, uint32_t frame, const uint32_t* instances, uint32_t instanceCount);
+
+	//Empties the frame's slots for a compute pass to claim them through getSlotBuffer(). Must be recorded before that
+	//pass, which the culling then waits for.
+	void recordSlotReset(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	//Resets the frame's draw commands and culls the meshlets of the instances in its slots into them. cameraPosition is
+	//in the space the frustum's planes are. Must be recorded outside of a render pass, after the slots are filled and
+	//before the draws.
+	void recordCulling(VkCommandBuffer commandBuffer, uint32_t frame, const Frustum& frustum, const float cameraPosition[3]);
+
+	//Issues the indirect draws of every slot of the frame's culling, or of only one. The caller binds the pipeline, the
+	//instance buffer as the instance stream and getIndexBuffer() (as UINT32) as the index buffer.
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t frame) const;
+
+	void recordDraw(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t slot) const;
+
+	VkBuffer getIndexBuffer(uint32_t frame) const { return frames[frame].visibleIndexBuffer.buffer; }
+
+	//The frame's slots, laid out as ClusterSlots in ClusterCull.comp: a count of the claimed slots, then MAX_SLOTS
+	//instance indices. A pass claiming slots bumps the count and only writes the slots below getSlotCount().
+	VkBuffer getSlotBuffer(uint32_t frame) const { return frames[frame].slotBuffer.buffer; }
+
+	//vkCmdDrawIndexedIndirect calls of the frame's recordDraws(): one, or one per slot without multiDrawIndirect.
+	uint32_t getIndirectCallCount(uint32_t frame) const { return multiDrawIndirect ? 1 : frames[frame].slotsUsed; }
+
+	//Only valid once the fence of the frame's submission has signalled.
+	ClusterStatistics readStatistics(uint32_t frame) const;
+
+private:
+	//Matches ClusterConstants in ClusterCull.comp.
+	struct ClusterConstants {
+
+		float frustumPlanes[Frustum::PLANE_COUNT][4];
+		float cameraPosition[3];
+		uint32_t meshletCount;
+		uint32_t shortIndices;
+	};
+
+	//Matches ClusterSlots in ClusterCull.comp.
+	struct SlotCounters {
+
+		uint32_t count;
+		uint32_t instances[MAX_SLOTS];
+	};
+
+	//Matches ClusterStatistics in ClusterCull.comp.
+	struct StatisticsCounters {
+
+		uint32_t frustumCulledCount;
+		uint32_t backfaceCulledCount;
+	};
+
+	struct Buffer {
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		GpuAllocation allocation;
+	};
+
+	struct Frame {
+
+		//Written by the compute pass, read as the index buffer.
+		Buffer visibleIndexBuffer;
+
+		//Reset from the template, filled by the compute pass, read by the indirect draws.
+		Buffer drawCommandBuffer;
+
+		//Written by recordSlots() or claimed by another compute pass, read by the culling.
+		Buffer slotBuffer;
+
+		//Zeroed, then counted into by the compute pass.
+		Buffer statisticsBuffer;
+
+		//Host-visible copy of the draw commands followed by the statistics and the slot count, for readStatistics().
+		Buffer readbackBuffer;
+
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+		//Slots the frame's culling dispatches: the ones recordSlots() filled, or every slot after recordSlotReset().
+		uint32_t slotsUsed = 0;
+	};
+
+	Buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+
+	void destroyBuffer(Buffer& buffer);
+
+	void destroyBuffers();
+
+	VkDevice device = VK_NULL_HANDLE;
+	GpuAllocator* allocator = nullptr;
+	bool multiDrawIndirect = false;
+	uint32_t maxWorkGroupCount = 0;
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	std::vector<Frame> frames;
+
+	uint32_t meshletCount = 0;
+	uint32_t segmentIndexCount = 0;
+	int32_t vertexOffset = 0;
+	bool shortIndices = false;
+	uint32_t slotCount = 0;
+
+	//A draw command per slot with an index count of 0, copied over each frame's commands before culling.
+	Buffer templateBuffer;
+};
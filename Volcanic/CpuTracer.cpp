@@ -0,0 +1,122 @@
+#include "CpuTracer.h"
+#include "Benchmark.h"
+
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+
+
+std::atomic<bool> CpuTracer::enabledFlag{ false };
+thread_local CpuTracer::ThreadBuffer* CpuTracer::localBuffer = nullptr;
+
+
+namespace {
+
+	//Every thread that ever recorded a zone. Buffers are kept alive until exit so zones of finished threads still get exported.
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<CpuTracer::ThreadBuffer>> threadBuffers;
+
+	//Reference point used to convert ticks to microseconds.
+	const uint64_t startTicks = CpuTracer::now();
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	//Name given to the calling thread before it recorded its first zone.
+	thread_local std::string pendingThreadName;
+}
+
+
+CpuTracer::ThreadBuffer* CpuTracer::registerThread(){
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	threadBuffers.push_back(std::make_unique<ThreadBuffer>());
+
+	ThreadBuffer* buffer = threadBuffers.back().get();
+	buffer->threadId = static_cast<uint32_t>(threadBuffers.size());
+	buffer->threadName = pendingThreadName.empty() ? "Thread " + std::to_string(buffer->threadId) : pendingThreadName;
+
+	localBuffer = buffer;
+
+	return buffer;
+}
+
+
+void CpuTracer::setThreadName(const std::string& name){
+
+	//Don't allocate a ring buffer for a thread that may never record a zone.
+	if (localBuffer == nullptr) {
+
+		pendingThreadName = name;
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	localBuffer->threadName = name;
+}
+
+
+bool CpuTracer::exportChromeTrace(const std::string& path){
+
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+
+	if (!file.is_open()) {
+		return false;
+	}
+
+
+	//Calibrate ticks against the steady clock over the whole run (a no-op ratio of 1 when ticks are already nanoseconds).
+	uint64_t endTicks = now();
+	double elapsedNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count());
+	double microsecondsPerTick = endTicks > startTicks ? elapsedNs / static_cast<double>(endTicks - startTicks) / 1000.0 : 0.001;
+
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool first = true;
+	char buffer[128];
+	std::vector<ZoneEvent> events;
+
+	for (const auto& thread : threadBuffers) {
+
+		file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->threadId
+			<< ",\"args\":{\"name\":\"" << Benchmark::escapeJson(thread->threadName) << "\"}}";
+		first = false;
+
+
+		//Copy the newest CAPACITY events, then drop any the producer may have overwritten while copying.
+		uint64_t writeIndex = thread->writeIndex.load(std::memory_order_acquire);
+		uint64_t begin = writeIndex > ThreadBuffer::CAPACITY ? writeIndex - ThreadBuffer::CAPACITY : 0;
+
+		events.clear();
+
+		for (uint64_t i = begin; i < writeIndex; i++) {
+			events.push_back(thread->events[i & (ThreadBuffer::CAPACITY - 1)]);
+		}
+
+		uint64_t writeIndexAfter = thread->writeIndex.load(std::memory_order_acquire);
+		uint64_t overwritten = writeIndexAfter > ThreadBuffer::CAPACITY ? writeIndexAfter - ThreadBuffer::CAPACITY : 0;
+		size_t skip = overwritten > begin ? static_cast<size_t>(std::min<uint64_t>(overwritten - begin, events.size())) : 0;
+
+
+		for (size_t i = skip; i < events.size(); i++) {
+
+			const ZoneEvent& event = events[i];
+
+			double start = static_cast<double>(event.startTicks - startTicks) * microsecondsPerTick;
+			double duration = static_cast<double>(event.endTicks - event.startTicks) * microsecondsPerTick;
+
+			snprintf(buffer, sizeof(buffer), ",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}", start, duration, thread->threadId);
+
+			file << ",\n{\"name\":\"" << Benchmark::escapeJson(event.name) << "\",\"cat\":\"cpu\",\"ph\":\"X\"" << buffer;
+		}
+	}
+
+	file << "\n]}\n";
+
+	return file.good();
+}
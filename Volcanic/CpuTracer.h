@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <chrono>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define VOLCANIC_TRACE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define VOLCANIC_TRACE_RDTSC 1
+#endif
+
+
+//Scoped CPU zone tracing. Each thread writes completed zones into its own fixed-size ring buffer
+//(single producer, no locks on the hot path); the rings are exported as Chrome/Perfetto trace JSON.
+class CpuTracer {
+
+public:
+	struct ZoneEvent {
+
+		const char* name;
+		uint64_t startTicks;
+		uint64_t endTicks;
+	};
+
+	struct ThreadBuffer {
+
+		static const uint32_t CAPACITY = 1 << 16;
+
+		uint32_t threadId = 0;
+		std::string threadName;
+		std::atomic<uint64_t> writeIndex{ 0 };
+		ZoneEvent events[CAPACITY];
+	};
+
+	static void setEnabled(bool enabled) { enabledFlag.store(enabled, std::memory_order_relaxed); }
+
+	static bool isEnabled() { return enabledFlag.load(std::memory_order_relaxed); }
+
+	//Names the calling thread in the exported trace. Its ring buffer is still only allocated by its first zone.
+	static void setThreadName(const std::string& name);
+
+	//Writes every recorded zone of every thread as Chrome trace event JSON. Returns false if the file can't be written.
+	static bool exportChromeTrace(const std::string& path);
+
+	static inline uint64_t now() {
+
+#ifdef VOLCANIC_TRACE_RDTSC
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+	}
+
+	static inline void record(const char* name, uint64_t startTicks, uint64_t endTicks) {
+
+		ThreadBuffer* buffer = localBuffer != nullptr ? localBuffer : registerThread();
+
+		uint64_t index = buffer->writeIndex.load(std::memory_order_relaxed);
+
+		ZoneEvent& event = buffer->events[index & (ThreadBuffer::CAPACITY - 1)];
+		event.name = name;
+		event.startTicks = startTicks;
+		event.endTicks = endTicks;
+
+		//Publish the event to the exporter.
+		buffer->writeIndex.store(index + 1, std::memory_order_release);
+	}
+
+private:
+	static std::atomic<bool> enabledFlag;
+	static thread_local ThreadBuffer* localBuffer;
+
+	static ThreadBuffer* registerThread();
+};
+
+
+class CpuTraceZone {
+
+public:
+	explicit CpuTraceZone(const char* name) : name(name), startTicks(CpuTracer::isEnabled() ? CpuTracer::now() : 0) {}
+
+	~CpuTraceZone() {
+
+		if (startTicks != 0) {
+			CpuTracer::record(name, startTicks, CpuTracer::now());
+		}
+	}
+
+	CpuTraceZone(const CpuTraceZone&) = delete;
+	CpuTraceZone& operator=(const CpuTraceZone&) = delete;
+
+private:
+	const char* name;
+	uint64_t startTicks;
+};
+
+
+//Names must be string literals (or otherwise outlive the trace export).
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) CpuTraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_FUNCTION() TRACE_ZONE(__FUNCTION__)
@@ -0,0 +1,425 @@
+#include "DepthPyramid.h"
+#include "CpuTracer.h"
+
+#include <stdexcept>
+#include <array>
+#include <cstring>
+#include <algorithm>
+
+
+void DepthPyramid::init(VkDevice device, GpuAllocator* allocator, PipelineCache* pipelineCache, const std::vector<char>& shaderCode, bool storageImageExtendedFormats){
+
+	TRACE_FUNCTION();
+
+	this->device = device;
+	this->allocator = allocator;
+
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create depth pyramid sampler!");
+	}
+
+
+	if (!storageImageExtendedFormats) {
+		return;
+	}
+
+
+	//The source (depth attachment or the level above) & the level written.
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create depth pyramid descriptor set layout!");
+	}
+
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ReduceConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create depth pyramid pipeline layout!");
+	}
+
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = shaderCode.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+	VkShaderModule shaderModule;
+
+	if (vkCreateShaderModule(device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create depth pyramid shader module!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+
+	VkResult result = pipelineCache->createComputePipelines(1, &pipelineInfo, &pipeline);
+
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create depth pyramid pipeline!");
+	}
+}
+
+
+void DepthPyramid::cleanup(){
+
+	destroy();
+
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+	vkDestroySampler(device, sampler, nullptr);
+
+	pipeline = VK_NULL_HANDLE;
+}
+
+
+void DepthPyramid::create(VkImage depthImage, VkImageView depthView, VkFormat depthFormat, uint32_t width, uint32_t height){
+
+	TRACE_FUNCTION();
+
+	destroy();
+
+	this->depthImage = depthImage;
+
+	//Layout transitions of a combined format cover both aspects.
+	bool hasStencil = depthFormat == VK_FORMAT_D16_UNORM_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT || depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	depthAspects = hasStencil ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+
+	depthWidth = width;
+	depthHeight = height;
+
+	//Rounded down to powers of two, so every further level halves exactly and covers 2x2 texels of the one above.
+	this->width = 1;
+	this->height = 1;
+
+	while (this->width * 2 <= width) {
+		this->width *= 2;
+	}
+
+	while (this->height * 2 <= height) {
+		this->height *= 2;
+	}
+
+	uint32_t levelCount = 1;
+
+	while ((std::max(this->width, this->height) >> levelCount) > 0) {
+		levelCount++;
+	}
+
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = this->width;
+	imageInfo.extent.height = this->height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = levelCount;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = FORMAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create depth pyramid image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+	allocation = allocator->allocate(memRequirements, allocator->findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), GpuAllocator::ResourceType::Optimal);
+
+	vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = FORMAT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = levelCount;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create depth pyramid image view!");
+	}
+
+	levelViews.resize(levelCount);
+
+	for (uint32_t i = 0; i < levelCount; i++) {
+
+		viewInfo.subresourceRange.baseMipLevel = i;
+		viewInfo.subresourceRange.levelCount = 1;
+
+		if (vkCreateImageView(device, &viewInfo, nullptr, &levelViews[i]) != VK_SUCCESS) {
+
+			throw std::runtime_error("Failed to create depth pyramid level view!");
+		}
+	}
+
+
+	if (!isSupported()) {
+		return;
+	}
+
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = levelCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = levelCount;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = levelCount;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create depth pyramid descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(levelCount, descriptorSetLayout);
+	descriptorSets.resize(levelCount);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = levelCount;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to allocate depth pyramid descriptor sets!");
+	}
+
+	for (uint32_t i = 0; i < levelCount; i++) {
+
+		VkDescriptorImageInfo sourceInfo{};
+		sourceInfo.sampler = sampler;
+		sourceInfo.imageView = i == 0 ? depthView : levelViews[i - 1];
+		sourceInfo.imageLayout = i == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo destinationInfo{};
+		destinationInfo.imageView = levelViews[i];
+		destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+
+		for (uint32_t j = 0; j < descriptorWrites.size(); j++) {
+
+			descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[j].dstSet = descriptorSets[i];
+			descriptorWrites[j].dstBinding = j;
+			descriptorWrites[j].dstArrayElement = 0;
+			descriptorWrites[j].descriptorCount = 1;
+		}
+
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[0].pImageInfo = &sourceInfo;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptorWrites[1].pImageInfo = &destinationInfo;
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+
+void DepthPyramid::destroy(){
+
+	if (image == VK_NULL_HANDLE) {
+		return;
+	}
+
+	//Freeing the pool frees its sets.
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	descriptorPool = VK_NULL_HANDLE;
+	descriptorSets.clear();
+
+	for (VkImageView levelView : levelViews) {
+		vkDestroyImageView(device, levelView, nullptr);
+	}
+
+	levelViews.clear();
+
+	vkDestroyImageView(device, view, nullptr);
+	vkDestroyImage(device, image, nullptr);
+	allocator->free(allocation);
+
+	view = VK_NULL_HANDLE;
+	image = VK_NULL_HANDLE;
+	built = false;
+}
+
+
+void DepthPyramid::recordReset(VkCommandBuffer commandBuffer){
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, getLevelCount(), 0, 1 };
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+
+	//Nearest 0, farthest 1: nothing is behind the far plane.
+	VkClearColorValue farPlane{};
+	farPlane.float32[0] = 0.0f;
+	farPlane.float32[1] = 1.0f;
+
+	vkCmdClearColorImage(commandBuffer, image, VK_IMAGE_LAYOUT_GENERAL, &farPlane, 1, &barrier.subresourceRange);
+
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+
+void DepthPyramid::recordBuild(VkCommandBuffer commandBuffer, const float* viewProjection){
+
+	if (!isSupported()) {
+		return;
+	}
+
+	//The render pass wrote the depth; the pyramid may still be read by this frame's culling.
+	std::array<VkImageMemoryBarrier, 2> barriers{};
+
+	for (VkImageMemoryBarrier& barrier : barriers) {
+
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	}
+
+	barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	barriers[0].image = depthImage;
+	barriers[0].subresourceRange = { depthAspects, 0, 1, 0, 1 };
+
+	barriers[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barriers[1].image = image;
+	barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, getLevelCount(), 0, 1 };
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+	ReduceConstants constants{};
+	constants.sourceSize[0] = static_cast<int32_t>(depthWidth);
+	constants.sourceSize[1] = static_cast<int32_t>(depthHeight);
+	constants.sourceIsDepth = 1;
+
+	for (uint32_t i = 0; i < getLevelCount(); i++) {
+
+		uint32_t levelWidth = std::max(width >> i, 1u);
+		uint32_t levelHeight = std::max(height >> i, 1u);
+
+		constants.destinationSize[0] = static_cast<int32_t>(levelWidth);
+		constants.destinationSize[1] = static_cast<int32_t>(levelHeight);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReduceConstants), &constants);
+		vkCmdDispatch(commandBuffer, (levelWidth + LOCAL_SIZE - 1) / LOCAL_SIZE, (levelHeight + LOCAL_SIZE - 1) / LOCAL_SIZE, 1);
+
+
+		//The next level reads this one; after the last, the next frame's culling reads them all.
+		VkImageMemoryBarrier levelBarrier = barriers[1];
+		levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		levelBarrier.subresourceRange.baseMipLevel = i;
+		levelBarrier.subresourceRange.levelCount = 1;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &levelBarrier);
+
+		constants.sourceSize[0] = constants.destinationSize[0];
+		constants.sourceSize[1] = constants.destinationSize[1];
+		constants.sourceIsDepth = 0;
+	}
+
+
+	//Back to an attachment before the next render pass clears it.
+	VkImageMemoryBarrier depthBarrier = barriers[0];
+	depthBarrier.srcAccessMask = 0;
+	depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+
+
+	memcpy(this->viewProjection, viewProjection, sizeof(this->viewProjection));
+	built = true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+#include "GpuAllocator.h"
+#include "PipelineCache.h"
+
+
+//A hierarchical-Z pyramid of the depth attachment, for occlusion culling against the previous frame's depth. Each
+//texel holds the nearest (R) and farthest (G) depth of the depth texels it covers. The first level is the largest
+//power of two that fits in the depth attachment, every further one halves it down to 1x1, and DepthPyramid.comp
+//builds one level per dispatch after the render pass. The image stays in VK_IMAGE_LAYOUT_GENERAL.
+class DepthPyramid {
+
+public:
+	static constexpr VkFormat FORMAT = VK_FORMAT_R32G32_SFLOAT;
+
+	//Invocations per workgroup along x and y, as declared by DepthPyramid.comp.
+	static constexpr uint32_t LOCAL_SIZE = 8;
+
+	//Building writes rg32f storage images, which needs shaderStorageImageExtendedFormats. Without it the pyramid is
+	//still created (and never occludes anything) but can't be built.
+	void init(VkDevice device, GpuAllocator* allocator, PipelineCache* pipelineCache, const std::vector<char>& shaderCode, bool storageImageExtendedFormats);
+
+	void cleanup();
+
+	//(Re)creates the pyramid for a depth attachment of the given size. depthView must only have the depth aspect, and
+	//the image SAMPLED usage. Only call while the GPU uses neither the old pyramid nor the depth attachment.
+	void create(VkImage depthImage, VkImageView depthView, VkFormat depthFormat, uint32_t width, uint32_t height);
+
+	void destroy();
+
+	//Moves a new pyramid to VK_IMAGE_LAYOUT_GENERAL and clears it to the far plane, where it occludes nothing.
+	void recordReset(VkCommandBuffer commandBuffer);
+
+	//Must be recorded after the render pass that wrote the depth attachment (which it expects, and leaves, in
+	//VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL). viewProjection is the column-major matrix the depth was
+	//rendered with.
+	void recordBuild(VkCommandBuffer commandBuffer, const float* viewProjection);
+
+	//Forgets the last build, e.g. when the pyramid stops being rebuilt every frame and its depth would go stale.
+	void invalidate() { built = false; }
+
+	bool isSupported() const { return pipeline != VK_NULL_HANDLE; }
+
+	//True once a build has been recorded since create() or invalidate().
+	bool isBuilt() const { return built; }
+
+	//The view-projection of the last build.
+	const float* getViewProjection() const { return viewProjection; }
+
+	VkImageView getView() const { return view; }
+
+	VkSampler getSampler() const { return sampler; }
+
+	uint32_t getWidth() const { return width; }
+
+	uint32_t getHeight() const { return height; }
+
+	uint32_t getLevelCount() const { return static_cast<uint32_t>(levelViews.size()); }
+
+private:
+	//Matches ReduceConstants in DepthPyramid.comp.
+	struct ReduceConstants {
+
+		int32_t sourceSize[2];
+		int32_t destinationSize[2];
+		uint32_t sourceIsDepth;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	GpuAllocator* allocator = nullptr;
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	//Nearest filtering & clamping: the reduction reads exact texels and the culling samples exact levels.
+	VkSampler sampler = VK_NULL_HANDLE;
+
+	VkImage depthImage = VK_NULL_HANDLE;
+	VkImageAspectFlags depthAspects = VK_IMAGE_ASPECT_DEPTH_BIT;
+	uint32_t depthWidth = 0;
+	uint32_t depthHeight = 0;
+
+	VkImage image = VK_NULL_HANDLE;
+	GpuAllocation allocation;
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	//Every level, for the culling.
+	VkImageView view = VK_NULL_HANDLE;
+
+	//One per level: written as a storage image, then read by the next level.
+	std::vector<VkImageView> levelViews;
+
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+
+	//One per level: the depth attachment or the level above, and the level.
+	std::vector<VkDescriptorSet> descriptorSets;
+
+	bool built = false;
+	float viewProjection[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+};
@@ -0,0 +1,54 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+
+Frustum Frustum::fromViewProjection(const float* matrix){
+
+	//Row r of the matrix; clip space is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+	auto row = [matrix](int r, int column) { return matrix[column * 4 + r]; };
+
+	Frustum frustum;
+
+	for (int column = 0; column < 4; column++) {
+
+		frustum.planes[Left][column] = row(3, column) + row(0, column);
+		frustum.planes[Right][column] = row(3, column) - row(0, column);
+		frustum.planes[Bottom][column] = row(3, column) + row(1, column);
+		frustum.planes[Top][column] = row(3, column) - row(1, column);
+		frustum.planes[Near][column] = row(2, column);
+		frustum.planes[Far][column] = row(3, column) - row(2, column);
+	}
+
+
+	//Normalized, so plane distances compare against sphere radii.
+	for (int plane = 0; plane < PLANE_COUNT; plane++) {
+
+		float* p = frustum.planes[plane];
+		float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+
+		if (length > 0.0f) {
+
+			for (int i = 0; i < 4; i++) {
+				p[i] /= length;
+			}
+		}
+	}
+
+	return frustum;
+}
+
+
+bool Frustum::intersectsSphere(const float center[3], float radius) const{
+
+	for (int plane = 0; plane < PLANE_COUNT; plane++) {
+
+		const float* p = planes[plane];
+
+		if (p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3] < -radius) {
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+
+//The six clip planes of a view-projection, as (nx, ny, nz, d) with normalized, inward-facing normals: a point p is inside
+//a plane when nx * px + ny * py + nz * pz + d >= 0. Planes are in whatever space the matrix maps from (world space for
+//proj * view).
+struct Frustum {
+
+	enum Plane { Left, Right, Bottom, Top, Near, Far, PLANE_COUNT };
+
+	float planes[PLANE_COUNT][4];
+
+	//Extracts the planes from a column-major 4x4 matrix (glm's layout) with Vulkan's 0..1 clip depth.
+	static Frustum fromViewProjection(const float* matrix);
+
+	//True unless the sphere lies entirely outside one of the planes.
+	bool intersectsSphere(const float center[3], float radius) const;
+};
@@ -0,0 +1,466 @@
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include "CpuTracer.h"
+#include "SimdTarget.h"
+
+#include <stdexcept>
+#include <cmath>
+#include <cstring>
+
+
+void BoundingSpheres::resize(size_t count){
+
+	centerX.resize(count);
+	centerY.resize(count);
+	centerZ.resize(count);
+	radius.resize(count);
+}
+
+
+void BoundingSpheres::set(size_t index, const float center[3], float sphereRadius){
+
+	centerX[index] = center[0];
+	centerY[index] = center[1];
+	centerZ[index] = center[2];
+	radius[index] = sphereRadius;
+}
+
+
+void BoundingBoxes::resize(size_t count){
+
+	centerX.resize(count);
+	centerY.resize(count);
+	centerZ.resize(count);
+	extentX.resize(count);
+	extentY.resize(count);
+	extentZ.resize(count);
+}
+
+
+void BoundingBoxes::set(size_t index, const float min[3], const float max[3]){
+
+	centerX[index] = 0.5f * (min[0] + max[0]);
+	centerY[index] = 0.5f * (min[1] + max[1]);
+	centerZ[index] = 0.5f * (min[2] + max[2]);
+	extentX[index] = 0.5f * (max[0] - min[0]);
+	extentY[index] = 0.5f * (max[1] - min[1]);
+	extentZ[index] = 0.5f * (max[2] - min[2]);
+}
+
+
+bool FrustumCuller::isSupported(Isa isa){
+
+	switch (isa) {
+
+	case Isa::Scalar:
+		return true;
+
+#ifdef VOLCANIC_SIMD_X86
+	//Every x86 target the project builds for has SSE2.
+	case Isa::Sse:
+		return true;
+
+	case Isa::Avx: {
+
+#ifdef _MSC_VER
+		//AVX needs the CPU feature and the OS saving the YMM registers on context switches.
+		int info[4];
+		__cpuid(info, 1);
+
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+
+		return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+		//Checks OS support as well.
+		return __builtin_cpu_supports("avx") != 0;
+#endif
+	}
+#endif
+
+	default:
+		return false;
+	}
+}
+
+
+FrustumCuller::Isa FrustumCuller::getBestIsa(){
+
+	static const Isa best = isSupported(Isa::Avx) ? Isa::Avx : isSupported(Isa::Sse) ? Isa::Sse : Isa::Scalar;
+
+	return best;
+}
+
+
+const char* FrustumCuller::getIsaName(Isa isa){
+
+	switch (isa) {
+
+	case Isa::Sse:
+		return "sse";
+
+	case Isa::Avx:
+		return "avx";
+
+	default:
+		return "scalar";
+	}
+}
+
+
+void FrustumCuller::cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible, Isa isa, bool parallel){
+
+	TRACE_FUNCTION();
+
+	if (!isSupported(isa)) {
+		throw std::runtime_error("Frustum culling ISA not supported!");
+	}
+
+	SphereKernel kernel = isa == Isa::Avx ? cullSpheresAvx : isa == Isa::Sse ? cullSpheresSse : cullSpheresScalar;
+
+	cull(kernel, frustum, spheres, static_cast<uint32_t>(spheres.size()), visible, parallel);
+}
+
+
+void FrustumCuller::cullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint32_t>& visible, Isa isa, bool parallel){
+
+	TRACE_FUNCTION();
+
+	if (!isSupported(isa)) {
+		throw std::runtime_error("Frustum culling ISA not supported!");
+	}
+
+	BoxKernel kernel = isa == Isa::Avx ? cullBoxesAvx : isa == Isa::Sse ? cullBoxesSse : cullBoxesScalar;
+
+	cull(kernel, frustum, boxes, static_cast<uint32_t>(boxes.size()), visible, parallel);
+}
+
+
+template<typename Kernel, typename Volumes>
+void FrustumCuller::cull(Kernel kernel, const Frustum& frustum, const Volumes& volumes, uint32_t count, std::vector<uint32_t>& visible, bool parallel){
+
+	//Every chunk writes from the start of its own range, so no two jobs share an output index.
+	visible.resize(count);
+
+	uint32_t chunkCount = (count + OBJECTS_PER_JOB - 1) / OBJECTS_PER_JOB;
+	std::vector<uint32_t> chunkVisibleCounts(chunkCount);
+
+	auto cullChunks = [&](uint32_t beginChunk, uint32_t endChunk) {
+
+		for (uint32_t chunk = beginChunk; chunk < endChunk; chunk++) {
+
+			uint32_t begin = chunk * OBJECTS_PER_JOB;
+			uint32_t end = std::min(begin + OBJECTS_PER_JOB, count);
+
+			chunkVisibleCounts[chunk] = kernel(frustum, volumes, begin, end, visible.data() + begin);
+		}
+	};
+
+	if (parallel) {
+		JobSystem::getDefault().parallelFor(chunkCount, 1, cullChunks);
+	}
+	else {
+		cullChunks(0, chunkCount);
+	}
+
+
+	//Chunk 0 is already in place; the others move down behind it.
+	uint32_t visibleCount = chunkCount > 0 ? chunkVisibleCounts[0] : 0;
+
+	for (uint32_t chunk = 1; chunk < chunkCount; chunk++) {
+
+		memmove(visible.data() + visibleCount, visible.data() + chunk * OBJECTS_PER_JOB, chunkVisibleCounts[chunk] * sizeof(uint32_t));
+		visibleCount += chunkVisibleCounts[chunk];
+	}
+
+	visible.resize(visibleCount);
+}
+
+
+//The scalar kernels evaluate the plane equations in the same order as the SIMD ones, so all ISAs agree bit for bit.
+uint32_t FrustumCuller::cullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end, uint32_t* visible){
+
+	uint32_t visibleCount = 0;
+
+	for (uint32_t i = begin; i < end; i++) {
+
+		float x = spheres.centerX[i];
+		float y = spheres.centerY[i];
+		float z = spheres.centerZ[i];
+		float negativeRadius = -spheres.radius[i];
+
+		bool inside = true;
+
+		for (int plane = 0; plane < Frustum::PLANE_COUNT && inside; plane++) {
+
+			const float* p = frustum.planes[plane];
+			inside = p[0] * x + p[1] * y + p[2] * z + p[3] >= negativeRadius;
+		}
+
+		visible[visibleCount] = i;
+		visibleCount += inside ? 1 : 0;
+	}
+
+	return visibleCount;
+}
+
+
+uint32_t FrustumCuller::cullBoxesScalar(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t begin, uint32_t end, uint32_t* visible){
+
+	uint32_t visibleCount = 0;
+
+	for (uint32_t i = begin; i < end; i++) {
+
+		bool inside = true;
+
+		//The box reaches furthest along the plane's normal by |n| . extent.
+		for (int plane = 0; plane < Frustum::PLANE_COUNT && inside; plane++) {
+
+			const float* p = frustum.planes[plane];
+
+			float distance = p[0] * boxes.centerX[i] + p[1] * boxes.centerY[i] + p[2] * boxes.centerZ[i] + p[3];
+			float reach = std::fabs(p[0]) * boxes.extentX[i] + std::fabs(p[1]) * boxes.extentY[i] + std::fabs(p[2]) * boxes.extentZ[i];
+
+			inside = distance + reach >= 0.0f;
+		}
+
+		visible[visibleCount] = i;
+		visibleCount += inside ? 1 : 0;
+	}
+
+	return visibleCount;
+}
+
+
+#ifdef VOLCANIC_SIMD_X86
+
+uint32_t FrustumCuller::cullSpheresSse(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end, uint32_t* visible){
+
+	__m128 planes[Frustum::PLANE_COUNT][4];
+
+	for (int plane = 0; plane < Frustum::PLANE_COUNT; plane++) {
+		for (int i = 0; i < 4; i++) {
+			planes[plane][i] = _mm_set1_ps(frustum.planes[plane][i]);
+		}
+	}
+
+
+	uint32_t visibleCount = 0;
+	uint32_t i = begin;
+
+	for (; i + 4 <= end; i += 4) {
+
+		__m128 x = _mm_loadu_ps(&spheres.centerX[i]);
+		__m128 y = _mm_loadu_ps(&spheres.centerY[i]);
+		__m128 z = _mm_loadu_ps(&spheres.centerZ[i]);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (int plane = 0; plane < Frustum::PLANE_COUNT; plane++) {
+
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[plane][0], x), _mm_mul_ps(planes[plane][1], y)),
+				_mm_mul_ps(planes[plane][2], z)), planes[plane][3]);
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		//Branchless compaction: every lane writes, only visible ones advance.
+		int mask = _mm_movemask_ps(inside);
+
+		for (uint32_t lane = 0; lane < 4; lane++) {
+
+			visible[visibleCount] = i + lane;
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+
+	return visibleCount + cullSpheresScalar(frustum, spheres, i, end, visible + visibleCount);
+}
+
+
+uint32_t FrustumCuller::cullBoxesSse(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t begin, uint32_t end, uint32_t* visible){
+
+	__m128 planes[Frustum::PLANE_COUNT][4];
+	__m128 absolutePlanes[Frustum::PLANE_COUNT][3];
+
+	for (int plane = 0; plane < Frustum::PLANE_COUNT; plane++) {
+		for (int i = 0; i < 4; i++) {
+
+			planes[plane][i] = _mm_set1_ps(frustum.planes[plane][i]);
+
+			if (i < 3) {
+				absolutePlanes[plane][i] = _mm_set1_ps(std::fabs(frustum.planes[plane][i]));
+			}
+		}
+	}
+
+
+	uint32_t visibleCount = 0;
+	uint32_t i = begin;
+
+	for (; i + 4 <= end; i += 4) {
+
+		__m128 x = _mm_loadu_ps(&boxes.centerX[i]);
+		__m128 y = _mm_loadu_ps(&boxes.centerY[i]);
+		__m128 z = _mm_loadu_ps(&boxes.centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+		__m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+		__m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (int plane = 0; plane < Frustum::PLANE_COUNT; plane++) {
+
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[plane][0], x), _mm_mul_ps(planes[plane][1], y)),
+				_mm_mul_ps(planes[plane][2], z)), planes[plane][3]);
+			__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absolutePlanes[plane][0], ex), _mm_mul_ps(absolutePlanes[plane][1], ey)),
+				_mm_mul_ps(absolutePlanes[plane][2], ez));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+
+		for (uint32_t lane = 0; lane < 4; lane++) {
+
+			visible[visibleCount] = i + lane;
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+
+	return visibleCount + cullBoxesScalar(frustum, boxes, i, end, visible + visibleCount);
+}
+
+
+VOLCANIC_TARGET_AVX
+uint32_t FrustumCuller::cullSpheresAvx(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end, uint32_t* visible){
+
+	__m256 planes[Frustum::PLANE_COUNT][4];
+
+	for (int plane = 0; plane < Frustum::PLANE_COUNT; plane++) {
+		for (int i = 0; i < 4; i++) {
+			planes[plane][i] = _mm256_set1_ps(frustum.planes[plane][i]);
+		}
+	}
+
+
+	uint32_t visibleCount = 0;
+	uint32_t i = begin;
+
+	for (; i + 8 <= end; i += 8) {
+
+		__m256 x = _mm256_loadu_ps(&spheres.centerX[i]);
+		__m256 y = _mm256_loadu_ps(&spheres.centerY[i]);
+		__m256 z = _mm256_loadu_ps(&spheres.centerZ[i]);
+		__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for (int plane = 0; plane < Frustum::PLANE_COUNT; plane++) {
+
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[plane][0], x), _mm256_mul_ps(planes[plane][1], y)),
+				_mm256_mul_ps(planes[plane][2], z)), planes[plane][3]);
+
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+
+		for (uint32_t lane = 0; lane < 8; lane++) {
+
+			visible[visibleCount] = i + lane;
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+
+	//Leaving AVX code without clearing the upper halves stalls following SSE code on older CPUs.
+	_mm256_zeroupper();
+
+	return visibleCount + cullSpheresScalar(frustum, spheres, i, end, visible + visibleCount);
+}
+
+
+VOLCANIC_TARGET_AVX
+uint32_t FrustumCuller::cullBoxesAvx(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t begin, uint32_t end, uint32_t* visible){
+
+	__m256 planes[Frustum::PLANE_COUNT][4];
+	__m256 absolutePlanes[Frustum::PLANE_COUNT][3];
+
+	for (int plane = 0; plane < Frustum::PLANE_COUNT; plane++) {
+		for (int i = 0; i < 4; i++) {
+
+			planes[plane][i] = _mm256_set1_ps(frustum.planes[plane][i]);
+
+			if (i < 3) {
+				absolutePlanes[plane][i] = _mm256_set1_ps(std::fabs(frustum.planes[plane][i]));
+			}
+		}
+	}
+
+
+	uint32_t visibleCount = 0;
+	uint32_t i = begin;
+
+	for (; i + 8 <= end; i += 8) {
+
+		__m256 x = _mm256_loadu_ps(&boxes.centerX[i]);
+		__m256 y = _mm256_loadu_ps(&boxes.centerY[i]);
+		__m256 z = _mm256_loadu_ps(&boxes.centerZ[i]);
+		__m256 ex = _mm256_loadu_ps(&boxes.extentX[i]);
+		__m256 ey = _mm256_loadu_ps(&boxes.extentY[i]);
+		__m256 ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for (int plane = 0; plane < Frustum::PLANE_COUNT; plane++) {
+
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[plane][0], x), _mm256_mul_ps(planes[plane][1], y)),
+				_mm256_mul_ps(planes[plane][2], z)), planes[plane][3]);
+			__m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absolutePlanes[plane][0], ex), _mm256_mul_ps(absolutePlanes[plane][1], ey)),
+				_mm256_mul_ps(absolutePlanes[plane][2], ez));
+
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+
+		for (uint32_t lane = 0; lane < 8; lane++) {
+
+			visible[visibleCount] = i + lane;
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+
+	_mm256_zeroupper();
+
+	return visibleCount + cullBoxesScalar(frustum, boxes, i, end, visible + visibleCount);
+}
+
+#else
+
+//Without x86 intrinsics isSupported() only reports the scalar kernels, so these are never called.
+uint32_t FrustumCuller::cullSpheresSse(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end, uint32_t* visible){
+
+	return cullSpheresScalar(frustum, spheres, begin, end, visible);
+}
+
+
+uint32_t FrustumCuller::cullBoxesSse(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t begin, uint32_t end, uint32_t* visible){
+
+	return cullBoxesScalar(frustum, boxes, begin, end, visible);
+}
+
+
+uint32_t FrustumCuller::cullSpheresAvx(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end, uint32_t* visible){
+
+	return cullSpheresScalar(frustum, spheres, begin, end, visible);
+}
+
+
+uint32_t FrustumCuller::cullBoxesAvx(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t begin, uint32_t end, uint32_t* visible){
+
+	return cullBoxesScalar(frustum, boxes, begin, end, visible);
+}
+
+#endif
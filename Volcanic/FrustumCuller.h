@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "Frustum.h"
+
+
+//Bounding spheres as a structure of arrays, so a SIMD load picks up the same component of consecutive objects.
+struct BoundingSpheres {
+
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+
+	void resize(size_t count);
+
+	void set(size_t index, const float center[3], float sphereRadius);
+
+	size_t size() const { return radius.size(); }
+};
+
+
+//Axis-aligned boxes as center & half extents, a structure of arrays like BoundingSpheres.
+struct BoundingBoxes {
+
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> extentX;
+	std::vector<float> extentY;
+	std::vector<float> extentZ;
+
+	void resize(size_t count);
+
+	void set(size_t index, const float min[3], const float max[3]);
+
+	size_t size() const { return extentX.size(); }
+};
+
+
+//Tests bounding volumes against a frustum 1, 4 (SSE) or 8 (AVX) objects at a time. The ISA is picked at runtime, so one
+//build runs everywhere; the range is split into chunks culled on the job system and compacted afterwards.
+//A volume is visible unless it lies entirely outside one of the planes (conservative near the frustum's corners).
+class FrustumCuller {
+
+public:
+	enum class Isa { Scalar, Sse, Avx };
+
+	//Objects culled by one job. Each chunk writes its indices into its own range of the output, so chunks stay large
+	//enough for the compaction afterwards to be noise.
+	static constexpr uint32_t OBJECTS_PER_JOB = 8192;
+
+	static bool isSupported(Isa isa);
+
+	//AVX when the CPU & OS support it, otherwise SSE on x86 and scalar elsewhere.
+	static Isa getBestIsa();
+
+	static const char* getIsaName(Isa isa);
+
+	//Replaces visible with the indices of the visible spheres, in increasing order. Throws if the ISA is not supported.
+	static void cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible,
+		Isa isa = getBestIsa(), bool parallel = true);
+
+	static void cullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint32_t>& visible,
+		Isa isa = getBestIsa(), bool parallel = true);
+
+private:
+	//Kernels test [begin, end), write the visible indices to visible[0..] and return how many there were.
+	typedef uint32_t(*SphereKernel)(const Frustum&, const BoundingSpheres&, uint32_t begin, uint32_t end, uint32_t* visible);
+	typedef uint32_t(*BoxKernel)(const Frustum&, const BoundingBoxes&, uint32_t begin, uint32_t end, uint32_t* visible);
+
+	static uint32_t cullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end, uint32_t* visible);
+	static uint32_t cullSpheresSse(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end, uint32_t* visible);
+	static uint32_t cullSpheresAvx(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end, uint32_t* visible);
+
+	static uint32_t cullBoxesScalar(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t begin, uint32_t end, uint32_t* visible);
+	static uint32_t cullBoxesSse(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t begin, uint32_t end, uint32_t* visible);
+	static uint32_t cullBoxesAvx(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t begin, uint32_t end, uint32_t* visible);
+
+	//Runs kernel over chunks of [0, count) and packs the chunks' indices together.
+	template<typename Kernel, typename Volumes>
+	static void cull(Kernel kernel, const Frustum& frustum, const Volumes& volumes, uint32_t count, std::vector<uint32_t>& visible, bool parallel);
+};
@@ -0,0 +1,701 @@
+#include "GpuAllocator.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+#include <cstdio>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace {
+
+	uint32_t findLastSet(uint64_t value) {
+
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+	}
+
+
+	uint32_t findFirstSet(uint64_t value) {
+
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+
+GpuAllocator::Block::Block(VkDeviceSize size) : size(size){
+
+	for (auto& heads : freeHeads) {
+
+		for (auto& head : heads) {
+			head = INVALID_NODE;
+		}
+	}
+
+
+	uint32_t node = createNode();
+	nodes[node].offset = 0;
+	nodes[node].size = size;
+
+	insertFree(node);
+}
+
+
+uint32_t GpuAllocator::Block::createNode(){
+
+	if (!unusedNodes.empty()) {
+
+		uint32_t node = unusedNodes.back();
+		unusedNodes.pop_back();
+		nodes[node] = Node{};
+
+		return node;
+	}
+
+	nodes.push_back(Node{});
+
+	return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+
+void GpuAllocator::Block::releaseNode(uint32_t node){
+
+	//A size of 0 marks the node as unused for statistics.
+	nodes[node] = Node{};
+	unusedNodes.push_back(node);
+}
+
+
+void GpuAllocator::Block::mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl){
+
+	//Sizes below 256 bytes share the first level in linear steps, above that each power of two is split into SL_COUNT ranges.
+	if (size < (1ull << SMALL_SIZE_SHIFT)) {
+
+		fl = 0;
+		sl = static_cast<uint32_t>(size >> (SMALL_SIZE_SHIFT - SL_BITS));
+	}
+	else {
+
+		uint32_t lastSet = findLastSet(size);
+
+		fl = lastSet - SMALL_SIZE_SHIFT + 1;
+		sl = static_cast<uint32_t>(size >> (lastSet - SL_BITS)) ^ SL_COUNT;
+	}
+}
+
+
+void GpuAllocator::Block::insertFree(uint32_t node){
+
+	uint32_t fl, sl;
+	mapping(nodes[node].size, fl, sl);
+
+
+	uint32_t head = freeHeads[fl][sl];
+
+	nodes[node].free = true;
+	nodes[node].prevFree = INVALID_NODE;
+	nodes[node].nextFree = head;
+
+	if (head != INVALID_NODE) {
+		nodes[head].prevFree = node;
+	}
+
+	freeHeads[fl][sl] = node;
+	slBitmaps[fl] |= 1u << sl;
+	flBitmap |= 1ull << fl;
+}
+
+
+void GpuAllocator::Block::removeFree(uint32_t node){
+
+	uint32_t prev = nodes[node].prevFree;
+	uint32_t next = nodes[node].nextFree;
+
+	if (prev != INVALID_NODE) {
+		nodes[prev].nextFree = next;
+	}
+
+	if (next != INVALID_NODE) {
+		nodes[next].prevFree = prev;
+	}
+
+
+	if (prev == INVALID_NODE) {
+
+		uint32_t fl, sl;
+		mapping(nodes[node].size, fl, sl);
+
+		freeHeads[fl][sl] = next;
+
+		if (next == INVALID_NODE) {
+
+			slBitmaps[fl] &= ~(1u << sl);
+
+			if (slBitmaps[fl] == 0) {
+				flBitmap &= ~(1ull << fl);
+			}
+		}
+	}
+
+	nodes[node].free = false;
+	nodes[node].prevFree = INVALID_NODE;
+	nodes[node].nextFree = INVALID_NODE;
+}
+
+
+uint32_t GpuAllocator::Block::findFree(VkDeviceSize size) const{
+
+	//Round the request up to the next list boundary so every range in the chosen list is large enough (good fit).
+	if (size < (1ull << SMALL_SIZE_SHIFT)) {
+		size = alignUp(std::max<VkDeviceSize>(size, 1), 1ull << (SMALL_SIZE_SHIFT - SL_BITS));
+	}
+	else {
+		size += (1ull << (findLastSet(size) - SL_BITS)) - 1;
+	}
+
+
+	uint32_t fl, sl;
+	mapping(size, fl, sl);
+
+	if (fl >= FL_COUNT) {
+		return INVALID_NODE;
+	}
+
+
+	uint32_t slMap = sl < SL_COUNT ? slBitmaps[fl] & (~0u << sl) : 0;
+
+	if (slMap == 0) {
+
+		uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+
+		if (flMap == 0) {
+			return INVALID_NODE;
+		}
+
+		fl = findFirstSet(flMap);
+		slMap = slBitmaps[fl];
+	}
+
+	sl = findFirstSet(slMap);
+
+	return freeHeads[fl][sl];
+}
+
+
+uint32_t GpuAllocator::Block::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset){
+
+	//Searching for size + alignment - 1 guarantees the aligned range fits; the head of the exact-size list
+	//is also tried so large alignments don't force a new block when a suitably aligned range already exists.
+	uint32_t node = findFree(size + alignment - 1);
+
+	if (node == INVALID_NODE) {
+
+		node = findFree(size);
+
+		if (node == INVALID_NODE || alignUp(nodes[node].offset, alignment) + size > nodes[node].offset + nodes[node].size) {
+			return INVALID_NODE;
+		}
+	}
+
+	removeFree(node);
+
+
+	//Leading padding becomes its own free range. The previous physical node can't be free, free neighbours are always merged.
+	VkDeviceSize alignedOffset = alignUp(nodes[node].offset, alignment);
+	VkDeviceSize padding = alignedOffset - nodes[node].offset;
+
+	if (padding > 0) {
+
+		uint32_t front = createNode();
+
+		nodes[front].offset = nodes[node].offset;
+		nodes[front].size = padding;
+		nodes[front].prevPhysical = nodes[node].prevPhysical;
+		nodes[front].nextPhysical = node;
+
+		if (nodes[front].prevPhysical != INVALID_NODE) {
+			nodes[nodes[front].prevPhysical].nextPhysical = front;
+		}
+
+		nodes[node].prevPhysical = front;
+		nodes[node].offset = alignedOffset;
+		nodes[node].size -= padding;
+
+		insertFree(front);
+	}
+
+
+	//Return the tail to the free lists.
+	if (nodes[node].size > size) {
+
+		uint32_t back = createNode();
+
+		nodes[back].offset = nodes[node].offset + size;
+		nodes[back].size = nodes[node].size - size;
+		nodes[back].prevPhysical = node;
+		nodes[back].nextPhysical = nodes[node].nextPhysical;
+
+		if (nodes[back].nextPhysical != INVALID_NODE) {
+			nodes[nodes[back].nextPhysical].prevPhysical = back;
+		}
+
+		nodes[node].nextPhysical = back;
+		nodes[node].size = size;
+
+		insertFree(back);
+	}
+
+
+	allocationCount++;
+	offset = nodes[node].offset;
+
+	return node;
+}
+
+
+void GpuAllocator::Block::free(uint32_t node){
+
+	allocationCount--;
+
+
+	uint32_t prev = nodes[node].prevPhysical;
+
+	if (prev != INVALID_NODE && nodes[prev].free) {
+
+		removeFree(prev);
+
+		nodes[prev].size += nodes[node].size;
+		nodes[prev].nextPhysical = nodes[node].nextPhysical;
+
+		if (nodes[prev].nextPhysical != INVALID_NODE) {
+			nodes[nodes[prev].nextPhysical].prevPhysical = prev;
+		}
+
+		releaseNode(node);
+		node = prev;
+	}
+
+
+	uint32_t next = nodes[node].nextPhysical;
+
+	if (next != INVALID_NODE && nodes[next].free) {
+
+		removeFree(next);
+
+		nodes[node].size += nodes[next].size;
+		nodes[node].nextPhysical = nodes[next].nextPhysical;
+
+		if (nodes[node].nextPhysical != INVALID_NODE) {
+			nodes[nodes[node].nextPhysical].prevPhysical = node;
+		}
+
+		releaseNode(next);
+	}
+
+
+	insertFree(node);
+}
+
+
+void GpuAllocator::Block::addStats(GpuAllocatorStats& stats, VkDeviceSize& largestFreeRangeSum) const{
+
+	stats.blockCount++;
+	stats.blockBytes += size;
+
+	VkDeviceSize largestFreeRange = 0;
+
+	for (const auto& node : nodes) {
+
+		if (node.size == 0) {
+			continue;
+		}
+
+		if (node.free) {
+
+			stats.freeBytes += node.size;
+			largestFreeRange = std::max(largestFreeRange, node.size);
+		}
+		else {
+
+			stats.usedBytes += node.size;
+			stats.allocationCount++;
+		}
+	}
+
+	stats.largestFreeRange = std::max(stats.largestFreeRange, largestFreeRange);
+	largestFreeRangeSum += largestFreeRange;
+}
+
+
+void GpuAllocator::init(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize preferredBlockSize){
+
+	this->device = device;
+
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	bufferImageGranularity = deviceProperties.limits.bufferImageGranularity;
+	maxMemoryAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	pools.resize(memoryProperties.memoryTypeCount * 2);
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+
+		VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size;
+
+		//Small heaps (e.g. the 256MB host-visible device-local heap) get proportionally smaller blocks.
+		VkDeviceSize blockSize = heapSize <= 1024ull * 1024 * 1024 ? std::min(preferredBlockSize, heapSize / 8) : preferredBlockSize;
+
+		for (uint32_t j = 0; j < 2; j++) {
+
+			Pool& pool = pools[i * 2 + j];
+			pool.memoryTypeIndex = i;
+			pool.blockSize = blockSize;
+		}
+	}
+}
+
+
+void GpuAllocator::cleanup(){
+
+	for (auto& pool : pools) {
+
+		for (auto& block : pool.blocks) {
+
+			if (block) {
+				freeMemory(block->memory, block->mappedData != nullptr);
+			}
+		}
+	}
+
+	for (auto& allocation : dedicatedAllocations) {
+		freeMemory(allocation.memory, allocation.mappedData != nullptr);
+	}
+
+	pools.clear();
+	dedicatedAllocations.clear();
+}
+
+
+VkDeviceMemory GpuAllocator::allocateMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData){
+
+	if (memoryAllocationCount >= maxMemoryAllocationCount) {
+		throw std::runtime_error("Exceeded maxMemoryAllocationCount!");
+	}
+
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+
+	VkDeviceMemory memory;
+
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate device memory block!");
+	}
+
+	memoryAllocationCount++;
+
+
+	//Host-visible memory stays mapped for its whole lifetime, sub-allocations just offset into the mapping.
+	*mappedData = nullptr;
+
+	if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+
+		if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mappedData) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to map device memory block!");
+		}
+	}
+
+	return memory;
+}
+
+
+void GpuAllocator::freeMemory(VkDeviceMemory memory, bool mapped){
+
+	if (mapped) {
+		vkUnmapMemory(device, memory);
+	}
+
+	vkFreeMemory(device, memory, nullptr);
+	memoryAllocationCount--;
+}
+
+
+uint32_t GpuAllocator::getPoolIndex(uint32_t memoryTypeIndex, ResourceType resourceType) const{
+
+	bool separate = bufferImageGranularity > 1 && resourceType == ResourceType::Optimal;
+
+	return memoryTypeIndex * 2 + (separate ? 1 : 0);
+}
+
+
+GpuAllocation GpuAllocator::allocate(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, ResourceType resourceType){
+
+	GpuAllocation allocation{};
+	allocation.poolIndex = getPoolIndex(memoryTypeIndex, resourceType);
+	allocation.size = requirements.size;
+
+	Pool& pool = pools[allocation.poolIndex];
+
+
+	//Large resources get their own memory rather than wasting most of a block.
+	if (requirements.size > pool.blockSize / 2) {
+
+		allocation.memory = allocateMemory(requirements.size, memoryTypeIndex, &allocation.mappedData);
+		allocation.dedicated = true;
+
+		dedicatedAllocations.push_back(allocation);
+
+		return allocation;
+	}
+
+
+	uint32_t emptySlot = Block::INVALID_NODE;
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(pool.blocks.size()); i++) {
+
+		if (!pool.blocks[i]) {
+
+			emptySlot = i;
+			continue;
+		}
+
+
+		uint32_t node = pool.blocks[i]->allocate(requirements.size, requirements.alignment, allocation.offset);
+
+		if (node != Block::INVALID_NODE) {
+
+			allocation.memory = pool.blocks[i]->memory;
+			allocation.blockIndex = i;
+			allocation.node = node;
+			break;
+		}
+	}
+
+
+	//No block has room: create a new one, reusing the slot of a previously released block if there is one.
+	if (allocation.memory == VK_NULL_HANDLE) {
+
+		if (emptySlot == Block::INVALID_NODE) {
+
+			emptySlot = static_cast<uint32_t>(pool.blocks.size());
+			pool.blocks.emplace_back();
+		}
+
+
+		std::unique_ptr<Block> block = std::make_unique<Block>(pool.blockSize);
+		block->memory = allocateMemory(pool.blockSize, memoryTypeIndex, &block->mappedData);
+
+		allocation.node = block->allocate(requirements.size, requirements.alignment, allocation.offset);
+
+		if (allocation.node == Block::INVALID_NODE) {
+			throw std::runtime_error("Failed to sub-allocate from a new memory block!");
+		}
+
+		allocation.memory = block->memory;
+		allocation.blockIndex = emptySlot;
+
+		pool.blocks[emptySlot] = std::move(block);
+	}
+
+
+	if (pool.blocks[allocation.blockIndex]->mappedData != nullptr) {
+		allocation.mappedData = static_cast<char*>(pool.blocks[allocation.blockIndex]->mappedData) + allocation.offset;
+	}
+
+	return allocation;
+}
+
+
+void GpuAllocator::free(GpuAllocation& allocation){
+
+	if (allocation.memory == VK_NULL_HANDLE) {
+		return;
+	}
+
+
+	if (allocation.dedicated) {
+
+		auto it = std::find_if(dedicatedAllocations.begin(), dedicatedAllocations.end(), [&](const GpuAllocation& dedicated) { return dedicated.memory == allocation.memory; });
+
+		if (it != dedicatedAllocations.end()) {
+			dedicatedAllocations.erase(it);
+		}
+
+		freeMemory(allocation.memory, allocation.mappedData != nullptr);
+		allocation = GpuAllocation{};
+
+		return;
+	}
+
+
+	Pool& pool = pools[allocation.poolIndex];
+	std::unique_ptr<Block>& block = pool.blocks[allocation.blockIndex];
+
+	block->free(allocation.node);
+
+
+	//Keep one empty block per pool around so a free/allocate pair at a block boundary doesn't hit vkAllocateMemory every time.
+	if (block->isEmpty()) {
+
+		bool otherEmpty = false;
+
+		for (const auto& other : pool.blocks) {
+
+			if (other && other != block && other->isEmpty()) {
+				otherEmpty = true;
+			}
+		}
+
+		if (otherEmpty) {
+
+			freeMemory(block->memory, block->mappedData != nullptr);
+			block.reset();
+		}
+	}
+
+	allocation = GpuAllocation{};
+}
+
+
+uint32_t GpuAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const{
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+
+		if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+
+GpuAllocatorStats GpuAllocator::getPoolStats(const Pool& pool, VkDeviceSize& largestFreeRangeSum) const{
+
+	GpuAllocatorStats stats{};
+	VkDeviceSize poolLargestFreeRangeSum = 0;
+
+	for (const auto& block : pool.blocks) {
+
+		if (block) {
+			block->addStats(stats, poolLargestFreeRangeSum);
+		}
+	}
+
+	for (const auto& allocation : dedicatedAllocations) {
+
+		if (&pools[allocation.poolIndex] == &pool) {
+
+			stats.dedicatedAllocationCount++;
+			stats.allocationCount++;
+			stats.usedBytes += allocation.size;
+		}
+	}
+
+	stats.fragmentation = computeFragmentation(stats.freeBytes, poolLargestFreeRangeSum);
+	largestFreeRangeSum += poolLargestFreeRangeSum;
+
+	return stats;
+}
+
+
+double GpuAllocator::computeFragmentation(VkDeviceSize freeBytes, VkDeviceSize largestFreeRangeSum){
+
+	return freeBytes > 0 ? 1.0 - static_cast<double>(largestFreeRangeSum) / static_cast<double>(freeBytes) : 0.0;
+}
+
+
+GpuAllocatorStats GpuAllocator::getStats() const{
+
+	GpuAllocatorStats total{};
+	VkDeviceSize largestFreeRangeSum = 0;
+
+	for (const auto& pool : pools) {
+
+		GpuAllocatorStats stats = getPoolStats(pool, largestFreeRangeSum);
+
+		total.blockCount += stats.blockCount;
+		total.dedicatedAllocationCount += stats.dedicatedAllocationCount;
+		total.allocationCount += stats.allocationCount;
+		total.blockBytes += stats.blockBytes;
+		total.usedBytes += stats.usedBytes;
+		total.freeBytes += stats.freeBytes;
+		total.largestFreeRange = std::max(total.largestFreeRange, stats.largestFreeRange);
+	}
+
+	total.fragmentation = computeFragmentation(total.freeBytes, largestFreeRangeSum);
+
+	return total;
+}
+
+
+void GpuAllocator::printStats(std::ostream& out) const{
+
+	char buffer[256];
+
+	for (size_t i = 0; i < pools.size(); i++) {
+
+		VkDeviceSize largestFreeRangeSum = 0;
+		GpuAllocatorStats stats = getPoolStats(pools[i], largestFreeRangeSum);
+
+		if (stats.blockCount == 0 && stats.dedicatedAllocationCount == 0) {
+			continue;
+		}
+
+		snprintf(buffer, sizeof(buffer), "Memory type %u (%s): %u blocks, %u dedicated, %u allocations, %.2f MB used, %.2f MB free, %.1f%% fragmented",
+			pools[i].memoryTypeIndex, i % 2 == 0 ? "linear" : "optimal", stats.blockCount, stats.dedicatedAllocationCount, stats.allocationCount,
+			stats.usedBytes / (1024.0 * 1024.0), stats.freeBytes / (1024.0 * 1024.0), stats.fragmentation * 100.0);
+
+		out << buffer << "\n";
+	}
+
+
+	GpuAllocatorStats total = getStats();
+
+	snprintf(buffer, sizeof(buffer), "GPU memory total: %u vkAllocateMemory calls, %u allocations, %.2f MB used, %.2f MB free, %.1f%% fragmented",
+		memoryAllocationCount, total.allocationCount, total.usedBytes / (1024.0 * 1024.0), total.freeBytes / (1024.0 * 1024.0), total.fragmentation * 100.0);
+
+	out << buffer << std::endl;
+}
+
+
+void GpuAllocator::writeStatsJson(std::ostream& out) const{
+
+	GpuAllocatorStats stats = getStats();
+
+	char buffer[256];
+
+	snprintf(buffer, sizeof(buffer), "{\"blocks\":%u,\"dedicatedAllocations\":%u,\"allocations\":%u,\"blockBytes\":%llu,\"usedBytes\":%llu,\"freeBytes\":%llu,\"fragmentation\":%.4f}",
+		stats.blockCount, stats.dedicatedAllocationCount, stats.allocationCount, static_cast<unsigned long long>(stats.blockBytes),
+		static_cast<unsigned long long>(stats.usedBytes), static_cast<unsigned long long>(stats.freeBytes), stats.fragmentation);
+
+	out << buffer;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+#include <ostream>
+
+
+//A sub-allocation handed out by GpuAllocator. Bind with (memory, offset); mappedData is non-null for host-visible memory.
+struct GpuAllocation {
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mappedData = nullptr;
+
+	uint32_t poolIndex = 0;
+	uint32_t blockIndex = 0;
+	uint32_t node = 0;
+	bool dedicated = false;
+};
+
+
+struct GpuAllocatorStats {
+
+	uint32_t blockCount = 0;
+	uint32_t dedicatedAllocationCount = 0;
+	uint32_t allocationCount = 0;
+	VkDeviceSize blockBytes = 0;
+	VkDeviceSize usedBytes = 0;
+	VkDeviceSize freeBytes = 0;
+	VkDeviceSize largestFreeRange = 0;
+
+	//1 - (sum of every block's largest free range) / freeBytes: 0 when each block's free space is contiguous, approaching 1 as it splinters.
+	double fragmentation = 0.0;
+};
+
+
+//Carves buffers and images out of large VkDeviceMemory blocks, one set of blocks per memory type.
+//Every block is managed by a two-level segregated fit (TLSF) free list, so allocation and free are O(1).
+class GpuAllocator {
+
+public:
+	//Linear resources are buffers and linear-tiled images, optimal ones are optimal-tiled images.
+	//They are kept in separate blocks when bufferImageGranularity > 1, so neighbours never alias a granularity page.
+	enum class ResourceType { Linear, Optimal };
+
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize preferredBlockSize = 64ull * 1024 * 1024);
+
+	void cleanup();
+
+	GpuAllocation allocate(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, ResourceType resourceType);
+
+	void free(GpuAllocation& allocation);
+
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+	GpuAllocatorStats getStats() const;
+
+	//Per memory type and total statistics in a human-readable form.
+	void printStats(std::ostream& out) const;
+
+	//Total statistics as a JSON object, e.g. {"blocks":2,"usedBytes":...}
+	void writeStatsJson(std::ostream& out) const;
+
+private:
+	//TLSF over a single block. Nodes live in a vector and reference each other by index.
+	class Block {
+
+	public:
+		Block(VkDeviceSize size);
+
+		//Returns the node of the allocation, or INVALID_NODE if no free range fits.
+		uint32_t allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+
+		void free(uint32_t node);
+
+		bool isEmpty() const { return allocationCount == 0; }
+
+		void addStats(GpuAllocatorStats& stats, VkDeviceSize& largestFreeRangeSum) const;
+
+		static const uint32_t INVALID_NODE = ~0u;
+
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		void* mappedData = nullptr;
+
+	private:
+		struct Node {
+
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			uint32_t prevPhysical = INVALID_NODE;
+			uint32_t nextPhysical = INVALID_NODE;
+			uint32_t prevFree = INVALID_NODE;
+			uint32_t nextFree = INVALID_NODE;
+			bool free = false;
+		};
+
+		static const uint32_t SL_BITS = 5;
+		static const uint32_t SL_COUNT = 1 << SL_BITS;
+		static const uint32_t SMALL_SIZE_SHIFT = 8;
+		static const uint32_t FL_COUNT = 64 - SMALL_SIZE_SHIFT + 1;
+
+		std::vector<Node> nodes;
+		std::vector<uint32_t> unusedNodes;
+
+		uint64_t flBitmap = 0;
+		uint32_t slBitmaps[FL_COUNT] = {};
+		uint32_t freeHeads[FL_COUNT][SL_COUNT];
+
+		uint32_t allocationCount = 0;
+
+		uint32_t createNode();
+		void releaseNode(uint32_t node);
+
+		static void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl);
+
+		void insertFree(uint32_t node);
+		void removeFree(uint32_t node);
+		uint32_t findFree(VkDeviceSize size) const;
+	};
+
+	struct Pool {
+
+		uint32_t memoryTypeIndex = 0;
+		VkDeviceSize blockSize = 0;
+		std::vector<std::unique_ptr<Block>> blocks;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	VkDeviceSize bufferImageGranularity = 1;
+	uint32_t maxMemoryAllocationCount = 0;
+	uint32_t memoryAllocationCount = 0;
+
+	//Indexed by memoryTypeIndex * 2 + (optimal ? 1 : 0); both halves share the linear pool when granularity is 1.
+	std::vector<Pool> pools;
+
+	//Dedicated allocations for resources too large to share a block.
+	std::vector<GpuAllocation> dedicatedAllocations;
+
+	VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData);
+
+	void freeMemory(VkDeviceMemory memory, bool mapped);
+
+	uint32_t getPoolIndex(uint32_t memoryTypeIndex, ResourceType resourceType) const;
+
+	GpuAllocatorStats getPoolStats(const Pool& pool, VkDeviceSize& largestFreeRangeSum) const;
+
+	static double computeFragmentation(VkDeviceSize freeBytes, VkDeviceSize largestFreeRangeSum);
+};
@@ -0,0 +1,535 @@
+#include "GpuCuller.h"
+#include "CpuTracer.h"
+
+#include <stdexcept>
+#include <array>
+#include <cstring>
+#include <algorithm>
+
+
+void GpuCuller::init(VkDevice device, VkPhysicalDevice physicalDevice, GpuAllocator* allocator, PipelineCache* pipelineCache,
+	const std::vector<char>& shaderCode, uint32_t frameCount, bool multiDrawIndirect){
+
+	TRACE_FUNCTION();
+
+	this->device = device;
+	this->allocator = allocator;
+	this->multiDrawIndirect = multiDrawIndirect;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	maxWorkGroupCount = deviceProperties.limits.maxComputeWorkGroupCount[0];
+
+
+	//Instances, visible instances, draw commands & statistics, then the frame's uniforms, the depth pyramid and the
+	//cluster slots.
+	std::array<VkDescriptorSetLayoutBinding, 7> bindings{};
+
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create culling descriptor set layout!");
+	}
+
+
+	std::array<VkDescriptorPoolSize, 3> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[0].descriptorCount = frameCount * 5;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[1].descriptorCount = frameCount;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[2].descriptorCount = frameCount;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = frameCount;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create culling descriptor pool!");
+	}
+
+
+	frames.resize(frameCount);
+
+	std::vector<VkDescriptorSetLayout> layouts(frameCount, descriptorSetLayout);
+	std::vector<VkDescriptorSet> descriptorSets(frameCount);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = frameCount;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to allocate culling descriptor sets!");
+	}
+
+	//The statistics & uniforms don't depend on the draws, so they live as long as the culler.
+	for (uint32_t i = 0; i < frameCount; i++) {
+
+		Frame& frame = frames[i];
+		frame.descriptorSet = descriptorSets[i];
+
+		frame.statisticsBuffer = createBuffer(sizeof(StatisticsCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		frame.frameBuffer = createBuffer(sizeof(CullFrame), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+
+		std::array<VkDescriptorBufferInfo, 2> bufferInfos{};
+		bufferInfos[0] = { frame.statisticsBuffer.buffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { frame.frameBuffer.buffer, 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+
+		for (uint32_t j = 0; j < descriptorWrites.size(); j++) {
+
+			descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[j].dstSet = frame.descriptorSet;
+			descriptorWrites[j].dstBinding = 3 + j;
+			descriptorWrites[j].dstArrayElement = 0;
+			descriptorWrites[j].descriptorCount = 1;
+			descriptorWrites[j].pBufferInfo = &bufferInfos[j];
+		}
+
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create culling pipeline layout!");
+	}
+
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = shaderCode.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+	VkShaderModule shaderModule;
+
+	if (vkCreateShaderModule(device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create culling shader module!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+
+	VkResult result = pipelineCache->createComputePipelines(1, &pipelineInfo, &pipeline);
+
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create culling pipeline!");
+	}
+}
+
+
+void GpuCuller::cleanup(){
+
+	destroyBuffers();
+
+	for (Frame& frame : frames) {
+
+		destroyBuffer(frame.statisticsBuffer);
+		destroyBuffer(frame.frameBuffer);
+	}
+
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+
+	frames.clear();
+	draws.clear();
+}
+
+
+void GpuCuller::setDraws(VkBuffer instanceBuffer, uint32_t instanceCount, const std::vector<CulledDraw>& draws){
+
+	TRACE_FUNCTION();
+
+	destroyBuffers();
+
+	this->draws = draws;
+
+
+	std::vector<VkDrawIndexedIndirectCommand> commands(draws.size());
+	VkDeviceSize visibleCount = 0;
+
+	for (size_t i = 0; i < draws.size(); i++) {
+
+		//One invocation per instance, all in a single dispatch.
+		if ((draws[i].instanceCount + LOCAL_SIZE - 1) / LOCAL_SIZE > maxWorkGroupCount) {
+
+			throw std::runtime_error("Too many instances in one culled draw!");
+		}
+
+		//The shader reads every instance of the draw.
+		if (static_cast<uint64_t>(draws[i].firstInstance) + draws[i].instanceCount > instanceCount) {
+
+			throw std::runtime_error("Culled draw's instances exceed the instance buffer!");
+		}
+
+		commands[i].indexCount = draws[i].indexCount;
+		commands[i].instanceCount = 0;
+		commands[i].firstIndex = draws[i].firstIndex;
+		commands[i].vertexOffset = draws[i].vertexOffset;
+		commands[i].firstInstance = draws[i].firstVisible;
+
+		visibleCount = std::max<VkDeviceSize>(visibleCount, static_cast<VkDeviceSize>(draws[i].firstVisible) + draws[i].instanceCount);
+	}
+
+
+	//Zero-sized buffers are not allowed.
+	VkDeviceSize visibleBytes = std::max<VkDeviceSize>(visibleCount, 1) * sizeof(InstanceTransform);
+	VkDeviceSize commandBytes = std::max<VkDeviceSize>(commands.size(), 1) * sizeof(VkDrawIndexedIndirectCommand);
+	VkDeviceSize readbackBytes = commands.size() * sizeof(VkDrawIndexedIndirectCommand) + sizeof(StatisticsCounters);
+
+	templateBuffer = createBuffer(commandBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	if (!commands.empty()) {
+		memcpy(templateBuffer.allocation.mappedData, commands.data(), commands.size() * sizeof(VkDrawIndexedIndirectCommand));
+	}
+
+
+	for (Frame& frame : frames) {
+
+		frame.visibleInstanceBuffer = createBuffer(visibleBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		frame.drawCommandBuffer = createBuffer(commandBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+			| VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		frame.readbackBuffer = createBuffer(readbackBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		//Nothing was culled before the frame's first submission.
+		memset(frame.readbackBuffer.allocation.mappedData, 0, readbackBytes);
+
+
+		std::array<VkDescriptorBufferInfo, 3> bufferInfos{};
+		bufferInfos[0] = { instanceBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { frame.visibleInstanceBuffer.buffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[2] = { frame.drawCommandBuffer.buffer, 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+
+		for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+
+			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[i].dstSet = frame.descriptorSet;
+			descriptorWrites[i].dstBinding = i;
+			descriptorWrites[i].dstArrayElement = 0;
+			descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[i].descriptorCount = 1;
+			descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+
+void GpuCuller::setDepthPyramid(const DepthPyramid& depthPyramid){
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = depthPyramid.getSampler();
+	imageInfo.imageView = depthPyramid.getView();
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	for (Frame& frame : frames) {
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = frame.descriptorSet;
+		descriptorWrite.dstBinding = 5;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+	}
+}
+
+
+void GpuCuller::setClusterSlots(const ClusterCuller& clusterCuller){
+
+	for (uint32_t i = 0; i < frames.size(); i++) {
+
+		VkDescriptorBufferInfo bufferInfo{ clusterCuller.getSlotBuffer(i), 0, VK_WHOLE_SIZE };
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = frames[i].descriptorSet;
+		descriptorWrite.dstBinding = 6;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pBufferInfo = &bufferInfo;
+
+		vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+	}
+}
+
+
+void GpuCuller::recordCulling(VkCommandBuffer commandBuffer, uint32_t frame, const Frustum& frustum, const DepthPyramid* occluder, float lodScale,
+	uint32_t clusterSlotCount){
+
+	if (draws.empty()) {
+		return;
+	}
+
+	Frame& target = frames[frame];
+	VkDeviceSize commandBytes = draws.size() * sizeof(VkDrawIndexedIndirectCommand);
+
+
+	//The frame's previous submission has finished, so its uniforms can be overwritten.
+	CullFrame& frameUniforms = *static_cast<CullFrame*>(target.frameBuffer.allocation.mappedData);
+	memcpy(frameUniforms.frustumPlanes, frustum.planes, sizeof(frameUniforms.frustumPlanes));
+	frameUniforms.lodScale = lodScale;
+	frameUniforms.clusterSlotCount = clusterSlotCount;
+
+	if (occluder != nullptr && occluder->isBuilt()) {
+
+		memcpy(frameUniforms.occlusionViewProjection, occluder->getViewProjection(), sizeof(frameUniforms.occlusionViewProjection));
+		frameUniforms.pyramidSize[0] = static_cast<float>(occluder->getWidth());
+		frameUniforms.pyramidSize[1] = static_cast<float>(occluder->getHeight());
+		frameUniforms.pyramidLevelCount = occluder->getLevelCount();
+	}
+	else {
+
+		frameUniforms.pyramidLevelCount = 0;
+	}
+
+
+	//The instance counts and statistics start at 0; the shader's atomics count the survivors and the culled.
+	VkBufferCopy resetRegion{ 0, 0, commandBytes };
+	vkCmdCopyBuffer(commandBuffer, templateBuffer.buffer, target.drawCommandBuffer.buffer, 1, &resetRegion);
+	vkCmdFillBuffer(commandBuffer, target.statisticsBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+	std::array<VkBufferMemoryBarrier, 2> resetBarriers{};
+
+	for (VkBufferMemoryBarrier& barrier : resetBarriers) {
+
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+	}
+
+	resetBarriers[0].buffer = target.drawCommandBuffer.buffer;
+	resetBarriers[1].buffer = target.statisticsBuffer.buffer;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr,
+		static_cast<uint32_t>(resetBarriers.size()), resetBarriers.data(), 0, nullptr);
+
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &target.descriptorSet, 0, nullptr);
+
+	CullConstants constants{};
+
+	for (uint32_t i = 0; i < draws.size(); i++) {
+
+		if (draws[i].instanceCount == 0) {
+			continue;
+		}
+
+		memcpy(constants.boundingSphere, draws[i].boundingSphere, sizeof(constants.boundingSphere));
+		constants.firstInstance = draws[i].firstInstance;
+		constants.instanceCount = draws[i].instanceCount;
+		constants.drawIndex = i;
+		constants.firstVisible = draws[i].firstVisible;
+		memcpy(constants.lodErrors, draws[i].lodErrors, sizeof(constants.lodErrors));
+		constants.hasMeshlets = draws[i].hasMeshlets ? 1 : 0;
+
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+		vkCmdDispatch(commandBuffer, (draws[i].instanceCount + LOCAL_SIZE - 1) / LOCAL_SIZE, 1, 1);
+	}
+
+
+	//The draws read the commands & visible instances, the readback copy reads the commands & statistics.
+	std::array<VkBufferMemoryBarrier, 3> cullBarriers{};
+
+	for (VkBufferMemoryBarrier& barrier : cullBarriers) {
+
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+	}
+
+	cullBarriers[0].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	cullBarriers[0].buffer = target.drawCommandBuffer.buffer;
+	cullBarriers[1].dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	cullBarriers[1].buffer = target.visibleInstanceBuffer.buffer;
+	cullBarriers[2].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	cullBarriers[2].buffer = target.statisticsBuffer.buffer;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, static_cast<uint32_t>(cullBarriers.size()), cullBarriers.data(), 0, nullptr);
+
+
+	vkCmdCopyBuffer(commandBuffer, target.drawCommandBuffer.buffer, target.readbackBuffer.buffer, 1, &resetRegion);
+
+	VkBufferCopy statisticsRegion{ 0, commandBytes, sizeof(StatisticsCounters) };
+	vkCmdCopyBuffer(commandBuffer, target.statisticsBuffer.buffer, target.readbackBuffer.buffer, 1, &statisticsRegion);
+
+	VkBufferMemoryBarrier readbackBarrier = resetBarriers[0];
+	readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	readbackBarrier.buffer = target.readbackBuffer.buffer;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &readbackBarrier, 0, nullptr);
+}
+
+
+void GpuCuller::recordDraws(VkCommandBuffer commandBuffer, uint32_t frame) const{
+
+	if (draws.empty()) {
+		return;
+	}
+
+	VkBuffer drawCommandBuffer = frames[frame].drawCommandBuffer.buffer;
+	uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	if (multiDrawIndirect) {
+
+		vkCmdDrawIndexedIndirect(commandBuffer, drawCommandBuffer, 0, static_cast<uint32_t>(draws.size()), stride);
+	}
+	else {
+
+		for (uint32_t i = 0; i < draws.size(); i++) {
+			vkCmdDrawIndexedIndirect(commandBuffer, drawCommandBuffer, i * stride, 1, stride);
+		}
+	}
+}
+
+
+CullStatistics GpuCuller::readStatistics(uint32_t frame) const{
+
+	CullStatistics statistics;
+
+	if (draws.empty()) {
+		return statistics;
+	}
+
+	const VkDrawIndexedIndirectCommand* commands = static_cast<const VkDrawIndexedIndirectCommand*>(frames[frame].readbackBuffer.allocation.mappedData);
+
+	for (size_t i = 0; i < draws.size(); i++) {
+
+		statistics.visibleCount += commands[i].instanceCount;
+		statistics.drawnTriangleCount += static_cast<uint64_t>(commands[i].instanceCount) * (draws[i].indexCount / 3);
+	}
+
+	StatisticsCounters counters;
+	memcpy(&counters, commands + draws.size(), sizeof(counters));
+
+	statistics.frustumCulledCount = counters.frustumCulledCount;
+	statistics.occlusionCulledCount = counters.occlusionCulledCount;
+
+	return statistics;
+}
+
+
+GpuCuller::Buffer GpuCuller::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties){
+
+	Buffer buffer;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer.buffer) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create culling buffer!");
+	}
+
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer.buffer, &memRequirements);
+
+	uint32_t memoryType = allocator->findMemoryType(memRequirements.memoryTypeBits, properties);
+
+	buffer.allocation = allocator->allocate(memRequirements, memoryType, GpuAllocator::ResourceType::Linear);
+
+	vkBindBufferMemory(device, buffer.buffer, buffer.allocation.memory, buffer.allocation.offset);
+
+	return buffer;
+}
+
+
+void GpuCuller::destroyBuffer(Buffer& buffer){
+
+	if (buffer.buffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkDestroyBuffer(device, buffer.buffer, nullptr);
+	allocator->free(buffer.allocation);
+
+	buffer.buffer = VK_NULL_HANDLE;
+}
+
+
+void GpuCuller::destroyBuffers(){
+
+	destroyBuffer(templateBuffer);
+
+	for (Frame& frame : frames) {
+
+		destroyBuffer(frame.visibleInstanceBuffer);
+		destroyBuffer(frame.drawCommandBuffer);
+		destroyBuffer(frame.readbackBuffer);
+	}
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+#include "GpuAllocator.h"
+#include "PipelineCache.h"
+#include "Frustum.h"
+#include "Scene.h"
+#include "DepthPyramid.h"
+#include "ClusterCuller.h"
+
+
+//One indexed draw whose instances are culled on the GPU: the mesh's index range, its instances' range of the instance
+//buffer, where its survivors start in the visible instance buffer and the mesh's bounding sphere (center & radius,
+//before the instance transform).
+//A mesh with levels of detail has a draw per level over the same instances (and their own visible ranges); lodErrors
+//holds the level's error and the next coarser level's (negative for the last), so each instance is drawn by one level.
+//Survivors of a draw with hasMeshlets (the full mesh's) may be cluster culled instead.
+struct CulledDraw {
+
+	uint32_t indexCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t firstInstance = 0;
+	uint32_t instanceCount = 0;
+	uint32_t firstVisible = 0;
+	float boundingSphere[4] = {};
+	float lodErrors[2] = { 0.0f, -1.0f };
+	bool hasMeshlets = false;
+};
+
+
+//What a frame's culling did with the instances it tested.
+struct CullStatistics {
+
+	uint32_t visibleCount = 0;
+	uint32_t frustumCulledCount = 0;
+	uint32_t occlusionCulledCount = 0;
+
+	//Triangles of the visible instances' draws (at their levels of detail).
+	uint64_t drawnTriangleCount = 0;
+};
+
+
+//GPU-driven drawing of instanced meshes. Every frame a compute pass tests each instance's bounding sphere against the
+//frustum and, optionally, against a DepthPyramid of the previous frame's depth, and appends the survivors to the
+//frame's visible instance buffer (each draw keeps its own range of it), counting them into a
+//VkDrawIndexedIndirectCommand per draw. The graphics pass reads the visible instances as its
+//instance stream and draws with vkCmdDrawIndexedIndirect, so the CPU records the same few commands however many
+//instances the scene has. Buffers written by the GPU are per frame in flight.
+class GpuCuller {
+
+public:
+	//Invocations per workgroup, as declared by Cull.comp.
+	static constexpr uint32_t LOCAL_SIZE = 64;
+
+	//multiDrawIndirect must be the device feature's enabled state; without it every draw is its own indirect call.
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, GpuAllocator* allocator, PipelineCache* pipelineCache,
+		const std::vector<char>& shaderCode, uint32_t frameCount, bool multiDrawIndirect);
+
+	void cleanup();
+
+	//(Re)creates the buffers for the given draws of instanceBuffer, which needs STORAGE_BUFFER usage and holds
+	//instanceCount instances. Throws if a draw's instances don't fit in it. Only call while the GPU uses none of the
+	//culler's buffers.
+	void setDraws(VkBuffer instanceBuffer, uint32_t instanceCount, const std::vector<CulledDraw>& draws);
+
+	//Binds the pyramid the occlusion test samples. Must be called before the first culling, and again whenever the
+	//pyramid is recreated, while the GPU uses none of the culler's descriptor sets.
+	void setDepthPyramid(const DepthPyramid& depthPyramid);
+
+	//Binds the slots the survivors of draws with meshlets claim. Must be called once after both init(), with the same
+	//number of frames in flight.
+	void setClusterSlots(const ClusterCuller& clusterCuller);
+
+	//Resets the frame's draw commands and culls into them. Must be recorded outside of a render pass, before the draws.
+	//Instances are also tested against occluder's last build, unless it is null or hasn't been built. That depth is a
+	//frame old, so an instance uncovered by the camera's motion since then may appear a frame late.
+	//lodScale turns a level's error at a distance of 1 from the near plane into allowed pixels of error; each instance
+	//is drawn with the coarsest level within that.
+	//Up to clusterSlotCount survivors of draws with meshlets are put in the cluster culler's slots rather than drawn
+	//here; the slots must have been reset (ClusterCuller::recordSlotReset) for the frame.
+	void recordCulling(VkCommandBuffer commandBuffer, uint32_t frame, const Frustum& frustum, const DepthPyramid* occluder, float lodScale = 0.0f,
+		uint32_t clusterSlotCount = 0);
+
+	//Issues the frame's indirect draws. The caller binds the pipeline, index buffer and getVisibleInstanceBuffer() as
+	//the instance stream.
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t frame) const;
+
+	VkBuffer getVisibleInstanceBuffer(uint32_t frame) const { return frames[frame].visibleInstanceBuffer.buffer; }
+
+	//Instances that survived the frame's culling. Only valid once the fence of the frame's submission has signalled.
+	uint32_t readVisibleInstanceCount(uint32_t frame) const { return readStatistics(frame).visibleCount; }
+
+	//Same as readVisibleInstanceCount(), along with how many instances each test culled.
+	CullStatistics readStatistics(uint32_t frame) const;
+
+	uint32_t getDrawCount() const { return static_cast<uint32_t>(draws.size()); }
+
+	//vkCmdDrawIndexedIndirect calls per frame: one, or one per draw without multiDrawIndirect.
+	uint32_t getIndirectCallCount() const { return multiDrawIndirect ? 1 : getDrawCount(); }
+
+private:
+	//Matches CullFrame in Cull.comp (std140).
+	struct CullFrame {
+
+		float frustumPlanes[Frustum::PLANE_COUNT][4];
+		float occlusionViewProjection[16];
+		float pyramidSize[2];
+		uint32_t pyramidLevelCount;
+		float lodScale;
+		uint32_t clusterSlotCount;
+	};
+
+	//Matches CullConstants in Cull.comp.
+	struct CullConstants {
+
+		float boundingSphere[4];
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+		uint32_t drawIndex;
+		uint32_t firstVisible;
+		float lodErrors[2];
+		uint32_t hasMeshlets;
+	};
+
+	//Matches CullStatistics in Cull.comp.
+	struct StatisticsCounters {
+
+		uint32_t frustumCulledCount;
+		uint32_t occlusionCulledCount;
+	};
+
+	struct Buffer {
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		GpuAllocation allocation;
+	};
+
+	struct Frame {
+
+		//Written by the compute pass, read as the instance stream.
+		Buffer visibleInstanceBuffer;
+
+		//Reset from the template, filled by the compute pass, read by the indirect draws.
+		Buffer drawCommandBuffer;
+
+		//Zeroed, then counted into by the compute pass.
+		Buffer statisticsBuffer;
+
+		//Host-visible copy of the draw commands followed by the statistics, for readStatistics().
+		Buffer readbackBuffer;
+
+		//Host-visible CullFrame, written when the frame's culling is recorded.
+		Buffer frameBuffer;
+
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	};
+
+	Buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+
+	void destroyBuffer(Buffer& buffer);
+
+	void destroyBuffers();
+
+	VkDevice device = VK_NULL_HANDLE;
+	GpuAllocator* allocator = nullptr;
+	bool multiDrawIndirect = false;
+	uint32_t maxWorkGroupCount = 0;
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	std::vector<Frame> frames;
+	std::vector<CulledDraw> draws;
+
+	//The draw commands with instance counts of 0, copied over each frame's commands before culling.
+	Buffer templateBuffer;
+};
@@ -0,0 +1,248 @@
+#include "GpuProfiler.h"
+
+#include <stdexcept>
+
+
+void GpuProfiler::init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t slotCount, uint32_t maxScopesPerSlot){
+
+	this->device = device;
+
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+
+	supported = validBits > 0;
+	timestampPeriod = deviceProperties.limits.timestampPeriod;
+	timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+	if (!supported) {
+		return;
+	}
+
+
+	//Two queries (begin/end) per scope.
+	maxQueriesPerSlot = maxScopesPerSlot * 2;
+
+	slots.resize(slotCount);
+	timestamps.resize(maxQueriesPerSlot);
+
+	for (auto& slot : slots) {
+
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = maxQueriesPerSlot;
+
+
+		if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &slot.queryPool) != VK_SUCCESS) {
+
+			throw std::runtime_error("Failed to create GPU profiler query pool!");
+		}
+	}
+}
+
+
+void GpuProfiler::cleanup(){
+
+	for (auto& slot : slots) {
+
+		vkDestroyQueryPool(device, slot.queryPool, nullptr);
+	}
+
+	slots.clear();
+
+
+	if (csvFile.is_open()) {
+		csvFile.close();
+	}
+}
+
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t slot){
+
+	if (!supported) {
+		return;
+	}
+
+
+	recordingSlot = &slots[slot];
+	recordingSlot->scopes.clear();
+	recordingSlot->queryCount = 0;
+	recordingSlot->frameNumber = frameCounter++;
+	recordingSlot->pending = true;
+	scopeStack.clear();
+
+
+	vkCmdResetQueryPool(commandBuffer, recordingSlot->queryPool, 0, maxQueriesPerSlot);
+}
+
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name){
+
+	if (!supported || recordingSlot == nullptr) {
+		return;
+	}
+
+
+	//Out of queries: keep the stack balanced but drop the scope.
+	if (recordingSlot->queryCount + 2 > maxQueriesPerSlot) {
+
+		scopeStack.push_back(-1);
+		return;
+	}
+
+
+	ScopeRecord record{};
+	record.name = name;
+	record.depth = static_cast<uint32_t>(scopeStack.size());
+	record.beginQuery = recordingSlot->queryCount++;
+	record.endQuery = recordingSlot->queryCount++;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, recordingSlot->queryPool, record.beginQuery);
+
+	scopeStack.push_back(static_cast<int32_t>(recordingSlot->scopes.size()));
+	recordingSlot->scopes.push_back(record);
+}
+
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer){
+
+	if (!supported || recordingSlot == nullptr || scopeStack.empty()) {
+		return;
+	}
+
+
+	int32_t scopeIndex = scopeStack.back();
+	scopeStack.pop_back();
+
+	if (scopeIndex < 0) {
+		return;
+	}
+
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, recordingSlot->queryPool, recordingSlot->scopes[scopeIndex].endQuery);
+}
+
+
+bool GpuProfiler::collect(uint32_t slot){
+
+	if (!supported) {
+		return false;
+	}
+
+
+	Slot& frame = slots[slot];
+
+	if (!frame.pending || frame.queryCount == 0) {
+		return false;
+	}
+
+
+	//No VK_QUERY_RESULT_WAIT_BIT: the slot's fence has already signalled, so this never blocks.
+	VkResult result = vkGetQueryPoolResults(device, frame.queryPool, 0, frame.queryCount, sizeof(uint64_t) * frame.queryCount, timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	if (result != VK_SUCCESS) {
+		return false;
+	}
+
+	frame.pending = false;
+
+
+	lastResults.clear();
+
+	for (const auto& scope : frame.scopes) {
+
+		uint64_t ticks = (timestamps[scope.endQuery] - timestamps[scope.beginQuery]) & timestampMask;
+
+		ScopeResult scopeResult{};
+		scopeResult.name = scope.name;
+		scopeResult.depth = scope.depth;
+		scopeResult.milliseconds = static_cast<double>(ticks) * timestampPeriod / 1000000.0;
+
+		lastResults.push_back(scopeResult);
+	}
+
+
+	history.push_back(lastResults);
+
+	if (history.size() > HISTORY_LENGTH) {
+		history.pop_front();
+	}
+
+
+	if (csvFile.is_open()) {
+		writeCsv(frame.frameNumber);
+	}
+
+	return true;
+}
+
+
+double GpuProfiler::getScopeMilliseconds(const std::string& name) const{
+
+	for (const auto& result : lastResults) {
+
+		if (result.name == name) {
+			return result.milliseconds;
+		}
+	}
+
+	return -1.0;
+}
+
+
+double GpuProfiler::getAverageMilliseconds(const std::string& name) const{
+
+	double total = 0.0;
+	uint32_t count = 0;
+
+	for (const auto& results : history) {
+
+		for (const auto& result : results) {
+
+			if (result.name == name) {
+
+				total += result.milliseconds;
+				count++;
+			}
+		}
+	}
+
+	return count > 0 ? total / count : -1.0;
+}
+
+
+void GpuProfiler::setCsvOutput(const std::string& path){
+
+	csvFile.open(path, std::ios::out | std::ios::trunc);
+
+	if (!csvFile.is_open()) {
+		throw std::runtime_error("Failed to open GPU profiler CSV file! Filename: " + path);
+	}
+
+	csvFile << "frame,scope,depth,gpu_ms\n";
+}
+
+
+void GpuProfiler::writeCsv(uint64_t frameNumber){
+
+	for (const auto& result : lastResults) {
+
+		csvFile << frameNumber << "," << result.name << "," << result.depth << "," << result.milliseconds << "\n";
+	}
+
+
+	//Flush periodically rather than per frame to keep the file write off the frame's critical path.
+	if (frameNumber % CSV_FLUSH_INTERVAL == 0) {
+		csvFile.flush();
+	}
+}
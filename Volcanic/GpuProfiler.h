@@ -0,0 +1,89 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <deque>
+
+
+//Records named GPU scopes with vkCmdWriteTimestamp. Every slot (one per frame in flight) owns its own
+//query pool, so results are read back only after that slot's fence has signalled and never stall the queue.
+class GpuProfiler {
+
+public:
+	struct ScopeResult {
+
+		std::string name;
+		uint32_t depth;
+		double milliseconds;
+	};
+
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t slotCount, uint32_t maxScopesPerSlot = 64);
+
+	void cleanup();
+
+	bool isSupported() const { return supported; }
+
+	//Resets the slot's queries. Must be recorded outside of a render pass, before any scope of the slot.
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t slot);
+
+	void beginScope(VkCommandBuffer commandBuffer, const std::string& name);
+
+	void endScope(VkCommandBuffer commandBuffer);
+
+	//Reads back the slot's timestamps. Only call once the fence of the submission that recorded them has signalled.
+	//Returns false if the slot has nothing pending or the results are not available yet.
+	bool collect(uint32_t slot);
+
+	//Results of the most recently collected slot, in recording order.
+	const std::vector<ScopeResult>& getLastResults() const { return lastResults; }
+
+	//Latest and rolling-average GPU time of a scope, or a negative value if the scope has never been collected.
+	double getScopeMilliseconds(const std::string& name) const;
+
+	double getAverageMilliseconds(const std::string& name) const;
+
+	//Appends every collected scope to a CSV file (frame,scope,depth,gpu_ms).
+	void setCsvOutput(const std::string& path);
+
+private:
+	struct ScopeRecord {
+
+		std::string name;
+		uint32_t depth;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+	};
+
+	struct Slot {
+
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		std::vector<ScopeRecord> scopes;
+		uint32_t queryCount = 0;
+		uint64_t frameNumber = 0;
+		bool pending = false;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	bool supported = false;
+	float timestampPeriod = 1.0f;
+	uint64_t timestampMask = ~0ull;
+	uint32_t maxQueriesPerSlot = 0;
+
+	std::vector<Slot> slots;
+	Slot* recordingSlot = nullptr;
+	std::vector<int32_t> scopeStack;
+	uint64_t frameCounter = 0;
+
+	std::vector<ScopeResult> lastResults;
+	std::vector<uint64_t> timestamps;
+
+	//Rolling window of collected results used for averages.
+	const size_t HISTORY_LENGTH = 120;
+	std::deque<std::vector<ScopeResult>> history;
+
+	std::ofstream csvFile;
+	const uint64_t CSV_FLUSH_INTERVAL = 60;
+
+	void writeCsv(uint64_t frameNumber);
+};
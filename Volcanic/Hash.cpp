@@ -0,0 +1,110 @@
+#include "Hash.h"
+
+#include <cstring>
+
+
+namespace {
+
+	const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+	const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+	const uint64_t PRIME3 = 0x165667B19E3779F9ull;
+	const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+	const uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+
+	uint64_t rotateLeft(uint64_t value, int bits) {
+
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+
+	uint64_t read64(const unsigned char* bytes) {
+
+		uint64_t value;
+		memcpy(&value, bytes, 8);
+
+		return value;
+	}
+
+
+	uint64_t round(uint64_t accumulator, uint64_t lane) {
+
+		return rotateLeft(accumulator + lane * PRIME2, 31) * PRIME1;
+	}
+
+
+	uint64_t mergeRound(uint64_t accumulator, uint64_t value) {
+
+		return (accumulator ^ round(0, value)) * PRIME1 + PRIME4;
+	}
+}
+
+
+uint64_t Hash::xxHash64(const void* data, size_t size, uint64_t seed){
+
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	const unsigned char* end = bytes + size;
+	uint64_t h;
+
+
+	if (size >= 32) {
+
+		uint64_t v1 = seed + PRIME1 + PRIME2;
+		uint64_t v2 = seed + PRIME2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME1;
+
+		for (; end - bytes >= 32; bytes += 32) {
+
+			v1 = round(v1, read64(bytes));
+			v2 = round(v2, read64(bytes + 8));
+			v3 = round(v3, read64(bytes + 16));
+			v4 = round(v4, read64(bytes + 24));
+		}
+
+		h = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+		h = mergeRound(h, v1);
+		h = mergeRound(h, v2);
+		h = mergeRound(h, v3);
+		h = mergeRound(h, v4);
+	}
+	else {
+
+		h = seed + PRIME5;
+	}
+
+	h += static_cast<uint64_t>(size);
+
+
+	for (; end - bytes >= 8; bytes += 8) {
+
+		h ^= round(0, read64(bytes));
+		h = rotateLeft(h, 27) * PRIME1 + PRIME4;
+	}
+
+	if (end - bytes >= 4) {
+
+		uint32_t lane;
+		memcpy(&lane, bytes, 4);
+
+		h ^= static_cast<uint64_t>(lane) * PRIME1;
+		h = rotateLeft(h, 23) * PRIME2 + PRIME3;
+
+		bytes += 4;
+	}
+
+	for (; bytes < end; bytes++) {
+
+		h ^= *bytes * PRIME5;
+		h = rotateLeft(h, 11) * PRIME1;
+	}
+
+
+	h ^= h >> 33;
+	h *= PRIME2;
+	h ^= h >> 29;
+	h *= PRIME3;
+	h ^= h >> 32;
+
+	return h;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+
+class Hash {
+
+public:
+	//XXH64 (https://github.com/Cyan4973/xxHash). Fast on large buffers (four independent lanes per 32 byte stripe) and
+	//avalanches well on small keys, so it serves both file content hashes and hash table keys.
+	static uint64_t xxHash64(const void* data, size_t size, uint64_t seed = 0);
+};
@@ -1,11 +1,16 @@
 #include "HelloTriangleApplication.h"
+#include "Benchmark.h"
+#include "CpuTracer.h"
+#include "VertexWelder.h"
+#include "JobSystem.h"
+#include "Hash.h"
+#include "StartupGraph.h"
+#include "ObjLoader.h"
 
 
 #define STB_IMAGE_IMPLEMENTATION
-#define TINYOBJLOADER_IMPLEMENTATION
 #include <stb_image.h>
 #include <GLFW/glfw3.h>
-#include <tiny_obj_loader.h>
 
 #include <iostream>
 #include <map>
@@ -14,12 +19,21 @@
 #include <algorithm>
 #include <fstream>
 #include <gtc/matrix_transform.hpp>
+#include <gtc/type_ptr.hpp>
 #include <chrono>
 #include <unordered_map>
+#include <limits>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <cstring>
 
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+//GPU profiler slot used by one-time (upload) command buffers, after the per-frame slots.
+const uint32_t PROFILER_UPLOAD_SLOT = MAX_FRAMES_IN_FLIGHT;
+
 
 HelloTriangleApplication::QueueFamilyIndices HelloTriangleApplication::findQueueFamilies(VkPhysicalDevice device)
 {
@@ -39,11 +53,19 @@ HelloTriangleApplication::QueueFamilyIndices HelloTriangleApplication::findQueue
 		}
 
 
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		if (headless) {
+
+			//Nothing is presented in headless mode, the graphics family stands in for presentation.
+			indices.presentFamily = indices.graphicsFamily;
+		}
+		else {
+
+			VkBool32 presentSupport = false;
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
-		if (presentSupport) {
-			indices.presentFamily = i;
+			if (presentSupport) {
+				indices.presentFamily = i;
+			}
 		}
 
 
@@ -54,6 +76,30 @@ HelloTriangleApplication::QueueFamilyIndices HelloTriangleApplication::findQueue
 		i++;
 	}
 
+
+	//Prefer a DMA-style family (transfer without graphics or compute), then any non-graphics family with transfer support.
+	for (uint32_t j = 0; j < queueFamilyCount && !indices.transferFamily.has_value(); j++) {
+
+		VkQueueFlags flags = queueFamilies[j].queueFlags;
+
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+			indices.transferFamily = j;
+		}
+	}
+
+	for (uint32_t j = 0; j < queueFamilyCount && !indices.transferFamily.has_value(); j++) {
+
+		VkQueueFlags flags = queueFamilies[j].queueFlags;
+
+		if ((flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+			indices.transferFamily = j;
+		}
+	}
+
+	if (!indices.transferFamily.has_value()) {
+		indices.transferFamily = indices.graphicsFamily;
+	}
+
 	return indices;
 }
 
@@ -61,10 +107,11 @@ bool HelloTriangleApplication::isDeviceSuitable(VkPhysicalDevice device) {
 
 	QueueFamilyIndices indices = findQueueFamilies(device);
 
-	bool extensionsSupported = checkDeviceExtensionSupport(device);
+	//Headless mode has no surface, so the swap chain extension and surface support are not required.
+	bool extensionsSupported = headless || checkDeviceExtensionSupport(device);
 	
-	bool swapChainAdequate = false;
-	if (extensionsSupported) {
+	bool swapChainAdequate = headless;
+	if (extensionsSupported && !headless) {
 
 		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
@@ -103,9 +150,9 @@ bool HelloTriangleApplication::checkDeviceExtensionSupport(VkPhysicalDevice devi
 
 void HelloTriangleApplication::createGraphicsPipeline(){
 
-	auto vertShaderCode = readFile("Shaders/vert.spv");
-	auto fragShaderCode = readFile("Shaders/frag.spv");
+	TRACE_FUNCTION();
 
+	//Read by readShaders() during startup and kept for the pipelines a swap chain recreation rebuilds.
 	VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
 	VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
 
@@ -129,13 +176,17 @@ void HelloTriangleApplication::createGraphicsPipeline(){
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
 
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	//Binding 0 streams the mesh's vertices, binding 1 one InstanceTransform per instance.
+	std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = { PackedVertex::getBindingDescription(0), getInstanceBindingDescription(1) };
+
+	auto vertexAttributeDescriptions = PackedVertex::getAttributeDescriptions(0);
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions = getInstanceAttributeDescriptions(1);
+	attributeDescriptions.insert(attributeDescriptions.begin(), vertexAttributeDescriptions.begin(), vertexAttributeDescriptions.end());
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -274,7 +325,7 @@ void HelloTriangleApplication::createGraphicsPipeline(){
 
 
 
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+	if (pipelineCache.createGraphicsPipelines(1, &pipelineInfo, &graphicsPipeline) != VK_SUCCESS) {
 
 		throw std::runtime_error("Failed to create graphics pipeline!");
 	}
@@ -303,6 +354,18 @@ VkShaderModule HelloTriangleApplication::createShaderModule(const std::vector<ch
 }
 
 
+void HelloTriangleApplication::readShaders(){
+
+	TRACE_FUNCTION();
+
+	vertShaderCode = readFile("Shaders/vert.spv");
+	fragShaderCode = readFile("Shaders/frag.spv");
+	cullShaderCode = readFile("Shaders/cull.spv");
+	clusterCullShaderCode = readFile("Shaders/clustercull.spv");
+	depthPyramidShaderCode = readFile("Shaders/depthpyramid.spv");
+}
+
+
 std::vector<char> HelloTriangleApplication::readFile(const std::string& filename){
 
 	std::ifstream file(filename, std::ios::ate | std::ios::binary);
@@ -326,6 +389,8 @@ std::vector<char> HelloTriangleApplication::readFile(const std::string& filename
 
 void HelloTriangleApplication::createRenderPass(){
 
+	TRACE_FUNCTION();
+
 	VkAttachmentDescription colorAttachment{};
 	colorAttachment.format = SwapChainImageFormat;
 	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -334,7 +399,7 @@ void HelloTriangleApplication::createRenderPass(){
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 
 	VkAttachmentReference colorAttachmentRef{};
@@ -346,7 +411,8 @@ void HelloTriangleApplication::createRenderPass(){
 	depthAttachment.format = findDepthFormat();
 	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	//Kept for the depth pyramid, which occlusion culls the next frame against it.
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -395,6 +461,8 @@ void HelloTriangleApplication::createRenderPass(){
 
 void HelloTriangleApplication::createFramebuffers(){
 
+	TRACE_FUNCTION();
+
 	swapChainFramebuffers.resize(swapChainImageViews.size());
 
 	for (size_t i = 0; i < swapChainImageViews.size(); i++) {
@@ -423,12 +491,14 @@ void HelloTriangleApplication::createFramebuffers(){
 
 void HelloTriangleApplication::createCommandPool(){
 
+	TRACE_FUNCTION();
+
 	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
 
 	VkCommandPoolCreateInfo drawPoolInfo{};
 	drawPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	drawPoolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-	drawPoolInfo.flags = 0; //Optional
+	drawPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; //Re-recorded every frame
 
 
 	if (vkCreateCommandPool(device, &drawPoolInfo, nullptr, &drawCommandPool) != VK_SUCCESS) {
@@ -438,22 +508,26 @@ void HelloTriangleApplication::createCommandPool(){
 
 
 
-	VkCommandPoolCreateInfo transferPoolInfo{};
-	transferPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	transferPoolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-	transferPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	//Graphics-queue one-time work such as mipmap generation. Uploads go through the uploader's own transfer pool.
+	VkCommandPoolCreateInfo oneTimePoolInfo{};
+	oneTimePoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	oneTimePoolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+	oneTimePoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
 
-	if (vkCreateCommandPool(device, &transferPoolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+	if (vkCreateCommandPool(device, &oneTimePoolInfo, nullptr, &oneTimeCommandPool) != VK_SUCCESS) {
 
-		throw std::runtime_error("Failed to create transfer command pool!");
+		throw std::runtime_error("Failed to create one-time command pool!");
 	}
 }
 
 
 void HelloTriangleApplication::createCommandBuffers(){
 
-	commandBuffers.resize(swapChainFramebuffers.size());
+	TRACE_FUNCTION();
+
+	//One command buffer per frame in flight, recorded every frame in drawFrame().
+	commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
 
 	VkCommandBufferAllocateInfo allocInfo{};
@@ -466,81 +540,286 @@ void HelloTriangleApplication::createCommandBuffers(){
 
 		throw std::runtime_error("Failed to allocate command buffers!");
 	}
+}
+
+
+void HelloTriangleApplication::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex){
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = nullptr; //Optional
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to begin recording command buffer!");
+	}
+
+
+	gpuProfiler.beginFrame(commandBuffer, static_cast<uint32_t>(currentFrame));
+	gpuProfiler.beginScope(commandBuffer, "Frame");
+
+
+	//Take ownership of anything the transfer queue finished since the last frame.
+	uploader.recordAcquireBarriers(commandBuffer);
+
+
+	//Compute work can't go inside the render pass.
+	if (isGpuCullingActive()) {
+
+		gpuProfiler.beginScope(commandBuffer, "Culling");
+
+		//Full-detail survivors claim the cluster culler's slots while they last.
+		uint32_t clusterSlotCount = 0;
+
+		if (isClusterCullingActive()) {
+
+			clusterCuller.recordSlotReset(commandBuffer, static_cast<uint32_t>(currentFrame));
+			clusterSlotCount = clusterCuller.getSlotCount();
+		}
+
+		gpuCuller.recordCulling(commandBuffer, static_cast<uint32_t>(currentFrame), frameFrustum, isOcclusionCullingActive() ? &depthPyramid : nullptr,
+			isLodSelectionActive() ? frameLodScale : 0.0f, clusterSlotCount);
+		gpuProfiler.endScope(commandBuffer);
+	}
+
+
+	//Cull before the draws are split between the recorder's jobs, which only see the visible instances.
+	uint32_t frustumVisibleCount = scene.getInstanceCount();
+
+	if (isCpuCullingActive()) {
+
+		{
+			TRACE_ZONE("FrustumCull");
+
+			if (bvhCulling) {
+				instanceTree.queryFrustum(frameFrustum, visibleInstances);
+			}
+			else {
+				FrustumCuller::cullSpheres(frameFrustum, instanceBounds, visibleInstances);
+			}
+		}
+
+		frustumVisibleCount = static_cast<uint32_t>(visibleInstances.size());
+
+		if (isSoftwareOcclusionActive()) {
+
+			TRACE_ZONE("SoftwareOcclusion");
+			cullOccludedInstances();
+		}
+
+		selectInstanceLods();
+
+		if (isClusterCullingActive()) {
+			assignClusterSlots();
+		}
+	}
+
+	if (!isGpuCullingActive()) {
+
+		visibleInstanceCount = isCpuCullingActive() ? static_cast<uint32_t>(visibleInstances.size()) : scene.getInstanceCount();
+
+		cullStatistics = CullStatistics();
+		cullStatistics.visibleCount = visibleInstanceCount;
+		cullStatistics.frustumCulledCount = scene.getInstanceCount() - frustumVisibleCount;
+		cullStatistics.occlusionCulledCount = frustumVisibleCount - visibleInstanceCount;
+		cullStatistics.drawnTriangleCount = static_cast<uint64_t>(visibleInstanceCount) * (modelLods[0].indexCount / 3);
+
+		if (isCpuCullingActive()) {
+
+			cullStatistics.drawnTriangleCount = 0;
 
+			for (uint32_t lod : visibleInstanceLods) {
+				cullStatistics.drawnTriangleCount += modelLods[lod].indexCount / 3;
+			}
+		}
+
+		//Cluster culled instances draw what their meshlets' culling left, as of the frame's previous submission.
+		if (isClusterCullingActive()) {
+
+			cullStatistics.drawnTriangleCount -= static_cast<uint64_t>(clusterInstances.size()) * (modelLods[0].indexCount / 3);
+			cullStatistics.drawnTriangleCount += clusterStatistics.drawnTriangleCount;
+		}
+	}
 
-	for (size_t i = 0; i < commandBuffers.size(); i++) {
 
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0; //Optional
-		beginInfo.pInheritanceInfo = nullptr; //Optional
+	//Like the GPU culling pass, cluster culling can't go inside the render pass. It runs on what instance culling kept.
+	if (isClusterCullingActive()) {
 
-		if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
+		gpuProfiler.beginScope(commandBuffer, "ClusterCulling");
 
-			throw std::runtime_error("Failed to begin recording command buffer!");
+		if (isCpuCullingActive()) {
+			clusterCuller.recordSlots(commandBuffer, static_cast<uint32_t>(currentFrame), clusterInstances.data(), static_cast<uint32_t>(clusterInstances.size()));
 		}
 
+		clusterCuller.recordCulling(commandBuffer, static_cast<uint32_t>(currentFrame), frameFrustum, glm::value_ptr(frameCameraPosition));
+		gpuProfiler.endScope(commandBuffer);
+	}
+
+
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = swapChainExtent;
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+
+
+	gpuProfiler.beginScope(commandBuffer, "RenderPass");
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+
+	//The draws are recorded into secondary command buffers in parallel. A render pass with secondary contents allows
+	//nothing but vkCmdExecuteCommands, so the GPU profiler scopes stay outside of it.
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = renderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = swapChainFramebuffers[imageIndex];
+
+	//The indirect draws are a handful of commands, so they are recorded as a single slice.
+	uint32_t drawCount = isGpuCullingActive() ? 1 : getDrawCallCount();
+
+	const std::vector<VkCommandBuffer>& secondaryCommandBuffers = recorder.record(static_cast<uint32_t>(currentFrame), inheritanceInfo, drawCount,
+		[this](VkCommandBuffer secondaryCommandBuffer, uint32_t begin, uint32_t end) { recordDraws(secondaryCommandBuffer, begin, end); });
+
+	vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+
+
+	vkCmdEndRenderPass(commandBuffer);
+
+	gpuProfiler.endScope(commandBuffer);
+
+
+	//The next frame culls against this frame's depth.
+	if (isOcclusionCullingActive()) {
 
-		std::array<VkClearValue, 2> clearValues{};
-		clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-		clearValues[1].depthStencil = { 1.0f, 0 };
+		gpuProfiler.beginScope(commandBuffer, "DepthPyramid");
+		depthPyramid.recordBuild(commandBuffer, glm::value_ptr(frameViewProjection));
+		gpuProfiler.endScope(commandBuffer);
+	}
+	else {
+
+		//Its depth would be stale by the time occlusion culling is turned back on.
+		depthPyramid.invalidate();
+	}
+
+
+	gpuProfiler.endScope(commandBuffer);
+
+
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to record command buffer!");
+	}
+}
+
+
+void HelloTriangleApplication::recordDraws(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end){
+
+	//Secondary command buffers inherit no state, so every slice binds everything itself.
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+
+	//Culled draws read their instances from the frame's visible instance buffer.
+	VkBuffer vertexBuffers[] = { vertexBuffer, isGpuCullingActive() ? gpuCuller.getVisibleInstanceBuffer(static_cast<uint32_t>(currentFrame)) : instanceBuffer };
+	VkDeviceSize offsets[] = { 0, 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
 
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = swapChainFramebuffers[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = swapChainExtent;
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
 
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
 
 
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)swapChainExtent.width;
+	viewport.height = (float)swapChainExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-		vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	VkRect2D scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = swapChainExtent;
+
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-		VkBuffer vertexBuffers[] = { vertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
 
 
-		vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 1, &frameUniformOffset);
 
 
+	//There is only the one model, so every batch draws from the same vertex & index buffers. Only culled instances pick
+	//a level of detail; the rest draw the full mesh.
+	const MeshLod& fullMesh = modelLods[0];
 
-		VkViewport viewport = {};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = (float)swapChainExtent.width;
-		viewport.height = (float)swapChainExtent.height;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
+	if (isGpuCullingActive()) {
 
-		vkCmdSetViewport(commandBuffers[i], 0, 1, &viewport);
+		gpuCuller.recordDraws(commandBuffer, static_cast<uint32_t>(currentFrame));
 
-		VkRect2D scissor = {};
-		scissor.offset = { 0, 0 };
-		scissor.extent = swapChainExtent;
+		//The survivors handed to the cluster culler are drawn from the instance buffer, through its visible indices.
+		if (isClusterCullingActive()) {
 
-		vkCmdSetScissor(commandBuffers[i], 0, 1, &scissor);
+			vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer, offsets);
+			vkCmdBindIndexBuffer(commandBuffer, clusterCuller.getIndexBuffer(static_cast<uint32_t>(currentFrame)), 0, VK_INDEX_TYPE_UINT32);
+			clusterCuller.recordDraws(commandBuffer, static_cast<uint32_t>(currentFrame));
+		}
+	}
+	else if (instancing) {
 
+		const std::vector<InstanceBatch>& batches = scene.getBatches();
+
+		for (uint32_t i = begin; i < end; i++) {
+			vkCmdDrawIndexed(commandBuffer, fullMesh.indexCount, batches[i].instanceCount, fullMesh.firstIndex, 0, batches[i].firstInstance);
+		}
+	}
+	else if (isCpuCullingActive()) {
 
+		bool clusterCulled = isClusterCullingActive();
+		bool clusterIndicesBound = false;
 
-		vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+		for (uint32_t i = begin; i < end; i++) {
 
+			//Instances with a slot draw from the culler's index buffer, so it is swapped in & out as the slice goes.
+			uint32_t slot = clusterCulled ? visibleInstanceSlots[i] : NO_SLOT;
 
-		vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+			if ((slot != NO_SLOT) != clusterIndicesBound) {
 
+				clusterIndicesBound = slot != NO_SLOT;
 
-		vkCmdEndRenderPass(commandBuffers[i]);
+				if (clusterIndicesBound) {
+					vkCmdBindIndexBuffer(commandBuffer, clusterCuller.getIndexBuffer(static_cast<uint32_t>(currentFrame)), 0, VK_INDEX_TYPE_UINT32);
+				}
+				else {
+					vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+				}
+			}
 
+			if (slot != NO_SLOT) {
 
+				clusterCuller.recordDraw(commandBuffer, static_cast<uint32_t>(currentFrame), slot);
+				continue;
+			}
 
-		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
+			const MeshLod& lod = modelLods[visibleInstanceLods[i]];
+			vkCmdDrawIndexed(commandBuffer, lod.indexCount, 1, lod.firstIndex, 0, visibleInstances[i]);
+		}
+	}
+	else {
 
-			throw std::runtime_error("Failed to record command buffer!");
+		for (uint32_t i = begin; i < end; i++) {
+			vkCmdDrawIndexed(commandBuffer, fullMesh.indexCount, 1, fullMesh.firstIndex, 0, i);
 		}
 	}
 }
@@ -548,27 +827,64 @@ void HelloTriangleApplication::createCommandBuffers(){
 
 void HelloTriangleApplication::drawFrame() {
 
-	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	TRACE_FUNCTION();
 
+	{
+		TRACE_ZONE("WaitForFrameFence");
+		vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	}
 
-	uint32_t imageIndex;
 
-	VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	//This slot's previous frame has finished on the GPU, so its timestamps can be read without stalling.
+	collectGpuProfile(static_cast<uint32_t>(currentFrame));
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+	clusterStatistics = isClusterCullingActive() ? clusterCuller.readStatistics(static_cast<uint32_t>(currentFrame)) : ClusterStatistics();
 
-		recreateSwapChain();
-		return;
+	if (isGpuCullingActive()) {
+
+		//Survivors in the cluster culler's slots were drawn (and counted) by it instead.
+		cullStatistics = gpuCuller.readStatistics(static_cast<uint32_t>(currentFrame));
+		cullStatistics.visibleCount += clusterStatistics.instanceCount;
+		cullStatistics.drawnTriangleCount += clusterStatistics.drawnTriangleCount;
+		visibleInstanceCount = cullStatistics.visibleCount;
+	}
+
+	instanceTree.update();
+
+
+	uint32_t imageIndex;
+
+	if (headless) {
+
+		//No swap chain to acquire from, every frame in flight renders into its own offscreen image.
+		imageIndex = static_cast<uint32_t>(currentFrame);
 	}
-	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+	else {
+
+		VkResult result;
+
+		{
+			TRACE_ZONE("AcquireNextImage");
+			result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+		}
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+
+			recreateSwapChain();
+			return;
+		}
+		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
 
-		throw std::runtime_error("Failed to acquire swap chain image!");
+			throw std::runtime_error("Failed to acquire swap chain image!");
+		}
 	}
 
 
 
 	//Check if a previous frame is using this image (i.e. is there a fence to wait on)
 	if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+
+		TRACE_ZONE("WaitForImageFence");
 		vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
 	}
 
@@ -581,26 +897,57 @@ void HelloTriangleApplication::drawFrame() {
 	VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
 
 
-	updateUniformBuffer(imageIndex);
+	//This frame's previous submission has completed, so its uniform ring can be reused from the start.
+	uniformRings[currentFrame].reset();
+
+	{
+		TRACE_ZONE("UpdateUniformBuffer");
+		frameUniformOffset = updateUniformBuffer();
+	}
+
+
+	{
+		TRACE_ZONE("RecordCommandBuffer");
+
+		auto recordStart = std::chrono::high_resolution_clock::now();
+
+		vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+		recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+
+		if (headless) {
+			recordTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count());
+		}
+	}
 
 
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.waitSemaphoreCount = headless ? 0 : 1;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
+	submitInfo.signalSemaphoreCount = headless ? 0 : 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 
 
-	vkResetFences(device, 1, &inFlightFences[currentFrame]);
+	{
+		TRACE_ZONE("QueueSubmit");
+
+		vkResetFences(device, 1, &inFlightFences[currentFrame]);
+
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+
+			throw std::runtime_error("Failed to submit draw command buffer!");
+		}
+	}
+
 
-	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+	if (headless) {
 
-		throw std::runtime_error("Failed to submit draw command buffer!");
+		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+		return;
 	}
 
 
@@ -622,7 +969,12 @@ void HelloTriangleApplication::drawFrame() {
 
 
 
-	result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	VkResult result;
+
+	{
+		TRACE_ZONE("QueuePresent");
+		result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	}
 
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
@@ -642,6 +994,8 @@ void HelloTriangleApplication::drawFrame() {
 
 void HelloTriangleApplication::createSyncObjects(){
 
+	TRACE_FUNCTION();
+
 	imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 	renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 	inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
@@ -667,182 +1021,327 @@ void HelloTriangleApplication::createSyncObjects(){
 }
 
 
-void HelloTriangleApplication::cleanupSwapChain(){
+void HelloTriangleApplication::initGpuProfiler(){
 
-	vkDestroyImageView(device, depthImageView, nullptr);
-	vkDestroyImage(device, depthImage, nullptr);
-	vkFreeMemory(device, depthImageMemory, nullptr);
+	TRACE_FUNCTION();
 
+	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
-	for (auto framebuffer : swapChainFramebuffers) {
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
+	//One query pool per frame in flight, plus one for one-time upload command buffers.
+	gpuProfiler.init(device, physicalDevice, indices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT + 1);
+
+	if (!gpuProfilerCsvPath.empty()) {
+		gpuProfiler.setCsvOutput(gpuProfilerCsvPath);
 	}
+}
 
-	vkFreeCommandBuffers(device, drawCommandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
 
-	vkDestroyPipeline(device, graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-	vkDestroyRenderPass(device, renderPass, nullptr);
+void HelloTriangleApplication::collectGpuProfile(uint32_t slot){
 
+	if (!gpuProfiler.collect(slot)) {
+		return;
+	}
 
-	for (auto imageView : swapChainImageViews) {
-		vkDestroyImageView(device, imageView, nullptr);
+	if (headless && slot != PROFILER_UPLOAD_SLOT) {
+		gpuFrameTimes.push_back(gpuProfiler.getScopeMilliseconds("Frame"));
 	}
+}
 
-	vkDestroySwapchainKHR(device, swapChain, nullptr);
 
+void HelloTriangleApplication::setGpuProfilerCsvPath(const std::string& path){
 
-	for (size_t i = 0; i < swapChainImages.size(); i++) {
+	gpuProfilerCsvPath = path;
+}
 
-		vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-		vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
-	}
 
+void HelloTriangleApplication::setModelPath(const std::string& path){
 
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	modelPath = path;
 }
 
 
-void HelloTriangleApplication::recreateSwapChain(){
+void HelloTriangleApplication::setMeshCacheEnabled(bool enabled){
 
-	int width = 0, height = 0;
-	glfwGetFramebufferSize(window, &width, &height);
+	useMeshCache = enabled;
+}
 
-	while (width == 0 || height == 0) {
 
-		glfwWaitEvents();
-		glfwGetFramebufferSize(window, &width, &height);
-	}
+void HelloTriangleApplication::setMeshOptimizationEnabled(bool enabled){
 
+	optimizeMesh = enabled;
+}
 
-	vkDeviceWaitIdle(device);
 
-	cleanupSwapChain();
+void HelloTriangleApplication::setObjParser(ObjLoader::Backend backend, uint32_t threadCount){
 
-	createSwapChain();
-	createImageViews();
-	createRenderPass();
-	createGraphicsPipeline();
-	createDepthResources();
-	createFramebuffers();
-	createUniformBuffers();
-	createDescriptorPool();
-	createDescriptorSets();
-	createCommandBuffers();
+	objBackend = backend;
+	objThreadCount = threadCount;
 }
 
 
-void HelloTriangleApplication::createVertexBuffer(){
+void HelloTriangleApplication::setBatchedUploads(bool enabled){
+
+	batchedUploads = enabled;
+}
 
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
 
-	
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+void HelloTriangleApplication::setParallelStartup(bool enabled){
+
+	parallelStartup = enabled;
+}
 
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, vertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(device, stagingBufferMemory);
+void HelloTriangleApplication::setPipelineCacheEnabled(bool enabled){
 
+	pipelineCachePath = enabled ? "pipeline.cache" : "";
+}
 
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
 
+void HelloTriangleApplication::setSceneObjectCount(uint32_t count){
 
-	copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+	sceneObjectCount = std::max(1u, count);
+}
 
 
+void HelloTriangleApplication::setInstancingEnabled(bool enabled){
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	instancing = enabled;
 }
 
 
-void HelloTriangleApplication::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory){
+void HelloTriangleApplication::setGpuCullingEnabled(bool enabled){
 
-	VkBufferCreateInfo bufferInfo{};
-	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.size = size;
-	bufferInfo.usage = usage;
-	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	gpuCulling = enabled;
+}
 
 
-	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create buffer!");
-	}
+void HelloTriangleApplication::setCpuCullingEnabled(bool enabled){
 
+	cpuCulling = enabled;
+}
 
 
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+void HelloTriangleApplication::setBvhCullingEnabled(bool enabled){
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+	bvhCulling = enabled;
+}
 
 
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate buffer memory!");
-	}
+void HelloTriangleApplication::setOcclusionCullingEnabled(bool enabled){
+
+	occlusionCulling = enabled;
+}
 
 
-	vkBindBufferMemory(device, buffer, bufferMemory, 0);
+void HelloTriangleApplication::setSoftwareOcclusionEnabled(bool enabled){
+
+	softwareOcclusion = enabled;
 }
 
 
-void HelloTriangleApplication::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size){
+void HelloTriangleApplication::setLodSelectionEnabled(bool enabled){
+
+	lodSelection = enabled;
+}
+
 
+void HelloTriangleApplication::setClusterCullingEnabled(bool enabled){
 
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(transferCommandPool);
+	clusterCulling = enabled;
+}
 
 
-	VkBufferCopy copyRegion{};
-	copyRegion.size = size;
+void HelloTriangleApplication::setRecordThreadCount(uint32_t threadCount){
 
+	recordThreadCount = threadCount;
+}
 
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
+void HelloTriangleApplication::setIncrementalSwapChainRecreation(bool enabled){
 
-	endSingleTimeCommands(commandBuffer, transferCommandPool);
+	incrementalSwapChainRecreation = enabled;
 }
 
 
-void HelloTriangleApplication::createIndexBuffer(){
+void HelloTriangleApplication::cleanupSwapChainTargets(){
 
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+	depthPyramid.destroy();
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	vkDestroyImageView(device, depthImageView, nullptr);
+	vkDestroyImage(device, depthImage, nullptr);
+	allocator.free(depthImageAllocation);
 
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
+	for (auto framebuffer : swapChainFramebuffers) {
+		vkDestroyFramebuffer(device, framebuffer, nullptr);
+	}
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, indices.data(), (size_t)bufferSize);
-	vkUnmapMemory(device, stagingBufferMemory);
+	for (auto imageView : swapChainImageViews) {
+		vkDestroyImageView(device, imageView, nullptr);
+	}
+}
 
 
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+void HelloTriangleApplication::cleanupSwapChain(){
 
+	cleanupSwapChainTargets();
 
-	copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+	if (headless) {
 
+		for (size_t i = 0; i < swapChainImages.size(); i++) {
 
+			vkDestroyImage(device, swapChainImages[i], nullptr);
+			allocator.free(offscreenImageAllocations[i]);
+		}
+	}
+	else {
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+		vkDestroySwapchainKHR(device, swapChain, nullptr);
+		swapChain = VK_NULL_HANDLE;
+	}
 }
 
 
-void HelloTriangleApplication::createDescriptorSetLayout(){
+void HelloTriangleApplication::cleanupGraphicsPipeline(){
+
+	vkDestroyPipeline(device, graphicsPipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyRenderPass(device, renderPass, nullptr);
+}
+
+
+void HelloTriangleApplication::recreateSwapChain(){
+
+	TRACE_FUNCTION();
+
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+
+	while (width == 0 || height == 0) {
+
+		glfwWaitEvents();
+		glfwGetFramebufferSize(window, &width, &height);
+	}
+
+
+	auto recreateStart = std::chrono::high_resolution_clock::now();
+
+	//Only the frames in flight (and presentation) use the swap chain's images; uploads on the transfer queue carry on.
+	{
+		TRACE_ZONE("WaitForFrames");
+
+		vkWaitForFences(device, static_cast<uint32_t>(inFlightFences.size()), inFlightFences.data(), VK_TRUE, UINT64_MAX);
+		vkQueueWaitIdle(presentQueue);
+	}
+
+
+	VkSwapchainKHR oldSwapChain = swapChain;
+	VkFormat oldFormat = SwapChainImageFormat;
+
+	cleanupSwapChainTargets();
+
+	if (!incrementalSwapChainRecreation) {
+
+		vkFreeCommandBuffers(device, drawCommandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+		cleanupGraphicsPipeline();
+	}
+
+
+	createSwapChain(oldSwapChain);
+	vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+
+	createImageViews();
+
+
+	//Viewport & scissor are dynamic, so the render pass and pipeline only depend on the (rarely changing) surface format.
+	if (!incrementalSwapChainRecreation || SwapChainImageFormat != oldFormat) {
+
+		if (incrementalSwapChainRecreation) {
+			cleanupGraphicsPipeline();
+		}
+
+		createRenderPass();
+		createGraphicsPipeline();
+	}
+
+	createDepthResources();
+	createFramebuffers();
+
+	if (!incrementalSwapChainRecreation) {
+		createCommandBuffers();
+	}
+
+
+	//The image count may have changed, and no image is in use by a frame any more.
+	imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
+
+
+	auto recreateEnd = std::chrono::high_resolution_clock::now();
+	swapChainRecreateTimes.push_back(std::chrono::duration<double, std::milli>(recreateEnd - recreateStart).count());
+}
+
+
+void HelloTriangleApplication::createVertexBuffer(){
+
+	TRACE_FUNCTION();
+
+	VkDeviceSize bufferSize = modelVertexBytes;
+
+
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferAllocation);
+
+	uploader.uploadBuffer(vertexBuffer, modelVertexData, bufferSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+}
+
+
+void HelloTriangleApplication::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, GpuAllocation& bufferAllocation){
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create buffer!");
+	}
+
+
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+	bufferAllocation = allocator.allocate(memRequirements, findMemoryType(memRequirements.memoryTypeBits, properties), GpuAllocator::ResourceType::Linear);
+
+
+	vkBindBufferMemory(device, buffer, bufferAllocation.memory, bufferAllocation.offset);
+}
+
+
+void HelloTriangleApplication::createIndexBuffer(){
+
+	TRACE_FUNCTION();
+
+	VkDeviceSize bufferSize = modelIndexBytes;
+
+
+	//Also read by the cluster culling pass, which reads 16-bit indices in pairs: the size is rounded up to whole pairs.
+	createBuffer((bufferSize + 3) & ~VkDeviceSize(3), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferAllocation);
+
+	uploader.uploadBuffer(indexBuffer, modelIndexData, bufferSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+}
+
+
+void HelloTriangleApplication::createDescriptorSetLayout(){
+
+	TRACE_FUNCTION();
 
 	VkDescriptorSetLayoutBinding uboLayoutBinding{};
 	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	uboLayoutBinding.descriptorCount = 1;
 	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 	uboLayoutBinding.pImmutableSamplers = nullptr; //Optional
@@ -874,19 +1373,27 @@ void HelloTriangleApplication::createDescriptorSetLayout(){
 
 void HelloTriangleApplication::createUniformBuffers(){
 
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+	TRACE_FUNCTION();
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
 
-	uniformBuffers.resize(swapChainImages.size());
-	uniformBuffersMemory.resize(swapChainImages.size());
 
-	for (size_t i = 0; i < swapChainImages.size(); i++) {
+	//One ring per frame in flight rather than per swap chain image: a ring is only rewritten after its frame's fence has signalled.
+	uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	uniformBufferAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+	uniformRings.resize(MAX_FRAMES_IN_FLIGHT);
 
-		createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+		createBuffer(UNIFORM_RING_SIZE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBufferAllocations[i]);
+
+		uniformRings[i].init(uniformBuffers[i], uniformBufferAllocations[i].mappedData, UNIFORM_RING_SIZE, deviceProperties.limits.minUniformBufferOffsetAlignment);
 	}
 }
 
 
-void HelloTriangleApplication::updateUniformBuffer(uint32_t currentImage){
+uint32_t HelloTriangleApplication::updateUniformBuffer(){
 
 	static auto startTime = std::chrono::high_resolution_clock::now();
 
@@ -894,324 +1401,645 @@ void HelloTriangleApplication::updateUniformBuffer(uint32_t currentImage){
 	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
 
+	//The instances are static, so the whole scene turns with the view instead of rewriting every transform each frame.
+	glm::mat4 sceneRotation = glm::rotate(glm::mat4(1.0f), time * glm::radians(45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
 	UniformBufferObject ubo{};
-	ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * sceneRotation;
 	ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f);
 
 	ubo.proj[1][1] *= -1;
 
 
-	void* data;
-	vkMapMemory(device, uniformBuffersMemory[currentImage], 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(device, uniformBuffersMemory[currentImage]);
-}
+	//The instance transforms are in the space ubo.view maps from.
+	frameViewProjection = ubo.proj * ubo.view;
+	frameFrustum = Frustum::fromViewProjection(glm::value_ptr(frameViewProjection));
 
+	//A length L at a distance z in front of the camera spans L * proj[1][1] / z of the [-1, 1] viewport height.
+	frameLodScale = std::fabs(ubo.proj[1][1]) * 0.5f * swapChainExtent.height / LOD_PIXEL_ERROR;
 
-void HelloTriangleApplication::createDescriptorPool(){
+	frameCameraPosition = glm::vec3(glm::inverse(ubo.view)[3]);
 
-	std::array<VkDescriptorPoolSize, 2> poolSizes{};
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
-	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
 
+	//Dequantizes the packed positions; the instance transforms place them in the world.
+	ubo.model = glm::translate(glm::mat4(1.0f), glm::make_vec3(modelQuantization.positionOffset));
+	ubo.model = glm::scale(ubo.model, glm::make_vec3(modelQuantization.positionScale));
 
-	VkDescriptorPoolCreateInfo poolInfo{};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = static_cast<uint32_t>(swapChainImages.size());
 
+	return uniformRings[currentFrame].push(ubo);
+}
 
 
-	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool)) {
+void HelloTriangleApplication::buildScene(){
 
-		throw std::runtime_error("Failed to create descriptor pool!");
-	}
-}
+	TRACE_FUNCTION();
 
+	scene.clear();
 
-void HelloTriangleApplication::createDescriptorSets(){
 
-	std::vector<VkDescriptorSetLayout> layouts(swapChainImages.size(), descriptorSetLayout);
+	//Copies of the model on a square grid, scaled down so the grid covers what one model would.
+	uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(sceneObjectCount))));
+	float cellSize = 2.0f / static_cast<float>(gridSize);
 
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());
-	allocInfo.pSetLayouts = layouts.data();
+	for (uint32_t i = 0; i < sceneObjectCount; i++) {
 
+		glm::vec3 cellCenter = {
+			(static_cast<float>(i % gridSize) - 0.5f * static_cast<float>(gridSize - 1)) * cellSize,
+			(static_cast<float>(i / gridSize) - 0.5f * static_cast<float>(gridSize - 1)) * cellSize,
+			0.0f
+		};
 
-	descriptorSets.resize(swapChainImages.size());
+		glm::mat4 transform = glm::translate(glm::mat4(1.0f), cellCenter);
+		transform = glm::scale(transform, glm::vec3(0.5f * cellSize));
 
-	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+		scene.addInstance(0, toInstanceTransform(transform));
+	}
 
-		throw std::runtime_error("Failed to allocate descriptor sets!");
+	scene.build();
+}
+
+
+InstanceTransform HelloTriangleApplication::toInstanceTransform(const glm::mat4& transform){
+
+	//glm is column-major, the instance stream holds rows.
+	InstanceTransform instance;
+
+	for (int row = 0; row < 3; row++) {
+		for (int column = 0; column < 4; column++) {
+			instance.rows[row][column] = transform[column][row];
+		}
 	}
 
+	return instance;
+}
 
-	for (size_t i = 0; i < swapChainImages.size(); i++) {
 
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = uniformBuffers[i];
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(UniformBufferObject);
+VkVertexInputBindingDescription HelloTriangleApplication::getInstanceBindingDescription(uint32_t binding){
 
-		
-		VkDescriptorImageInfo imageInfo{};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = textureImageView;
-		imageInfo.sampler = textureSampler;
-		
+	VkVertexInputBindingDescription bindingDescription{};
+	bindingDescription.binding = binding;
+	bindingDescription.stride = sizeof(InstanceTransform);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
-		std::array <VkWriteDescriptorSet, 2> descriptorWrites{};
+	return bindingDescription;
+}
 
-		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0].dstSet = descriptorSets[i];
-		descriptorWrites[0].dstBinding = 0;
-		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[0].descriptorCount = 1;
-		descriptorWrites[0].pBufferInfo = &bufferInfo;
-		descriptorWrites[0].pImageInfo = nullptr; //Optional
-		descriptorWrites[0].pTexelBufferView = nullptr; //Optional
 
-		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[1].dstSet = descriptorSets[i];
-		descriptorWrites[1].dstBinding = 1;
-		descriptorWrites[1].dstArrayElement = 0;
-		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[1].descriptorCount = 1;
-		descriptorWrites[1].pImageInfo = &imageInfo;
+std::vector<VkVertexInputAttributeDescription> HelloTriangleApplication::getInstanceAttributeDescriptions(uint32_t binding){
 
+	//One vec4 per row of the transform.
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
 
-		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	for (uint32_t row = 0; row < 3; row++) {
+
+		attributeDescriptions[row].binding = binding;
+		attributeDescriptions[row].location = INSTANCE_TRANSFORM_LOCATION + row;
+		attributeDescriptions[row].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDescriptions[row].offset = row * sizeof(InstanceTransform::rows[0]);
 	}
+
+	return attributeDescriptions;
 }
 
 
-void HelloTriangleApplication::createTextureImage(){
+void HelloTriangleApplication::createInstanceBuffer(){
 
-	int texWidth, texHeight, texChannels;
+	TRACE_FUNCTION();
 
-	
-	stbi_uc* pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+	const std::vector<InstanceTransform>& transforms = scene.getTransforms();
+	VkDeviceSize bufferSize = transforms.size() * sizeof(InstanceTransform);
 
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
 
+	//Read as the instance stream, or by the culling pass.
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, instanceBuffer, instanceBufferAllocation);
 
-	if (!pixels) {
-		throw std::runtime_error("Failed to load texture image!");
-	}
+	uploader.uploadBuffer(instanceBuffer, transforms.data(), bufferSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+}
 
 
-	mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+void HelloTriangleApplication::createMeshletBuffer(){
 
+	TRACE_FUNCTION();
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	//Zero-sized buffers are not allowed.
+	VkDeviceSize bufferSize = std::max<size_t>(meshlets.size(), 1) * sizeof(Meshlet);
 
 
-	createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, meshletBuffer, meshletBufferAllocation);
 
+	if (!meshlets.empty()) {
+		uploader.uploadBuffer(meshletBuffer, meshlets.data(), meshlets.size() * sizeof(Meshlet), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+}
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(device, stagingBufferMemory);
 
+void HelloTriangleApplication::createCulledDraws(){
 
-	stbi_image_free(pixels);
+	//The quantized positions span offset +- scale on each axis, so this sphere holds the whole model.
+	const float* offset = modelQuantization.positionOffset;
+	const float* scale = modelQuantization.positionScale;
+	float radius = std::sqrt(scale[0] * scale[0] + scale[1] * scale[1] + scale[2] * scale[2]);
 
+	modelBoundingRadius = radius;
 
-	createImage(texWidth, texHeight, mipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+	//Every level of detail tests all of a batch's instances, so each needs room for all of them in the visible buffer.
+	size_t lodCount = isLodSelectionActive() ? modelLods.size() : 1;
+	uint32_t firstVisible = 0;
 
+	std::vector<CulledDraw> draws;
+	instanceBounds.resize(scene.getInstanceCount());
+	instanceBoxes.resize(scene.getInstanceCount());
+	instanceTree.clear();
 
-	transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-	copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+	for (const InstanceBatch& batch : scene.getBatches()) {
 
-	
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+		for (size_t lod = 0; lod < lodCount; lod++) {
 
-	
-	//Transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps.
-	generateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
-}
+			CulledDraw draw;
+			draw.indexCount = modelLods[lod].indexCount;
+			draw.firstIndex = modelLods[lod].firstIndex;
+			draw.firstInstance = batch.firstInstance;
+			draw.instanceCount = batch.instanceCount;
+			draw.firstVisible = firstVisible;
+			draw.boundingSphere[0] = offset[0];
+			draw.boundingSphere[1] = offset[1];
+			draw.boundingSphere[2] = offset[2];
+			draw.boundingSphere[3] = radius;
+			draw.lodErrors[0] = modelLods[lod].error;
+			draw.lodErrors[1] = lod + 1 < lodCount ? modelLods[lod + 1].error : -1.0f;
+			draw.hasMeshlets = lod == 0 && !meshlets.empty();
 
+			draws.push_back(draw);
 
-void HelloTriangleApplication::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory){
+			firstVisible += batch.instanceCount;
+		}
 
-	VkImageCreateInfo imageInfo{};
-	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	imageInfo.imageType = VK_IMAGE_TYPE_2D;
-	imageInfo.extent.width = width;
-	imageInfo.extent.height = height;
-	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = mipLevels;
-	imageInfo.arrayLayers = 1;
-	imageInfo.format = format;
-	imageInfo.tiling = tiling;
-	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	imageInfo.usage = usage;
-	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+		//Moved by each instance's transform & grown by its largest axis scale, as Cull.comp does on the GPU.
+		for (uint32_t i = batch.firstInstance; i < batch.firstInstance + batch.instanceCount; i++) {
 
-	if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+			const float (*rows)[4] = scene.getTransforms()[i].rows;
 
-		throw std::runtime_error("Failed to create image!");
-	}
+			float center[3];
+			float maxScaleSquared = 0.0f;
 
+			for (int axis = 0; axis < 3; axis++) {
 
+				center[axis] = rows[axis][0] * offset[0] + rows[axis][1] * offset[1] + rows[axis][2] * offset[2] + rows[axis][3];
+				maxScaleSquared = std::max(maxScaleSquared, rows[0][axis] * rows[0][axis] + rows[1][axis] * rows[1][axis] + rows[2][axis] * rows[2][axis]);
+			}
+
+			instanceBounds.set(i, center, radius * std::sqrt(maxScaleSquared));
 
-	VkMemoryRequirements memRequirements;
-	vkGetImageMemoryRequirements(device, image, &memRequirements);
 
+			//The transformed quantization box, bounded along each world axis.
+			float min[3], max[3];
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+			for (int axis = 0; axis < 3; axis++) {
 
+				float extent = std::fabs(rows[axis][0]) * scale[0] + std::fabs(rows[axis][1]) * scale[1] + std::fabs(rows[axis][2]) * scale[2];
 
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+				min[axis] = center[axis] - extent;
+				max[axis] = center[axis] + extent;
+			}
 
-		throw std::runtime_error("Failed to allocate image memory!");
+			instanceTree.insert(min, max, i);
+			instanceBoxes.set(i, min, max);
+		}
 	}
 
+	//Inserting one by one builds a loose tree; the SAH rebuild is swapped in by drawFrame() once it is done.
+	instanceTree.startRebuild();
 
-	vkBindImageMemory(device, image, imageMemory, 0);
+	gpuCuller.setDraws(instanceBuffer, scene.getInstanceCount(), draws);
+
+	//The meshlets cover the full mesh, so an instance never draws more than its indices.
+	clusterCuller.setMeshlets(instanceBuffer, meshletBuffer, static_cast<uint32_t>(meshlets.size()), indexBuffer, indexType, modelLods[0].indexCount, 0);
 }
 
 
-VkCommandBuffer HelloTriangleApplication::beginSingleTimeCommands(VkCommandPool commandPool){
+void HelloTriangleApplication::createOccluderMesh(){
 
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = commandPool;
-	allocInfo.commandBufferCount = 1;
+	TRACE_FUNCTION();
 
+	//The packed vertices are all there is once the model came from the mesh cache, so the positions are decoded from
+	//them as the input assembler would, and dequantized like ubo.model does.
+	VkVertexInputBindingDescription binding = PackedVertex::getBindingDescription();
+	VkVertexInputAttributeDescription position = PackedVertex::getAttributeDescriptions()[0];
+	size_t vertexCount = static_cast<size_t>(modelVertexBytes / binding.stride);
 
-	VkCommandBuffer commandBuffer;
+	occluderPositions.resize(vertexCount * 3);
 
-	vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+	for (size_t v = 0; v < vertexCount; v++) {
 
+		const char* attribute = static_cast<const char*>(modelVertexData) + v * binding.stride + position.offset;
+		float* destination = &occluderPositions[v * 3];
 
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		for (int axis = 0; axis < 3; axis++) {
 
+			float value;
 
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+			if (position.format == VK_FORMAT_R16G16B16A16_SNORM) {
 
+				int16_t component;
+				memcpy(&component, attribute + axis * sizeof(int16_t), sizeof(component));
+				value = std::max(component / 32767.0f, -1.0f);
+			}
+			else if (position.format == VK_FORMAT_R32G32B32_SFLOAT) {
 
+				memcpy(&value, attribute + axis * sizeof(float), sizeof(value));
+			}
+			else {
 
-	return commandBuffer;
-}
+				throw std::runtime_error("Unsupported vertex position format for occlusion culling!");
+			}
+
+			destination[axis] = modelQuantization.positionOffset[axis] + value * modelQuantization.positionScale[axis];
+		}
+	}
 
 
-void HelloTriangleApplication::endSingleTimeCommands(VkCommandBuffer commandBuffer, VkCommandPool commandPool){
+	//The full mesh: a coarser level could poke out of the model's silhouette and hide what is really visible.
+	const MeshLod& fullMesh = modelLods[0];
 
-	vkEndCommandBuffer(commandBuffer);
+	occluderIndices.resize(fullMesh.indexCount);
 
+	for (uint32_t i = 0; i < fullMesh.indexCount; i++) {
 
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
+		uint32_t index = fullMesh.firstIndex + i;
+		occluderIndices[i] = indexType == VK_INDEX_TYPE_UINT16 ? static_cast<const uint16_t*>(modelIndexData)[index] : static_cast<const uint32_t*>(modelIndexData)[index];
+	}
+}
 
 
-	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
+void HelloTriangleApplication::assignClusterSlots(){
 
+	clusterInstances.clear();
 
-	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+	//Only the full mesh has meshlets; coarser levels and the visible instances past the last slot draw as before.
+	visibleInstanceSlots.assign(visibleInstances.size(), NO_SLOT);
+
+	for (size_t i = 0; i < visibleInstances.size() && clusterInstances.size() < clusterCuller.getSlotCount(); i++) {
+
+		if (visibleInstanceLods[i] == 0) {
+
+			visibleInstanceSlots[i] = static_cast<uint32_t>(clusterInstances.size());
+			clusterInstances.push_back(visibleInstances[i]);
+		}
+	}
 }
 
 
-void HelloTriangleApplication::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels){
+void HelloTriangleApplication::selectInstanceLods(){
 
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(transferCommandPool);
+	visibleInstanceLods.assign(visibleInstances.size(), 0);
 
+	if (!isLodSelectionActive()) {
+		return;
+	}
 
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.oldLayout = oldLayout;
-	barrier.newLayout = newLayout;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.image = image;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = mipLevels;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
+	TRACE_FUNCTION();
 
+	const float* nearPlane = frameFrustum.planes[Frustum::Near];
 
-	VkPipelineStageFlags sourceStage;
-	VkPipelineStageFlags destinationStage;
+	for (size_t i = 0; i < visibleInstances.size(); i++) {
 
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+		uint32_t instance = visibleInstances[i];
 
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		//The instance's scale is how much its sphere grew over the model's.
+		float distance = nearPlane[0] * instanceBounds.centerX[instance] + nearPlane[1] * instanceBounds.centerY[instance] + nearPlane[2] * instanceBounds.centerZ[instance]
+			+ nearPlane[3];
+		float lodFactor = frameLodScale * (instanceBounds.radius[instance] / modelBoundingRadius) / std::max(distance, 1e-4f);
 
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+		uint32_t lod = 0;
 
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		while (lod + 1 < modelLods.size() && modelLods[lod + 1].error * lodFactor <= 1.0f) {
+			lod++;
+		}
 
-		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		visibleInstanceLods[i] = lod;
 	}
-	else {
+}
+
 
-		throw std::invalid_argument("Unsupported layout transition!");
+void HelloTriangleApplication::cullOccludedInstances(){
+
+	//Low resolution, in the swap chain's aspect ratio.
+	uint32_t height = std::max(OCCLUSION_BUFFER_WIDTH * swapChainExtent.height / std::max(swapChainExtent.width, 1u), 1u);
+
+	if (occlusionRasterizer.getWidth() != OCCLUSION_BUFFER_WIDTH || occlusionRasterizer.getHeight() != height) {
+		occlusionRasterizer.resize(OCCLUSION_BUFFER_WIDTH, height);
 	}
 
 
+	//The best occluders cover the most screen: the largest bounding spheres relative to their distance (clip w).
+	occluderCandidates.clear();
 
-	vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	for (uint32_t instance : visibleInstances) {
 
+		const glm::mat4& m = frameViewProjection;
+		float w = m[0][3] * instanceBounds.centerX[instance] + m[1][3] * instanceBounds.centerY[instance] + m[2][3] * instanceBounds.centerZ[instance] + m[3][3];
 
+		occluderCandidates.push_back({ instanceBounds.radius[instance] / std::max(w, 0.001f), instance });
+	}
 
-	endSingleTimeCommands(commandBuffer, transferCommandPool);
-}
+	size_t occluderCount = std::min<size_t>(OCCLUDER_COUNT, occluderCandidates.size());
 
+	std::partial_sort(occluderCandidates.begin(), occluderCandidates.begin() + occluderCount, occluderCandidates.end(),
+		[](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; });
 
-void HelloTriangleApplication::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height){
 
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(transferCommandPool);
+	occlusionRasterizer.clearOccluders();
 
+	for (size_t i = 0; i < occluderCount; i++) {
 
-	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = { width, height, 1 };
+		const float (*rows)[4] = scene.getTransforms()[occluderCandidates[i].second].rows;
 
+		glm::mat4 model(1.0f);
 
-	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		for (int row = 0; row < 3; row++) {
+			for (int column = 0; column < 4; column++) {
+				model[column][row] = rows[row][column];
+			}
+		}
 
+		glm::mat4 modelViewProjection = frameViewProjection * model;
+
+		occlusionRasterizer.addOccluder(occluderPositions.data(), static_cast<uint32_t>(occluderPositions.size() / 3), occluderIndices.data(),
+			static_cast<uint32_t>(occluderIndices.size()), glm::value_ptr(modelViewProjection));
+	}
 
-	endSingleTimeCommands(commandBuffer, transferCommandPool);
+	occlusionRasterizer.rasterize();
+	occlusionRasterizer.cullBoxes(instanceBoxes, glm::value_ptr(frameViewProjection), visibleInstances);
+}
+
+
+const char* HelloTriangleApplication::getCullingMode() const{
+
+	if (isCpuCullingActive()) {
+
+		if (isSoftwareOcclusionActive()) {
+			return bvhCulling ? "bvh-occlusion" : "cpu-occlusion";
+		}
+
+		return bvhCulling ? "bvh" : "cpu";
+	}
+
+	if (isOcclusionCullingActive()) {
+		return "gpu-occlusion";
+	}
+
+	return isGpuCullingActive() ? "gpu" : "none";
+}
+
+
+uint32_t HelloTriangleApplication::getDrawCallCount() const{
+
+	if (isGpuCullingActive()) {
+		return gpuCuller.getIndirectCallCount() + (isClusterCullingActive() ? clusterCuller.getIndirectCallCount(static_cast<uint32_t>(currentFrame)) : 0);
+	}
+
+	if (isCpuCullingActive()) {
+		return static_cast<uint32_t>(visibleInstances.size());
+	}
+
+	return instancing ? static_cast<uint32_t>(scene.getBatches().size()) : scene.getInstanceCount();
+}
+
+
+void HelloTriangleApplication::createDescriptorPool(){
+
+	TRACE_FUNCTION();
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+
+
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool)) {
+
+		throw std::runtime_error("Failed to create descriptor pool!");
+	}
+}
+
+
+void HelloTriangleApplication::createDescriptorSets(){
+
+	TRACE_FUNCTION();
+
+	std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	allocInfo.pSetLayouts = layouts.data();
+
+
+	descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to allocate descriptor sets!");
+	}
+
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+		//The descriptor covers one UniformBufferObject, the dynamic offset given at bind time selects which one.
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = uniformBuffers[i];
+		bufferInfo.offset = 0;
+		bufferInfo.range = sizeof(UniformBufferObject);
+
+		
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = textureImageView;
+		imageInfo.sampler = textureSampler;
+		
+
+		std::array <VkWriteDescriptorSet, 2> descriptorWrites{};
+
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = descriptorSets[i];
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].dstArrayElement = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pBufferInfo = &bufferInfo;
+		descriptorWrites[0].pImageInfo = nullptr; //Optional
+		descriptorWrites[0].pTexelBufferView = nullptr; //Optional
+
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = descriptorSets[i];
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].dstArrayElement = 0;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pImageInfo = &imageInfo;
+
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+
+void HelloTriangleApplication::decodeTexture(){
+
+	TRACE_FUNCTION();
+
+	int texWidth, texHeight, texChannels;
+
+	
+	texturePixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+	if (!texturePixels) {
+		throw std::runtime_error("Failed to load texture image!");
+	}
+
+
+	mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+
+	textureWidth = texWidth;
+	textureHeight = texHeight;
+}
+
+
+void HelloTriangleApplication::createTextureImage(){
+
+	TRACE_FUNCTION();
+
+	VkDeviceSize imageSize = static_cast<VkDeviceSize>(textureWidth) * textureHeight * 4;
+
+
+	createImage(textureWidth, textureHeight, mipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation);
+
+
+	//The upload runs on the transfer queue while the model loads. Every mip level stays in TRANSFER_DST_OPTIMAL
+	//for the blits in finishStartupUploads(), which transition them to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+	uploader.uploadImage(textureImage, texturePixels, imageSize, static_cast<uint32_t>(textureWidth), static_cast<uint32_t>(textureHeight), mipLevels,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+
+
+	stbi_image_free(texturePixels);
+	texturePixels = nullptr;
+}
+
+
+void HelloTriangleApplication::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, GpuAllocation& imageAllocation){
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = width;
+	imageInfo.extent.height = height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = format;
+	imageInfo.tiling = tiling;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = usage;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create image!");
+	}
+
+
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+
+	GpuAllocator::ResourceType resourceType = tiling == VK_IMAGE_TILING_OPTIMAL ? GpuAllocator::ResourceType::Optimal : GpuAllocator::ResourceType::Linear;
+
+	imageAllocation = allocator.allocate(memRequirements, findMemoryType(memRequirements.memoryTypeBits, properties), resourceType);
+
+
+	vkBindImageMemory(device, image, imageAllocation.memory, imageAllocation.offset);
+}
+
+
+VkCommandBuffer HelloTriangleApplication::beginSingleTimeCommands(VkCommandPool commandPool){
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = commandPool;
+	allocInfo.commandBufferCount = 1;
+
+
+	VkCommandBuffer commandBuffer;
+
+	vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+
+
+	return commandBuffer;
+}
+
+
+void HelloTriangleApplication::endSingleTimeCommands(VkCommandBuffer commandBuffer, VkCommandPool commandPool){
+
+	vkEndCommandBuffer(commandBuffer);
+
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+
+	//Wait on this submission only rather than idling the whole queue.
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkFence fence;
+
+	if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create one-time command fence!");
+	}
+
+
+	vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence);
+	vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+	vkDestroyFence(device, fence, nullptr);
+
+
+	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
 
 void HelloTriangleApplication::createTextureImageView(){
 
+	TRACE_FUNCTION();
+
 	textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
 }
 
@@ -1243,6 +2071,8 @@ VkImageView HelloTriangleApplication::createImageView(VkImage image, VkFormat fo
 
 void HelloTriangleApplication::createTextureSampler(){
 
+	TRACE_FUNCTION();
+
 	VkSamplerCreateInfo samplerInfo{};
 	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
 	samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -1287,12 +2117,25 @@ uint32_t HelloTriangleApplication::findMemoryType(uint32_t typeFilter, VkMemoryP
 
 void HelloTriangleApplication::createDepthResources(){
 
+	TRACE_FUNCTION();
+
 	VkFormat depthFormat = findDepthFormat();
 
 
-	createImage(swapChainExtent.width, swapChainExtent.height, 1, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+	//Sampled when the depth pyramid is built from it.
+	createImage(swapChainExtent.width, swapChainExtent.height, 1, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageAllocation);
 
 	depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+
+
+	depthPyramid.create(depthImage, depthImageView, depthFormat, swapChainExtent.width, swapChainExtent.height);
+
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands(oneTimeCommandPool);
+	depthPyramid.recordReset(commandBuffer);
+	endSingleTimeCommands(commandBuffer, oneTimeCommandPool);
+
+	gpuCuller.setDepthPyramid(depthPyramid);
 }
 
 
@@ -1320,7 +2163,8 @@ VkFormat HelloTriangleApplication::findSupportedFormat(const std::vector<VkForma
 
 VkFormat HelloTriangleApplication::findDepthFormat(){
 
-	return findSupportedFormat({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+	return findSupportedFormat({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT }, VK_IMAGE_TILING_OPTIMAL,
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 }
 
 
@@ -1332,97 +2176,284 @@ bool HelloTriangleApplication::hasStencilComponent(VkFormat format){
 
 void HelloTriangleApplication::loadModel(){
 
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, err;
+	TRACE_FUNCTION();
+
+	auto loadStart = std::chrono::high_resolution_clock::now();
+
+	MeshCacheLayout layout = getVertexLayout();
+	std::string cachePath = modelPath + ".meshcache";
+	uint64_t sourceHash = 0;
+	bool cacheEnabled = useMeshCache && optimizeMesh;
+
+
+	if (cacheEnabled && !MeshCache::hashSourceFile(modelPath, sourceHash)) {
+
+		throw std::runtime_error("Failed to open model file! Filename: " + modelPath);
+	}
+
 
+	if (cacheEnabled && meshCache.open(cachePath, sourceHash, layout)) {
 
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str())) {
+		modelVertexData = meshCache.getVertexData();
+		modelVertexBytes = meshCache.getVertexCount() * layout.vertexStride;
+		modelIndexData = meshCache.getIndexData();
+		modelIndexBytes = meshCache.getIndexCount() * meshCache.getIndexSize();
+		indexCount = static_cast<uint32_t>(meshCache.getIndexCount());
+		indexType = meshCache.getIndexSize() == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+		modelQuantization = meshCache.getQuantization();
+		modelLods = meshCache.getLods();
+		meshlets = meshCache.getMeshlets();
 
-		throw std::runtime_error(warn + err);
+		meshCacheResult = "hit";
 	}
+	else {
 
+		std::vector<Vertex> corners;
+		loadModelCorners(corners);
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+		{
+			TRACE_ZONE("WeldVertices");
 
-	for (const auto& shape : shapes) {
+			VertexWelder welder;
+			welder.weld(corners, vertices, indices);
+		}
 
-		for (const auto& index : shape.mesh.indices) {
+		if (optimizeMesh) {
 
-			Vertex vertex{};
+			TRACE_ZONE("OptimizeMesh");
 
+			meshOptimizerReport = MeshOptimizer::optimize(vertices, indices, offsetof(Vertex, pos));
+			meshOptimized = true;
+		}
 
-			vertex.pos = {
+		{
+			TRACE_ZONE("GenerateLods");
 
-				attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2],
-			};
+			//Appended to the full mesh's indices, so all levels share one index buffer.
+			modelLods = MeshSimplifier::generateLods(vertices, indices, offsetof(Vertex, pos));
+		}
 
+		{
+			TRACE_ZONE("BuildMeshlets");
 
-			vertex.texCoord = {
+			//Of the full-precision positions, before they are quantized.
+			meshlets = MeshletBuilder::build(vertices, indices, modelLods[0].firstIndex, modelLods[0].indexCount, offsetof(Vertex, pos));
+		}
 
-				attrib.texcoords[2 * index.texcoord_index + 0],
-				1.0f - attrib.texcoords[2 * index.texcoord_index + 1],
-			};
+		packModel();
 
 
-			vertex.color = { 1.0f, 1.0f, 1.0f };
+		if (cacheEnabled) {
 
+			TRACE_ZONE("WriteMeshCache");
 
-			if (uniqueVertices.count(vertex) == 0) {
+			//Not fatal: the next launch simply parses the OBJ again.
+			uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
 
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
+			if (!MeshCache::write(cachePath, sourceHash, layout, modelQuantization, packedVertices.data(), packedVertices.size(), modelIndexData, indexSize, indexCount, modelLods,
+				meshlets)) {
+				std::cerr << "Failed to write mesh cache! Filename: " << cachePath << std::endl;
 			}
 
-			indices.push_back(uniqueVertices[vertex]);
+			meshCacheResult = "miss";
 		}
 	}
 
 
-
+	auto loadEnd = std::chrono::high_resolution_clock::now();
+	modelLoadMs = std::chrono::duration<double, std::milli>(loadEnd - loadStart).count();
 }
 
 
-void HelloTriangleApplication::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels){
+void HelloTriangleApplication::packModel(){
 
-	//Check if the image format supports linear blitting.
-	VkFormatProperties formatProperties;
+	TRACE_FUNCTION();
 
-	vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
+	if (PackedVertex::QUANTIZED_POSITIONS) {
+		modelQuantization = VertexQuantization::fromPositions(reinterpret_cast<const char*>(vertices.data()) + offsetof(Vertex, pos), sizeof(Vertex), vertices.size());
+	}
 
-	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
 
-		throw std::runtime_error("Texture image format does not support linear blitting!");
-	}
+	packedVertices.resize(vertices.size());
+	size_t wrappedTexCoords = 0;
 
+	for (size_t v = 0; v < vertices.size(); v++) {
 
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(transferCommandPool);
+		const Vertex& vertex = vertices[v];
 
-	
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.image = image;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
+		VertexAttributeValues values;
+		values.values[static_cast<size_t>(VertexSemantic::Position)] = &vertex.pos.x;
+		values.values[static_cast<size_t>(VertexSemantic::TexCoord)] = &vertex.texCoord.x;
 
+		packedVertices[v] = PackedVertex::encode(values, modelQuantization);
 
+		wrappedTexCoords += vertex.texCoord.x < 0.0f || vertex.texCoord.x > 1.0f || vertex.texCoord.y < 0.0f || vertex.texCoord.y > 1.0f;
+	}
 
-	int32_t mipWidth = texWidth;
-	int32_t mipHeight = texHeight;
+	//unorm16 texture coordinates are clamped, so a model relying on repeating textures renders wrong.
+	if (wrappedTexCoords > 0) {
+		std::cerr << "Warning: " << wrappedTexCoords << " texture coordinates are outside [0, 1] and were clamped! Model: " << modelPath << std::endl;
+	}
 
 
-	for (uint32_t i = 1; i < mipLevels; i++) {
+	modelVertexData = packedVertices.data();
+	modelVertexBytes = sizeof(PackedVertex) * packedVertices.size();
+	indexCount = static_cast<uint32_t>(indices.size());
 
-		barrier.subresourceRange.baseMipLevel = i - 1;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	if (vertices.size() <= std::numeric_limits<uint16_t>::max()) {
+
+		shortIndices.assign(indices.begin(), indices.end());
+
+		modelIndexData = shortIndices.data();
+		modelIndexBytes = sizeof(uint16_t) * shortIndices.size();
+		indexType = VK_INDEX_TYPE_UINT16;
+	}
+	else {
+
+		modelIndexData = indices.data();
+		modelIndexBytes = sizeof(uint32_t) * indices.size();
+		indexType = VK_INDEX_TYPE_UINT32;
+	}
+}
+
+
+MeshCacheLayout HelloTriangleApplication::getVertexLayout(){
+
+	MeshCacheLayout layout;
+	layout.vertexStride = PackedVertex::getBindingDescription().stride;
+
+	for (const auto& attribute : PackedVertex::getAttributeDescriptions()) {
+		layout.attributes.push_back({ attribute.location, static_cast<uint32_t>(attribute.format), attribute.offset });
+	}
+
+	return layout;
+}
+
+
+namespace {
+
+	//VertexWelder tells -0.0 and 0.0 apart by their bits, while they compare equal as floats.
+	float positiveZero(float value) {
+
+		return value == 0.0f ? 0.0f : value;
+	}
+}
+
+
+void HelloTriangleApplication::loadModelCorners(std::vector<Vertex>& corners){
+
+	TRACE_FUNCTION();
+
+	ObjMesh mesh;
+	ObjLoader loader(objBackend, objThreadCount);
+
+	loader.load(modelPath, mesh);
+
+
+	corners.resize(mesh.indices.size());
+
+	for (size_t i = 0; i < mesh.indices.size(); i++) {
+
+		const ObjIndex& index = mesh.indices[i];
+		Vertex& vertex = corners[i];
+
+
+		vertex.pos = {
+
+			positiveZero(mesh.positions[3 * index.position + 0]),
+			positiveZero(mesh.positions[3 * index.position + 1]),
+			positiveZero(mesh.positions[3 * index.position + 2]),
+		};
+
+
+		//Corners without texture coordinates sample the texture's (0, 0), like an OBJ vt of 0 0.
+		float u = index.texCoord >= 0 ? mesh.texCoords[2 * index.texCoord + 0] : 0.0f;
+		float v = index.texCoord >= 0 ? mesh.texCoords[2 * index.texCoord + 1] : 0.0f;
+
+		vertex.texCoord = {
+
+			positiveZero(u),
+			positiveZero(1.0f - v),
+		};
+	}
+}
+
+
+void HelloTriangleApplication::createUploader(){
+
+	TRACE_FUNCTION();
+
+	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+
+	uploader.init(device, physicalDevice, &allocator, transferQueue, indices.transferFamily.value(), indices.graphicsFamily.value());
+}
+
+
+void HelloTriangleApplication::finishStartupUploads(){
+
+	TRACE_FUNCTION();
+
+	//The vertex, index and texture uploads were queued earlier; in batched mode they go out together here.
+	if (uploader.isBatching()) {
+		uploader.submitBatch();
+	}
+
+	uploader.waitAll();
+
+
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands(oneTimeCommandPool);
+
+	gpuProfiler.beginFrame(commandBuffer, PROFILER_UPLOAD_SLOT);
+
+	uploader.recordAcquireBarriers(commandBuffer);
+
+	//Transitions the texture to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+	generateMipmaps(commandBuffer, textureImage, VK_FORMAT_R8G8B8A8_SRGB, textureWidth, textureHeight, mipLevels);
+
+	endSingleTimeCommands(commandBuffer, oneTimeCommandPool);
+
+
+	collectGpuProfile(PROFILER_UPLOAD_SLOT);
+}
+
+
+void HelloTriangleApplication::generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels){
+
+	//Check if the image format supports linear blitting.
+	VkFormatProperties formatProperties;
+
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
+
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+
+		throw std::runtime_error("Texture image format does not support linear blitting!");
+	}
+
+
+	gpuProfiler.beginScope(commandBuffer, "GenerateMipmaps");
+
+	
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = image;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.subresourceRange.levelCount = 1;
+
+
+
+	int32_t mipWidth = texWidth;
+	int32_t mipHeight = texHeight;
+
+
+	for (uint32_t i = 1; i < mipLevels; i++) {
+
+		barrier.subresourceRange.baseMipLevel = i - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
@@ -1446,8 +2477,12 @@ void HelloTriangleApplication::generateMipmaps(VkImage image, VkFormat imageForm
 
 
 
+		gpuProfiler.beginScope(commandBuffer, "Mip" + std::to_string(i));
+
 		vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
 
+		gpuProfiler.endScope(commandBuffer);
+
 
 		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -1476,8 +2511,7 @@ void HelloTriangleApplication::generateMipmaps(VkImage image, VkFormat imageForm
 	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
 
-
-	endSingleTimeCommands(commandBuffer, transferCommandPool);
+	gpuProfiler.endScope(commandBuffer);
 }
 
 
@@ -1488,6 +2522,57 @@ void HelloTriangleApplication::framebufferResizeCallback(GLFWwindow* window, int
 }
 
 
+void HelloTriangleApplication::mouseButtonCallback(GLFWwindow* window, int button, int action, int mods){
+
+	if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS) {
+		return;
+	}
+
+	auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+
+	double cursorX, cursorY;
+	glfwGetCursorPos(window, &cursorX, &cursorY);
+
+	app->pickInstance(cursorX, cursorY);
+}
+
+
+void HelloTriangleApplication::pickInstance(double cursorX, double cursorY){
+
+	int windowWidth, windowHeight;
+	glfwGetWindowSize(window, &windowWidth, &windowHeight);
+
+	if (windowWidth == 0 || windowHeight == 0) {
+		return;
+	}
+
+
+	//The cursor on the near & far planes. The projection's flipped Y already matches window coordinates.
+	float x = static_cast<float>(2.0 * cursorX / windowWidth - 1.0);
+	float y = static_cast<float>(2.0 * cursorY / windowHeight - 1.0);
+
+	glm::mat4 inverseViewProjection = glm::inverse(frameViewProjection);
+
+	glm::vec4 nearPoint = inverseViewProjection * glm::vec4(x, y, 0.0f, 1.0f);
+	glm::vec4 farPoint = inverseViewProjection * glm::vec4(x, y, 1.0f, 1.0f);
+
+	glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+	glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+
+
+	//Distances are in multiples of direction, so 1 reaches the far plane.
+	AabbRay ray{ { origin.x, origin.y, origin.z }, { direction.x, direction.y, direction.z }, 1.0f };
+	AabbRayHit hit = instanceTree.raycast(ray);
+
+	if (hit.userData == AabbTree::INVALID_USER_DATA) {
+		std::cout << "Picked nothing" << std::endl;
+	}
+	else {
+		std::cout << "Picked instance " << hit.userData << " at depth " << hit.distance << std::endl;
+	}
+}
+
+
 HelloTriangleApplication::SwapChainSupportDetails HelloTriangleApplication::querySwapChainSupport(VkPhysicalDevice device) {
 
 	SwapChainSupportDetails details;
@@ -1562,7 +2647,9 @@ VkExtent2D HelloTriangleApplication::chooseSwapExtent(const VkSurfaceCapabilitie
 }
 
 
-void HelloTriangleApplication::createSwapChain(){
+void HelloTriangleApplication::createSwapChain(VkSwapchainKHR oldSwapChain){
+
+	TRACE_FUNCTION();
 
 	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
@@ -1609,7 +2696,7 @@ void HelloTriangleApplication::createSwapChain(){
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	createInfo.oldSwapchain = oldSwapChain;
 
 
 	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
@@ -1626,8 +2713,31 @@ void HelloTriangleApplication::createSwapChain(){
 }
 
 
+void HelloTriangleApplication::createOffscreenTargets(){
+
+	TRACE_FUNCTION();
+
+	//Stand-in for the swap chain: one colour image per frame in flight, created with createImage() like any other attachment.
+	uint32_t imageCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+
+	swapChainImages.resize(imageCount);
+	offscreenImageAllocations.resize(imageCount);
+
+	SwapChainImageFormat = OFFSCREEN_FORMAT;
+	swapChainExtent = { static_cast<uint32_t>(WIDTH), static_cast<uint32_t>(HEIGHT) };
+
+
+	for (uint32_t i = 0; i < imageCount; i++) {
+
+		createImage(swapChainExtent.width, swapChainExtent.height, 1, SwapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImageAllocations[i]);
+	}
+}
+
+
 void HelloTriangleApplication::createImageViews(){
 
+	TRACE_FUNCTION();
+
 	swapChainImageViews.resize(swapChainImages.size());
 
 	for (size_t i = 0; i < swapChainImages.size(); i++) {
@@ -1672,6 +2782,8 @@ HelloTriangleApplication::HelloTriangleApplication() {
 
 void HelloTriangleApplication::run() {
 
+		startupStart = std::chrono::high_resolution_clock::now();
+
 		initWindow();
 		initVulkan();
 		mainLoop();
@@ -1717,11 +2829,17 @@ bool HelloTriangleApplication::checkValidationLayerSupport() {
 
 std::vector<const char*> HelloTriangleApplication::getRequiredExtensions() {
 
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	std::vector<const char*> extensions;
+
+	//Headless mode never creates a window surface, so GLFW's surface extensions are not needed.
+	if (!headless) {
 
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions;
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 
 	if (enableValidationLayers) {
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -1741,40 +2859,137 @@ void HelloTriangleApplication::initWindow() {
 	window = glfwCreateWindow(WIDTH, HEIGHT, "Volcanic Engine", nullptr, nullptr);
 	glfwSetWindowUserPointer(window, this);
 	glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+	glfwSetMouseButtonCallback(window, mouseButtonCallback);
 }
 
 
 void HelloTriangleApplication::initVulkan() {
 
-	createInstance();
-	setupDebugMessenger();
-	createSurface();
-	pickPhysicalDevice();
-	createLogicalDevice();
-	createSwapChain();
-	createImageViews();
-	createRenderPass();
-	createDescriptorSetLayout();
-	createGraphicsPipeline();
-	createCommandPool();
-	createDepthResources();
-	createFramebuffers();
-	createTextureImage();
-	createTextureImageView();
-	createTextureSampler();
-	loadModel();
-	createVertexBuffer();
-	createIndexBuffer();
-	createUniformBuffers();
-	createDescriptorPool();
-	createDescriptorSets();
-	createCommandBuffers();
-	createSyncObjects();
+	TRACE_FUNCTION();
+
+	//CPU-only asset work has no use for the device, so it runs on the job system while the instance, device and swap
+	//chain are created; the main thread only waits for an asset right before it uploads (or compiles) it.
+	typedef StartupGraph::Thread Thread;
+
+	StartupGraph::TaskId textureDecoded = startupGraph.add("DecodeTexture", Thread::Worker, [this]() { decodeTexture(); });
+	StartupGraph::TaskId modelLoaded = startupGraph.add("LoadModel", Thread::Worker, [this]() { loadModel(); });
+	StartupGraph::TaskId shadersRead = startupGraph.add("ReadShaders", Thread::Worker, [this]() { readShaders(); });
+	StartupGraph::TaskId sceneBuilt = startupGraph.add("BuildScene", Thread::Worker, [this]() { buildScene(); });
+
+	startupGraph.add("CreateInstance", Thread::Main, [this]() {
+
+		createInstance();
+		setupDebugMessenger();
+
+		if (!headless) {
+			createSurface();
+		}
+	});
+
+	startupGraph.add("CreateDevice", Thread::Main, [this]() {
+
+		pickPhysicalDevice();
+		createLogicalDevice();
+		createAllocator();
+		initGpuProfiler();
+		pipelineCache.init(device, physicalDevice, pipelineCachePath);
+		recorder.init(device, findQueueFamilies(physicalDevice).graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, recordThreadCount);
+	});
+
+	startupGraph.add("CreateSwapChain", Thread::Main, [this]() {
+
+		if (headless) {
+			createOffscreenTargets();
+		}
+		else {
+			createSwapChain();
+		}
+
+		createImageViews();
+		createRenderPass();
+		createDescriptorSetLayout();
+	});
+
+	startupGraph.add("CreateGraphicsPipeline", Thread::Main, [this]() {
+
+		createGraphicsPipeline();
+		gpuCuller.init(device, physicalDevice, &allocator, &pipelineCache, cullShaderCode, MAX_FRAMES_IN_FLIGHT, multiDrawIndirect);
+		clusterCuller.init(device, physicalDevice, &allocator, &pipelineCache, clusterCullShaderCode, MAX_FRAMES_IN_FLIGHT, multiDrawIndirect);
+		gpuCuller.setClusterSlots(clusterCuller);
+		depthPyramid.init(device, &allocator, &pipelineCache, depthPyramidShaderCode, storageImageExtendedFormats);
+	}, { shadersRead });
+
+	startupGraph.add("CreateFramebuffers", Thread::Main, [this]() {
+
+		createCommandPool();
+		createUploader();
+		createDepthResources();
+		createFramebuffers();
+
+		if (batchedUploads) {
+			uploader.beginBatch();
+		}
+	});
+
+	startupGraph.add("UploadTexture", Thread::Main, [this]() {
+
+		createTextureImage();
+		createTextureImageView();
+		createTextureSampler();
+	}, { textureDecoded });
+
+	startupGraph.add("UploadModel", Thread::Main, [this]() {
+
+		createVertexBuffer();
+		createIndexBuffer();
+		createInstanceBuffer();
+		createMeshletBuffer();
+		createCulledDraws();
+		createOccluderMesh();
+	}, { modelLoaded, sceneBuilt });
+
+	startupGraph.add("FinishUploads", Thread::Main, [this]() {
+
+		finishStartupUploads();
+		createUniformBuffers();
+		createDescriptorPool();
+		createDescriptorSets();
+		createCommandBuffers();
+		createSyncObjects();
+	});
+
+
+	startupGraph.run(parallelStartup, startupStart);
+
+	if (enableValidationLayers) {
+
+		allocator.printStats(std::cout);
+
+		std::cout << "Pipeline cache: " << pipelineCache.getLoadResult() << ", first pipeline created in " << pipelineCache.getFirstCreateMilliseconds() << " ms" << std::endl;
+
+		if (meshOptimized) {
+
+			std::cout << "Mesh optimization: ACMR " << meshOptimizerReport.before.acmr << " -> " << meshOptimizerReport.after.acmr
+				<< ", ATVR " << meshOptimizerReport.before.atvr << " -> " << meshOptimizerReport.after.atvr << std::endl;
+		}
+
+		std::cout << "Levels of detail:";
+
+		for (const MeshLod& lod : modelLods) {
+			std::cout << " " << lod.indexCount / 3 << " (" << lod.error << ")";
+		}
+
+		std::cout << " triangles (error)" << std::endl;
+
+		std::cout << "Meshlets: " << meshlets.size() << ", cluster culling up to " << clusterCuller.getSlotCount() << " instances a frame" << std::endl;
+	}
 }
 
 
 void HelloTriangleApplication::createSurface() {
 
+	TRACE_FUNCTION();
+
 	if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
 
 		throw std::runtime_error("Failed to create window surface!");
@@ -1784,6 +2999,8 @@ void HelloTriangleApplication::createSurface() {
 
 void HelloTriangleApplication::pickPhysicalDevice() {
 
+	TRACE_FUNCTION();
+
 	uint32_t deviceCount = 0;
 	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
 
@@ -1849,10 +3066,12 @@ int HelloTriangleApplication::rateDeviceSuitablity(VkPhysicalDevice device){
 
 void HelloTriangleApplication::createLogicalDevice(){
 
+	TRACE_FUNCTION();
+
 	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value() };
 
 	float queuePriority = 1.0f;
 	for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -1864,8 +3083,19 @@ void HelloTriangleApplication::createLogicalDevice(){
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+	//Lets the GPU culler issue all of its indirect draws with one call.
+	multiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+
+	//The depth pyramid's levels are rg32f storage images.
+	storageImageExtendedFormats = supportedFeatures.shaderStorageImageExtendedFormats == VK_TRUE;
+
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	deviceFeatures.multiDrawIndirect = multiDrawIndirect ? VK_TRUE : VK_FALSE;
+	deviceFeatures.shaderStorageImageExtendedFormats = storageImageExtendedFormats ? VK_TRUE : VK_FALSE;
 
 
 	VkDeviceCreateInfo createInfo = {};
@@ -1874,7 +3104,8 @@ void HelloTriangleApplication::createLogicalDevice(){
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
 
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+	//The swap chain extension is only needed when presenting to a window.
+	createInfo.enabledExtensionCount = headless ? 0 : static_cast<uint32_t>(deviceExtensions.size());
 	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
 	//enabledLayerCount & ppEnabledLayerNames now ignored by newer implementations of Vulkan (Still set for compatibility)
@@ -1893,6 +3124,15 @@ void HelloTriangleApplication::createLogicalDevice(){
 
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &presentQueue);
+	vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
+}
+
+
+void HelloTriangleApplication::createAllocator(){
+
+	TRACE_FUNCTION();
+
+	allocator.init(device, physicalDevice);
 }
 
 
@@ -1909,6 +3149,8 @@ void HelloTriangleApplication::populateDebugMessangerCreateInfo(VkDebugUtilsMess
 
 void HelloTriangleApplication::setupDebugMessenger() {
 
+	TRACE_FUNCTION();
+
 	if (!enableValidationLayers) return;
 
 	VkDebugUtilsMessengerCreateInfoEXT createInfo;
@@ -1923,6 +3165,8 @@ void HelloTriangleApplication::setupDebugMessenger() {
 
 void HelloTriangleApplication::createInstance() {
 
+	TRACE_FUNCTION();
+
 	if (enableValidationLayers && !checkValidationLayerSupport()) {
 		throw std::runtime_error("validation layers requested, but not available!");
 	}
@@ -1983,32 +3227,71 @@ void HelloTriangleApplication::mainLoop() {
 	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents();
 		drawFrame();
+		pipelineCache.update();
+
+		if (timeToFirstFrameMs == 0.0) {
+			finishStartup();
+		}
 	}
 
 	vkDeviceWaitIdle(device);
 }
 
 
+void HelloTriangleApplication::finishStartup() {
+
+	timeToFirstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startupStart).count();
+
+	if (enableValidationLayers && !headless) {
+
+		std::cout << "Startup (" << (parallelStartup ? "parallel" : "serial") << "), first frame after " << timeToFirstFrameMs << " ms:" << std::endl;
+		startupGraph.print(std::cout);
+	}
+}
+
+
 void HelloTriangleApplication::cleanup() {
 
 	cleanupSwapChain();
 
+	vkFreeCommandBuffers(device, drawCommandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+	cleanupGraphicsPipeline();
+
 	vkDestroySampler(device, textureSampler, nullptr);
 
 	vkDestroyImageView(device, textureImageView, nullptr);
 
 	vkDestroyImage(device, textureImage, nullptr);
-	vkFreeMemory(device, textureImageMemory, nullptr);
+	allocator.free(textureImageAllocation);
 
 
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+		vkDestroyBuffer(device, uniformBuffers[i], nullptr);
+		allocator.free(uniformBufferAllocations[i]);
+	}
+
+
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+
 	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
 
 	vkDestroyBuffer(device, indexBuffer, nullptr);
-	vkFreeMemory(device, indexBufferMemory, nullptr);
+	allocator.free(indexBufferAllocation);
 
 	vkDestroyBuffer(device, vertexBuffer, nullptr);
-	vkFreeMemory(device, vertexBufferMemory, nullptr);
+	allocator.free(vertexBufferAllocation);
+
+	vkDestroyBuffer(device, instanceBuffer, nullptr);
+	allocator.free(instanceBufferAllocation);
+
+	vkDestroyBuffer(device, meshletBuffer, nullptr);
+	allocator.free(meshletBufferAllocation);
+
+	gpuCuller.cleanup();
+	clusterCuller.cleanup();
+	depthPyramid.cleanup();
 
 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -2020,9 +3303,20 @@ void HelloTriangleApplication::cleanup() {
 
 
 	vkDestroyCommandPool(device, drawCommandPool, nullptr);
-	vkDestroyCommandPool(device, transferCommandPool, nullptr);
+	vkDestroyCommandPool(device, oneTimeCommandPool, nullptr);
+
+	recorder.cleanup();
+
+	uploader.cleanup();
+
+
+	gpuProfiler.cleanup();
+
+	pipelineCache.cleanup();
 
 
+	allocator.cleanup();
+
 	vkDestroyDevice(device, nullptr);
 
 
@@ -2030,6 +3324,12 @@ void HelloTriangleApplication::cleanup() {
 		DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 	}
 
+	if (headless) {
+
+		vkDestroyInstance(instance, nullptr);
+		return;
+	}
+
 	vkDestroySurfaceKHR(instance, surface, nullptr);
 	vkDestroyInstance(instance, nullptr);
 
@@ -2038,3 +3338,868 @@ void HelloTriangleApplication::cleanup() {
 	glfwTerminate();
 }
 
+
+void HelloTriangleApplication::runBenchmark(uint32_t frameCount) {
+
+	headless = true;
+
+	startupStart = std::chrono::high_resolution_clock::now();
+
+	initVulkan();
+
+	auto startupEnd = std::chrono::high_resolution_clock::now();
+	startupMs = std::chrono::duration<double, std::milli>(startupEnd - startupStart).count();
+
+	benchmarkLoop(frameCount);
+	printBenchmarkResults(frameCount);
+	cleanup();
+}
+
+
+void HelloTriangleApplication::benchmarkLoop(uint32_t frameCount) {
+
+	cpuFrameTimes.clear();
+	gpuFrameTimes.clear();
+	recordTimes.clear();
+	cpuFrameTimes.reserve(frameCount);
+	recordTimes.reserve(frameCount + BENCHMARK_WARMUP_FRAMES);
+	gpuFrameTimes.reserve(frameCount + BENCHMARK_WARMUP_FRAMES);
+
+
+	//Warm up first so pipeline creation, first-use allocations and driver caches don't skew the percentiles.
+	for (uint32_t i = 0; i < BENCHMARK_WARMUP_FRAMES; i++) {
+
+		drawFrame();
+
+		if (timeToFirstFrameMs == 0.0) {
+			finishStartup();
+		}
+	}
+
+	//Read back the warm-up submissions now so only timed frames end up in the samples.
+	vkDeviceWaitIdle(device);
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT); i++) {
+		collectGpuProfile(i);
+	}
+
+	gpuFrameTimes.clear();
+	recordTimes.clear();
+
+
+	for (uint32_t i = 0; i < frameCount; i++) {
+
+		auto frameStart = std::chrono::high_resolution_clock::now();
+
+		drawFrame();
+
+		auto frameEnd = std::chrono::high_resolution_clock::now();
+		cpuFrameTimes.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+	}
+
+	vkDeviceWaitIdle(device);
+
+
+	//Read back the frames that were still in flight when the loop finished.
+	for (uint32_t i = 0; i < static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT); i++) {
+		collectGpuProfile(i);
+	}
+}
+
+
+void HelloTriangleApplication::printBenchmarkResults(uint32_t frameCount) {
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+
+	std::cout << "{\"benchmark\":\"headless\"";
+	std::cout << ",\"device\":\"" << Benchmark::escapeJson(deviceProperties.deviceName) << "\"";
+	std::cout << ",\"width\":" << swapChainExtent.width << ",\"height\":" << swapChainExtent.height;
+	std::cout << ",\"startupMs\":" << startupMs << ",\"timeToFirstFrameMs\":" << timeToFirstFrameMs;
+	std::cout << ",\"startup\":{\"mode\":\"" << (parallelStartup ? "parallel" : "serial") << "\",\"tasks\":";
+	startupGraph.writeJson(std::cout);
+	std::cout << "}";
+	std::cout << ",\"modelLoadMs\":" << modelLoadMs << ",\"meshCache\":\"" << meshCacheResult << "\"";
+	std::cout << ",\"vertexBufferBytes\":" << modelVertexBytes << ",\"indexBufferBytes\":" << modelIndexBytes;
+
+	std::cout << ",\"lods\":[";
+	for (size_t i = 0; i < modelLods.size(); i++) {
+		std::cout << (i > 0 ? "," : "") << "{\"triangles\":" << modelLods[i].indexCount / 3 << ",\"error\":" << modelLods[i].error << "}";
+	}
+	std::cout << "],\"lodSelection\":" << (isLodSelectionActive() ? "true" : "false") << ",\"meshlets\":" << meshlets.size();
+
+	std::cout << ",\"meshOptimizer\":";
+	if (meshOptimized) {
+		std::cout << "{\"acmrBefore\":" << meshOptimizerReport.before.acmr << ",\"acmrAfter\":" << meshOptimizerReport.after.acmr
+			<< ",\"atvrBefore\":" << meshOptimizerReport.before.atvr << ",\"atvrAfter\":" << meshOptimizerReport.after.atvr << "}";
+	}
+	else {
+		std::cout << "null";
+	}
+	std::cout << ",\"pipelineCache\":{\"result\":\"" << pipelineCache.getLoadResult() << "\",\"loadedBytes\":" << pipelineCache.getLoadedBytes()
+		<< ",\"pipelines\":" << pipelineCache.getPipelineCount() << ",\"firstCreateMs\":" << pipelineCache.getFirstCreateMilliseconds()
+		<< ",\"totalCreateMs\":" << pipelineCache.getTotalCreateMilliseconds() << "}";
+	std::cout << ",\"uploads\":{\"mode\":\"" << (batchedUploads ? "batched" : "immediate") << "\",\"submits\":" << uploader.getSubmitCount()
+		<< ",\"uploads\":" << uploader.getUploadCount() << "}";
+	std::cout << ",\"frames\":" << frameCount << ",\"warmupFrames\":" << BENCHMARK_WARMUP_FRAMES;
+	std::cout << ",\"sceneObjects\":" << sceneObjectCount << ",\"instancing\":" << (instancing ? "true" : "false")
+		<< ",\"culling\":\"" << getCullingMode() << "\",\"drawCalls\":" << getDrawCallCount()
+		<< ",\"visibleInstances\":" << visibleInstanceCount << ",\"frustumCulled\":" << cullStatistics.frustumCulledCount
+		<< ",\"occlusionCulled\":" << cullStatistics.occlusionCulledCount << ",\"drawnTriangles\":" << cullStatistics.drawnTriangleCount
+		<< ",\"recordThreads\":" << recorder.getMaxSliceCount();
+
+	std::cout << ",\"clusters\":";
+	if (isClusterCullingActive()) {
+		std::cout << "{\"instances\":" << clusterStatistics.instanceCount << ",\"visible\":" << clusterStatistics.visibleCount
+			<< ",\"frustumCulled\":" << clusterStatistics.frustumCulledCount << ",\"backfaceCulled\":" << clusterStatistics.backfaceCulledCount << "}";
+	}
+	else {
+		std::cout << "null";
+	}
+
+	std::cout << ",\"recordMs\":";
+	Benchmark::writeJson(std::cout, Benchmark::computeStats(recordTimes));
+
+	std::cout << ",\"cpuFrameMs\":";
+	Benchmark::writeJson(std::cout, Benchmark::computeStats(cpuFrameTimes));
+
+	std::cout << ",\"gpuFrameMs\":";
+	if (gpuProfiler.isSupported()) {
+		Benchmark::writeJson(std::cout, Benchmark::computeStats(gpuFrameTimes));
+	}
+	else {
+		std::cout << "null";
+	}
+
+	std::cout << ",\"gpuMemory\":";
+	allocator.writeStatsJson(std::cout);
+
+	std::cout << "}" << std::endl;
+}
+
+
+void HelloTriangleApplication::runInstanceBenchmark(uint32_t frameCount){
+
+	const uint32_t INSTANCE_COUNTS[] = { 1, 10, 100, 1000, 10000, 100000 };
+
+	headless = true;
+	startupStart = std::chrono::high_resolution_clock::now();
+
+	initVulkan();
+
+
+	std::cout << "{\"benchmark\":\"instancing\",\"frames\":" << frameCount << ",\"warmupFrames\":" << BENCHMARK_WARMUP_FRAMES;
+	std::cout << ",\"recordThreads\":" << recorder.getMaxSliceCount() << ",\"runs\":[";
+
+	bool firstRun = true;
+
+	for (uint32_t instanceCount : INSTANCE_COUNTS) {
+
+		//Nothing may still read the old instance buffer.
+		vkDeviceWaitIdle(device);
+
+		vkDestroyBuffer(device, instanceBuffer, nullptr);
+		allocator.free(instanceBufferAllocation);
+
+		sceneObjectCount = instanceCount;
+		buildScene();
+		createInstanceBuffer();
+		createCulledDraws();
+
+		uploader.waitAll();
+
+
+		//GPU culled & indirect with and without occlusion culling, instanced, one draw per instance (CPU culled unless
+		//--no-cpu-culling) with and without software occlusion culling, then cluster culled after GPU culling with
+		//occlusion culling and after CPU culling with software occlusion.
+		const bool MODES[][4] = { { true, true, true, false }, { true, true, false, false }, { true, false, false, false }, { false, false, true, false },
+			{ false, false, false, false }, { true, true, true, true }, { false, false, true, true } };
+
+		for (const bool* mode : MODES) {
+
+			instancing = mode[0];
+			gpuCulling = mode[1];
+			occlusionCulling = mode[2];
+			softwareOcclusion = mode[2];
+			clusterCulling = mode[3];
+			benchmarkLoop(frameCount);
+
+			std::cout << (firstRun ? "" : ",") << "{\"instances\":" << instanceCount << ",\"instancing\":" << (instancing ? "true" : "false");
+			std::cout << ",\"culling\":\"" << getCullingMode() << "\",\"drawCalls\":" << getDrawCallCount();
+			std::cout << ",\"visibleInstances\":" << visibleInstanceCount << ",\"frustumCulled\":" << cullStatistics.frustumCulledCount;
+			std::cout << ",\"occlusionCulled\":" << cullStatistics.occlusionCulledCount << ",\"drawnTriangles\":" << cullStatistics.drawnTriangleCount;
+			std::cout << ",\"clusterCulledMeshlets\":" << clusterStatistics.frustumCulledCount + clusterStatistics.backfaceCulledCount;
+
+			std::cout << ",\"recordMs\":";
+			Benchmark::writeJson(std::cout, Benchmark::computeStats(recordTimes));
+
+			std::cout << ",\"cpuFrameMs\":";
+			Benchmark::writeJson(std::cout, Benchmark::computeStats(cpuFrameTimes));
+
+			std::cout << ",\"gpuFrameMs\":";
+			if (gpuProfiler.isSupported()) {
+				Benchmark::writeJson(std::cout, Benchmark::computeStats(gpuFrameTimes));
+			}
+			else {
+				std::cout << "null";
+			}
+
+			std::cout << "}";
+			firstRun = false;
+		}
+	}
+
+	std::cout << "]}" << std::endl;
+
+	cleanup();
+}
+
+
+void HelloTriangleApplication::runResizeBenchmark(uint32_t iterations){
+
+	startupStart = std::chrono::high_resolution_clock::now();
+
+	initWindow();
+	initVulkan();
+
+
+	//Frames to wait for the window system to apply a resize before giving up on that iteration.
+	const uint32_t MAX_FRAMES_PER_RESIZE = 120;
+
+	std::vector<double> resizeToPresentTimes;
+	swapChainRecreateTimes.clear();
+
+	for (uint32_t i = 0; i < iterations && !glfwWindowShouldClose(window); i++) {
+
+		int width = i % 2 == 0 ? WIDTH * 3 / 4 : WIDTH;
+		int height = i % 2 == 0 ? HEIGHT * 3 / 4 : HEIGHT;
+
+		auto resizeStart = std::chrono::high_resolution_clock::now();
+
+		glfwSetWindowSize(window, width, height);
+
+
+		//drawFrame() recreates the swap chain once presenting reports it out of date (or the resize callback fired),
+		//then the next frame is the first one at the new size.
+		size_t recreateCount = swapChainRecreateTimes.size();
+		uint32_t frames = 0;
+
+		while (swapChainRecreateTimes.size() == recreateCount && frames++ < MAX_FRAMES_PER_RESIZE) {
+
+			glfwPollEvents();
+			drawFrame();
+		}
+
+		if (swapChainRecreateTimes.size() == recreateCount) {
+			continue;
+		}
+
+		glfwPollEvents();
+		drawFrame();
+
+		resizeToPresentTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - resizeStart).count());
+	}
+
+	vkDeviceWaitIdle(device);
+
+
+	std::cout << "{\"benchmark\":\"resize\"";
+	std::cout << ",\"mode\":\"" << (incrementalSwapChainRecreation ? "incremental" : "full") << "\"";
+	std::cout << ",\"iterations\":" << iterations << ",\"resizes\":" << resizeToPresentTimes.size();
+
+	std::cout << ",\"recreateMs\":";
+	Benchmark::writeJson(std::cout, Benchmark::computeStats(swapChainRecreateTimes));
+
+	std::cout << ",\"resizeToPresentMs\":";
+	Benchmark::writeJson(std::cout, Benchmark::computeStats(resizeToPresentTimes));
+
+	std::cout << "}" << std::endl;
+
+	cleanup();
+}
+
+
+void HelloTriangleApplication::runWeldBenchmark(uint32_t iterations){
+
+	std::vector<Vertex> corners;
+	loadModelCorners(corners);
+
+	VertexWelder serialWelder(1);
+	VertexWelder parallelWelder;
+
+	std::vector<double> mapTimes, serialTimes, parallelTimes;
+	bool matches = true;
+
+	auto elapsedMs = [](std::chrono::high_resolution_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+
+	for (uint32_t i = 0; i < iterations; i++) {
+
+		//The welding loop loadModel() used before VertexWelder.
+		std::vector<Vertex> mapVertices;
+		std::vector<uint32_t> mapIndices;
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+		for (const auto& vertex : corners) {
+
+			if (uniqueVertices.count(vertex) == 0) {
+
+				uniqueVertices[vertex] = static_cast<uint32_t>(mapVertices.size());
+				mapVertices.push_back(vertex);
+			}
+
+			mapIndices.push_back(uniqueVertices[vertex]);
+		}
+
+		mapTimes.push_back(elapsedMs(start));
+
+
+		std::vector<Vertex> serialVertices, parallelVertices;
+		std::vector<uint32_t> serialIndices, parallelIndices;
+
+		start = std::chrono::high_resolution_clock::now();
+		serialWelder.weld(corners, serialVertices, serialIndices);
+		serialTimes.push_back(elapsedMs(start));
+
+		start = std::chrono::high_resolution_clock::now();
+		parallelWelder.weld(corners, parallelVertices, parallelIndices);
+		parallelTimes.push_back(elapsedMs(start));
+
+
+		matches = matches && mapVertices == serialVertices && mapVertices == parallelVertices && mapIndices == serialIndices && mapIndices == parallelIndices;
+
+		if (i + 1 == iterations) {
+			vertices = std::move(parallelVertices);
+		}
+	}
+
+
+	SampleStats mapStats = Benchmark::computeStats(mapTimes);
+	SampleStats parallelStats = Benchmark::computeStats(parallelTimes);
+
+	std::cout << "{\"benchmark\":\"weld\"";
+	std::cout << ",\"model\":\"" << Benchmark::escapeJson(modelPath) << "\"";
+	std::cout << ",\"corners\":" << corners.size() << ",\"uniqueVertices\":" << vertices.size();
+	std::cout << ",\"iterations\":" << iterations << ",\"threads\":" << parallelWelder.getThreadCount();
+	std::cout << ",\"matches\":" << (matches ? "true" : "false");
+
+	std::cout << ",\"unorderedMapMs\":";
+	Benchmark::writeJson(std::cout, mapStats);
+
+	std::cout << ",\"welderSerialMs\":";
+	Benchmark::writeJson(std::cout, Benchmark::computeStats(serialTimes));
+
+	std::cout << ",\"welderParallelMs\":";
+	Benchmark::writeJson(std::cout, parallelStats);
+
+	std::cout << ",\"speedup\":" << (parallelStats.p50 > 0.0 ? mapStats.p50 / parallelStats.p50 : 0.0);
+	std::cout << "}" << std::endl;
+
+
+	if (!matches) {
+		throw std::runtime_error("VertexWelder output differs from the std::unordered_map pass!");
+	}
+}
+
+
+void HelloTriangleApplication::runJobBenchmark(uint32_t iterations){
+
+	//Per-job overheads are measured over this many empty jobs; the scaling workload hashes this many chunks.
+	const uint32_t jobCount = 4000;
+	const uint32_t chunkCount = 1024;
+	const size_t chunkBytes = 64 * 1024;
+
+	auto elapsedMs = [](std::chrono::high_resolution_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	JobSystem& jobs = JobSystem::getDefault();
+	std::vector<double> spawnTimes, stealTimes;
+
+
+	for (uint32_t i = 0; i < iterations; i++) {
+
+		//Spawn and run on the calling worker: what a job costs when nobody else touches it.
+		JobCounter spawnCounter;
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t job = 0; job < jobCount; job++) {
+			jobs.spawn([]() {}, &spawnCounter);
+		}
+
+		jobs.wait(spawnCounter);
+		spawnTimes.push_back(elapsedMs(start) * 1e6 / jobCount);
+
+
+		//The caller only watches the counter, so every job has to be stolen by another worker.
+		if (jobs.getThreadCount() > 1) {
+
+			JobCounter stealCounter;
+
+			start = std::chrono::high_resolution_clock::now();
+
+			for (uint32_t job = 0; job < jobCount; job++) {
+				jobs.spawn([]() {}, &stealCounter);
+			}
+
+			while (!stealCounter.isDone()) {
+				std::this_thread::yield();
+			}
+
+			stealTimes.push_back(elapsedMs(start) * 1e6 / jobCount);
+		}
+	}
+
+
+	std::vector<uint8_t> data(chunkCount * chunkBytes);
+
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+	}
+
+	std::vector<uint64_t> hashes(chunkCount);
+
+	std::cout << "{\"benchmark\":\"jobs\"";
+	std::cout << ",\"threads\":" << jobs.getThreadCount() << ",\"iterations\":" << iterations << ",\"jobs\":" << jobCount;
+
+	std::cout << ",\"spawnNs\":";
+	Benchmark::writeJson(std::cout, Benchmark::computeStats(spawnTimes));
+
+	std::cout << ",\"stealNs\":";
+	Benchmark::writeJson(std::cout, Benchmark::computeStats(stealTimes));
+
+	std::cout << ",\"scaling\":[";
+
+
+	//Separate systems per thread count, so the default one doesn't have to be resized.
+	double serialMs = 0.0;
+
+	for (uint32_t threads = 1; threads <= jobs.getThreadCount(); threads++) {
+
+		JobSystem scaled(threads);
+		std::vector<double> times;
+
+		for (uint32_t i = 0; i < iterations; i++) {
+
+			auto start = std::chrono::high_resolution_clock::now();
+
+			scaled.parallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+
+				for (uint32_t chunk = begin; chunk < end; chunk++) {
+					hashes[chunk] = Hash::xxHash64(data.data() + chunk * chunkBytes, chunkBytes);
+				}
+			});
+
+			times.push_back(elapsedMs(start));
+		}
+
+		SampleStats stats = Benchmark::computeStats(times);
+
+		if (threads == 1) {
+			serialMs = stats.p50;
+		}
+
+		std::cout << (threads > 1 ? "," : "") << "{\"threads\":" << threads << ",\"ms\":";
+		Benchmark::writeJson(std::cout, stats);
+		std::cout << ",\"speedup\":" << (stats.p50 > 0.0 ? serialMs / stats.p50 : 0.0) << "}";
+	}
+
+	std::cout << "]}" << std::endl;
+}
+
+
+void HelloTriangleApplication::runCullBenchmark(uint32_t iterations){
+
+	const uint32_t OBJECT_COUNTS[] = { 10000, 100000, 1000000 };
+
+	//The camera of updateUniformBuffer() at the default window size, looking into a cube of objects around the origin
+	//that reaches well past the far plane.
+	glm::mat4 proj = glm::perspective(glm::radians(45.0f), WIDTH / (float)HEIGHT, 0.1f, 10.0f);
+	proj[1][1] *= -1;
+
+	glm::mat4 viewProjection = proj * glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	Frustum frustum = Frustum::fromViewProjection(glm::value_ptr(viewProjection));
+
+	const float sceneExtent = 10.0f;
+	const float maxObjectSize = 0.5f;
+
+	//Random rays per batched raycast through the AABB tree.
+	const uint32_t rayCount = 10000;
+
+
+	std::vector<FrustumCuller::Isa> isas;
+
+	for (FrustumCuller::Isa isa : { FrustumCuller::Isa::Scalar, FrustumCuller::Isa::Sse, FrustumCuller::Isa::Avx }) {
+
+		if (FrustumCuller::isSupported(isa)) {
+			isas.push_back(isa);
+		}
+	}
+
+
+	std::cout << "{\"benchmark\":\"culling\",\"iterations\":" << iterations << ",\"threads\":" << JobSystem::getDefault().getThreadCount();
+	std::cout << ",\"bestIsa\":\"" << FrustumCuller::getIsaName(FrustumCuller::getBestIsa()) << "\",\"runs\":[";
+
+	bool firstRun = true;
+
+	//Printed after the runs.
+	std::ostringstream bvhJson;
+
+	for (uint32_t objectCount : OBJECT_COUNTS) {
+
+		//Fixed seed, so every ISA (and every run) culls the same objects.
+		std::mt19937 random(objectCount);
+		std::uniform_real_distribution<float> position(-sceneExtent, sceneExtent);
+		std::uniform_real_distribution<float> size(0.0f, maxObjectSize);
+
+		BoundingSpheres spheres;
+		BoundingBoxes boxes;
+		std::vector<float> boxCorners(objectCount * 6);
+		spheres.resize(objectCount);
+		boxes.resize(objectCount);
+
+		for (uint32_t i = 0; i < objectCount; i++) {
+
+			float center[3] = { position(random), position(random), position(random) };
+			float extent[3] = { size(random), size(random), size(random) };
+
+			float* min = &boxCorners[i * 6];
+			float* max = &boxCorners[i * 6 + 3];
+
+			for (int axis = 0; axis < 3; axis++) {
+
+				min[axis] = center[axis] - extent[axis];
+				max[axis] = center[axis] + extent[axis];
+			}
+
+			spheres.set(i, center, std::sqrt(extent[0] * extent[0] + extent[1] * extent[1] + extent[2] * extent[2]));
+			boxes.set(i, min, max);
+		}
+
+
+		for (bool useBoxes : { false, true }) {
+
+			//Every ISA has to pick exactly the objects the scalar kernel picks.
+			std::vector<uint32_t> reference;
+
+			for (FrustumCuller::Isa isa : isas) {
+				for (bool parallel : { false, true }) {
+
+					std::vector<uint32_t> visible;
+					std::vector<double> times;
+
+					for (uint32_t i = 0; i < iterations; i++) {
+
+						auto start = std::chrono::high_resolution_clock::now();
+
+						if (useBoxes) {
+							FrustumCuller::cullBoxes(frustum, boxes, visible, isa, parallel);
+						}
+						else {
+							FrustumCuller::cullSpheres(frustum, spheres, visible, isa, parallel);
+						}
+
+						times.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+					}
+
+					if (isa == FrustumCuller::Isa::Scalar && !parallel) {
+						reference = visible;
+					}
+					else if (visible != reference) {
+						throw std::runtime_error("Frustum culling results differ between ISAs!");
+					}
+
+
+					SampleStats stats = Benchmark::computeStats(times);
+
+					std::cout << (firstRun ? "" : ",") << "{\"objects\":" << objectCount << ",\"volume\":\"" << (useBoxes ? "box" : "sphere") << "\"";
+					std::cout << ",\"isa\":\"" << FrustumCuller::getIsaName(isa) << "\",\"parallel\":" << (parallel ? "true" : "false");
+					std::cout << ",\"visible\":" << visible.size() << ",\"ms\":";
+					Benchmark::writeJson(std::cout, stats);
+					std::cout << ",\"objectsPerNs\":" << (stats.p50 > 0.0 ? objectCount / (stats.p50 * 1e6) : 0.0) << "}";
+
+					firstRun = false;
+				}
+			}
+		}
+
+
+		//The same boxes in an AABB tree: inserted one by one, then rebuilt with the SAH.
+		AabbTree tree;
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < objectCount; i++) {
+			tree.insert(&boxCorners[i * 6], &boxCorners[i * 6 + 3], i);
+		}
+
+		double insertMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		float incrementalSahCost = tree.getSahCost();
+
+		start = std::chrono::high_resolution_clock::now();
+		tree.rebuild();
+		double rebuildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+
+		std::vector<uint32_t> visible;
+		std::vector<double> queryTimes;
+
+		for (uint32_t i = 0; i < iterations; i++) {
+
+			start = std::chrono::high_resolution_clock::now();
+			tree.queryFrustum(frustum, visible);
+			queryTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+
+
+		//Rays from random points of the scene in random directions, reaching across it.
+		std::vector<AabbRay> rays(rayCount);
+
+		for (AabbRay& ray : rays) {
+
+			for (int axis = 0; axis < 3; axis++) {
+
+				ray.origin[axis] = position(random);
+				ray.direction[axis] = position(random);
+			}
+
+			ray.maxDistance = 1.0f;
+		}
+
+		std::vector<AabbRayHit> hits(rayCount);
+		std::vector<double> rayTimes;
+
+		for (uint32_t i = 0; i < iterations; i++) {
+
+			start = std::chrono::high_resolution_clock::now();
+			tree.raycast(rays.data(), rayCount, hits.data());
+			rayTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+
+		uint32_t hitCount = static_cast<uint32_t>(std::count_if(hits.begin(), hits.end(), [](const AabbRayHit& hit) { return hit.userData != AabbTree::INVALID_USER_DATA; }));
+
+
+		SampleStats queryStats = Benchmark::computeStats(queryTimes);
+		SampleStats rayStats = Benchmark::computeStats(rayTimes);
+
+		bvhJson << (objectCount == OBJECT_COUNTS[0] ? "" : ",") << "{\"objects\":" << objectCount << ",\"insertMs\":" << insertMs
+			<< ",\"rebuildMs\":" << rebuildMs << ",\"incrementalSahCost\":" << incrementalSahCost << ",\"sahCost\":" << tree.getSahCost()
+			<< ",\"height\":" << tree.getHeight() << ",\"visible\":" << visible.size() << ",\"frustumMs\":";
+		Benchmark::writeJson(bvhJson, queryStats);
+		bvhJson << ",\"objectsPerNs\":" << (queryStats.p50 > 0.0 ? objectCount / (queryStats.p50 * 1e6) : 0.0);
+		bvhJson << ",\"rays\":" << rayCount << ",\"rayHits\":" << hitCount << ",\"raycastMs\":";
+		Benchmark::writeJson(bvhJson, rayStats);
+		bvhJson << ",\"raysPerMs\":" << (rayStats.p50 > 0.0 ? rayCount / rayStats.p50 : 0.0) << "}";
+	}
+
+	std::cout << "],\"bvh\":[" << bvhJson.str() << "]}" << std::endl;
+}
+
+
+void HelloTriangleApplication::runOcclusionBenchmark(uint32_t iterations){
+
+	const uint32_t RESOLUTIONS[][2] = { { 320, 180 }, { 960, 540 }, { 1920, 1080 } };
+
+	//A handful of large box occluders around the origin, seen by the camera of updateUniformBuffer(), in front of (and
+	//among) a cloud of small boxes.
+	const uint32_t occluderCount = 16;
+	const uint32_t boxCount = 100000;
+
+	glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 10.0f);
+	proj[1][1] *= -1;
+
+	glm::mat4 viewProjection = proj * glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	const float* vp = glm::value_ptr(viewProjection);
+
+
+	//Corner c of a box is at min or max along axis a by bit a of c.
+	const uint32_t boxIndices[] = {
+		0, 2, 6, 0, 6, 4,  1, 3, 7, 1, 7, 5,
+		0, 1, 5, 0, 5, 4,  2, 3, 7, 2, 7, 6,
+		0, 1, 3, 0, 3, 2,  4, 5, 7, 4, 7, 6 };
+
+	//Fixed seed, so every run rasterizes & tests the same boxes.
+	std::mt19937 random(occluderCount);
+	std::uniform_real_distribution<float> occluderPosition(-1.5f, 1.5f);
+	std::uniform_real_distribution<float> occluderSize(0.2f, 0.8f);
+	std::uniform_real_distribution<float> boxPosition(-3.0f, 3.0f);
+	std::uniform_real_distribution<float> boxSize(0.0f, 0.15f);
+
+	std::vector<float> occluderCorners(occluderCount * 8 * 3);
+
+	for (uint32_t i = 0; i < occluderCount; i++) {
+
+		float center[3] = { occluderPosition(random), occluderPosition(random), occluderPosition(random) };
+		float extent[3] = { occluderSize(random), occluderSize(random), occluderSize(random) };
+
+		for (int corner = 0; corner < 8; corner++) {
+			for (int axis = 0; axis < 3; axis++) {
+				occluderCorners[(i * 8 + corner) * 3 + axis] = center[axis] + ((corner >> axis) & 1 ? extent[axis] : -extent[axis]);
+			}
+		}
+	}
+
+	BoundingBoxes boxes;
+	boxes.resize(boxCount);
+
+	for (uint32_t i = 0; i < boxCount; i++) {
+
+		float min[3], max[3];
+
+		for (int axis = 0; axis < 3; axis++) {
+
+			float center = boxPosition(random);
+			float extent = boxSize(random);
+
+			min[axis] = center - extent;
+			max[axis] = center + extent;
+		}
+
+		boxes.set(i, min, max);
+	}
+
+	//Only what survives frustum culling is tested, as in the renderer.
+	std::vector<uint32_t> frustumVisible;
+	FrustumCuller::cullBoxes(Frustum::fromViewProjection(vp), boxes, frustumVisible);
+
+
+	std::vector<FrustumCuller::Isa> isas;
+
+	for (FrustumCuller::Isa isa : { FrustumCuller::Isa::Scalar, FrustumCuller::Isa::Sse, FrustumCuller::Isa::Avx }) {
+
+		if (FrustumCuller::isSupported(isa)) {
+			isas.push_back(isa);
+		}
+	}
+
+
+	std::cout << "{\"benchmark\":\"occlusion\",\"iterations\":" << iterations << ",\"threads\":" << JobSystem::getDefault().getThreadCount();
+	std::cout << ",\"bestIsa\":\"" << FrustumCuller::getIsaName(FrustumCuller::getBestIsa()) << "\",\"occluders\":" << occluderCount;
+	std::cout << ",\"boxes\":" << boxCount << ",\"frustumVisible\":" << frustumVisible.size() << ",\"runs\":[";
+
+	bool firstRun = true;
+
+	for (const uint32_t* resolution : RESOLUTIONS) {
+
+		OcclusionRasterizer rasterizer;
+		rasterizer.resize(resolution[0], resolution[1]);
+
+		//Every ISA has to produce exactly the scalar kernel's depth and visible boxes.
+		std::vector<float> referenceDepth;
+		std::vector<uint32_t> referenceVisible;
+
+		for (FrustumCuller::Isa isa : isas) {
+			for (bool parallel : { false, true }) {
+
+				std::vector<double> rasterizeTimes;
+				std::vector<double> testTimes;
+				std::vector<uint32_t> visible;
+
+				for (uint32_t i = 0; i < iterations; i++) {
+
+					auto start = std::chrono::high_resolution_clock::now();
+
+					rasterizer.clearOccluders();
+
+					for (uint32_t occluder = 0; occluder < occluderCount; occluder++) {
+						rasterizer.addOccluder(&occluderCorners[occluder * 8 * 3], 8, boxIndices, 36, vp);
+					}
+
+					rasterizer.rasterize(isa, parallel);
+
+					rasterizeTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+
+
+					visible = frustumVisible;
+
+					start = std::chrono::high_resolution_clock::now();
+					rasterizer.cullBoxes(boxes, vp, visible, isa, parallel);
+					testTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+				}
+
+				std::vector<float> depth(rasterizer.getDepth(), rasterizer.getDepth() + static_cast<size_t>(rasterizer.getStride()) * rasterizer.getHeight());
+
+				if (isa == FrustumCuller::Isa::Scalar && !parallel) {
+
+					referenceDepth = depth;
+					referenceVisible = visible;
+				}
+				else if (depth != referenceDepth || visible != referenceVisible) {
+					throw std::runtime_error("Occlusion culling results differ between ISAs!");
+				}
+
+
+				SampleStats rasterizeStats = Benchmark::computeStats(rasterizeTimes);
+				SampleStats testStats = Benchmark::computeStats(testTimes);
+				double pixels = static_cast<double>(resolution[0]) * resolution[1];
+
+				std::cout << (firstRun ? "" : ",") << "{\"width\":" << resolution[0] << ",\"height\":" << resolution[1];
+				std::cout << ",\"isa\":\"" << FrustumCuller::getIsaName(isa) << "\",\"parallel\":" << (parallel ? "true" : "false");
+				std::cout << ",\"triangles\":" << rasterizer.getTriangleCount() << ",\"rasterizeMs\":";
+				Benchmark::writeJson(std::cout, rasterizeStats);
+				std::cout << ",\"pixelsPerNs\":" << (rasterizeStats.p50 > 0.0 ? pixels / (rasterizeStats.p50 * 1e6) : 0.0);
+				std::cout << ",\"visible\":" << visible.size() << ",\"testMs\":";
+				Benchmark::writeJson(std::cout, testStats);
+				std::cout << ",\"boxesPerNs\":" << (testStats.p50 > 0.0 ? frustumVisible.size() / (testStats.p50 * 1e6) : 0.0) << "}";
+
+				firstRun = false;
+			}
+		}
+	}
+
+	std::cout << "]}" << std::endl;
+}
+
+
+void HelloTriangleApplication::runParseBenchmark(uint32_t iterations){
+
+	std::cout << "{\"benchmark\":\"objParse\"";
+	std::cout << ",\"model\":\"" << Benchmark::escapeJson(modelPath) << "\"";
+	std::cout << ",\"iterations\":" << iterations;
+
+
+	for (ObjLoader::Backend backend : { ObjLoader::Backend::TinyObj, ObjLoader::Backend::TinyObjOpt }) {
+
+		ObjLoader loader(backend, objThreadCount);
+		std::vector<double> parseTimes;
+		size_t fileBytes = 0;
+		size_t triangles = 0;
+
+
+		for (uint32_t i = 0; i < iterations; i++) {
+
+			ObjMesh mesh;
+
+			auto start = std::chrono::high_resolution_clock::now();
+
+			fileBytes = loader.load(modelPath, mesh);
+
+			auto end = std::chrono::high_resolution_clock::now();
+			parseTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+			triangles = mesh.indices.size() / 3;
+		}
+
+
+		//Rates are taken from the median so a cold page cache on the first run doesn't skew them.
+		SampleStats stats = Benchmark::computeStats(parseTimes);
+		double seconds = stats.p50 / 1000.0;
+
+		std::cout << ",\"" << ObjLoader::getBackendName(backend) << "\":{";
+		std::cout << "\"threads\":" << loader.getThreadCount() << ",\"bytes\":" << fileBytes << ",\"triangles\":" << triangles;
+		std::cout << ",\"mbPerSecond\":" << (seconds > 0.0 ? fileBytes / (1024.0 * 1024.0) / seconds : 0.0);
+		std::cout << ",\"trianglesPerSecond\":" << (seconds > 0.0 ? triangles / seconds : 0.0);
+		std::cout << ",\"parseMs\":";
+		Benchmark::writeJson(std::cout, stats);
+		std::cout << "}";
+	}
+
+	std::cout << "}" << std::endl;
+}
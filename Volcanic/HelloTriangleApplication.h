@@ -12,6 +12,29 @@
 #include <glm.hpp>
 #include <array>
 #include <gtx/hash.hpp>
+#include <gtc/type_aligned.hpp>
+#include <chrono>
+
+#include "GpuProfiler.h"
+#include "GpuAllocator.h"
+#include "UniformRing.h"
+#include "Uploader.h"
+#include "ObjLoader.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "VertexLayout.h"
+#include "PipelineCache.h"
+#include "ParallelRecorder.h"
+#include "StartupGraph.h"
+#include "Scene.h"
+#include "GpuCuller.h"
+#include "ClusterCuller.h"
+#include "DepthPyramid.h"
+#include "Frustum.h"
+#include "FrustumCuller.h"
+#include "AabbTree.h"
+#include "OcclusionRasterizer.h"
 
 
 
@@ -26,7 +49,8 @@ private:
 	VkDevice device;
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
-	VkSwapchainKHR swapChain;
+	VkQueue transferQueue;
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 	std::vector<VkImage> swapChainImages;
 	VkFormat SwapChainImageFormat;
 	VkExtent2D swapChainExtent;
@@ -36,30 +60,191 @@ private:
 	VkPipelineLayout pipelineLayout;
 	VkPipeline graphicsPipeline;
 	VkCommandPool drawCommandPool;
-	VkCommandPool transferCommandPool;
+	VkCommandPool oneTimeCommandPool;
 	VkSemaphore imageAvailableSemaphore;
 	VkSemaphore renderFinishedSemaphore;
 	size_t currentFrame = 0;
 	bool framebufferResized = false;
 	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
+	GpuAllocation vertexBufferAllocation;
 	VkBuffer indexBuffer;
-	VkDeviceMemory indexBufferMemory;
+	GpuAllocation indexBufferAllocation;
 	VkDescriptorPool descriptorPool;
 	uint32_t mipLevels;
 	VkImage textureImage;
-	VkDeviceMemory textureImageMemory;
+	GpuAllocation textureImageAllocation;
 	VkImageView textureImageView;
 	VkSampler textureSampler;
 	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
+	GpuAllocation depthImageAllocation;
 	VkImageView depthImageView;
+	GpuAllocator allocator;
+	Uploader uploader;
+	int32_t textureWidth = 0;
+	int32_t textureHeight = 0;
+
+	//Startup uploads share one staging arena & submission; off records one submission per upload (for comparison).
+	bool batchedUploads = true;
+	double startupMs = 0.0;
+
+	//Asset decoding overlaps device setup unless parallelStartup is off (for comparison). Times are measured from
+	//startupStart, taken before the window is created, up to the first submitted frame.
+	StartupGraph startupGraph;
+	bool parallelStartup = true;
+	std::chrono::high_resolution_clock::time_point startupStart;
+	double timeToFirstFrameMs = 0.0;
+	unsigned char* texturePixels = nullptr;
+	std::vector<char> vertShaderCode;
+	std::vector<char> fragShaderCode;
+	std::vector<char> cullShaderCode;
+	std::vector<char> clusterCullShaderCode;
+	std::vector<char> depthPyramidShaderCode;
+	GpuProfiler gpuProfiler;
+	std::string gpuProfilerCsvPath;
+
+	//Loaded when the device is created; empty path keeps it in memory only.
+	PipelineCache pipelineCache;
+	std::string pipelineCachePath = "pipeline.cache";
+	std::string modelPath = "Models/viking_room.obj";
+	ObjLoader::Backend objBackend = ObjLoader::Backend::TinyObj;
+	uint32_t objThreadCount = 0;
+
+	//The vertex & index buffers are filled from the welded vectors, or straight from the mapped mesh cache.
+	MeshCache meshCache;
+	bool useMeshCache = true;
+	const char* meshCacheResult = "disabled";
+	const void* modelVertexData = nullptr;
+	VkDeviceSize modelVertexBytes = 0;
+	const void* modelIndexData = nullptr;
+	VkDeviceSize modelIndexBytes = 0;
+	uint32_t indexCount = 0;
+
+	//The model's levels of detail, ranges of its index buffer with the full mesh first (generated on import and kept in
+	//the mesh cache). With lodSelection, every culled instance is drawn with the coarsest level whose error projects
+	//to at most LOD_PIXEL_ERROR pixels; off, always with the full mesh.
+	std::vector<MeshLod> modelLods;
+	bool lodSelection = true;
+
+	//Radius of the model's bounding sphere (before the instance transform), and what projects an error at a distance
+	//of 1 from the near plane to allowed pixels this frame.
+	float modelBoundingRadius = 0.0f;
+	float frameLodScale = 0.0f;
+
+	//The full mesh's meshlets, ranges of its index buffer (built on import and kept in the mesh cache). With
+	//clusterCulling, up to the culler's slots of the instances that survive GPU or CPU culling with the full mesh have
+	//their meshlets culled against the frustum & their normal cones in a compute pass, and only the survivors' indices
+	//are drawn.
+	std::vector<Meshlet> meshlets;
+	bool clusterCulling = true;
+	VkBuffer meshletBuffer = VK_NULL_HANDLE;
+	GpuAllocation meshletBufferAllocation;
+	ClusterCuller clusterCuller;
+	ClusterStatistics clusterStatistics;
+
+	//With CPU culling, the instances this frame's cluster culling draws, and the slot each of visibleInstances is drawn
+	//from (NO_SLOT for a regular draw).
+	std::vector<uint32_t> clusterInstances;
+	std::vector<uint32_t> visibleInstanceSlots;
+
+	//Where the camera is in the space of the instance transforms, for the meshlets' cone test.
+	glm::vec3 frameCameraPosition = glm::vec3(0.0f);
+
+	//16-bit indices whenever the model has few enough vertices.
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+	//Undone by the model matrix, so the shaders see the original positions.
+	VertexQuantization modelQuantization;
+	double modelLoadMs = 0.0;
+
+	//Only filled when the model was imported from the OBJ (the mesh cache stores the optimized result).
+	bool optimizeMesh = true;
+	bool meshOptimized = false;
+	MeshOptimizerReport meshOptimizerReport;
+
+	//The scene's instances live in a static instance buffer (vertex binding 1). Instancing draws each mesh's batch with
+	//one call; off, every instance is its own draw (for comparison). Either way the ParallelRecorder's jobs record them.
+	uint32_t sceneObjectCount = 1;
+	Scene scene;
+	bool instancing = true;
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+	GpuAllocation instanceBufferAllocation;
+
+	//With instancing, a compute pass culls the instances against frameFrustum and the batches are drawn indirectly
+	//from the surviving instances; off, every instance is drawn (for comparison).
+	bool gpuCulling = true;
+	bool multiDrawIndirect = false;
+	GpuCuller gpuCuller;
+	Frustum frameFrustum;
+	uint32_t visibleInstanceCount = 0;
+	CullStatistics cullStatistics;
+
+	//With GPU culling, the instances are also tested against a pyramid of the previous frame's depth, built after
+	//each render pass (needs shaderStorageImageExtendedFormats).
+	bool occlusionCulling = true;
+	bool storageImageExtendedFormats = false;
+	DepthPyramid depthPyramid;
+
+	//Without instancing, the instances' world-space spheres are culled on the CPU each frame and only visibleInstances
+	//are drawn; off, every instance is (for comparison).
+	bool cpuCulling = true;
+	BoundingSpheres instanceBounds;
+	std::vector<uint32_t> visibleInstances;
+	std::vector<uint32_t> visibleInstanceLods;
+
+	//The instances' world-space boxes, for mouse picking and (with bvhCulling) CPU culling in place of the linear pass.
+	//Rebuilt with the SAH in the background after the instances change.
+	bool bvhCulling = false;
+	AabbTree instanceTree;
+
+	//After CPU culling, the frustum-visible instances covering the most screen are rasterized (their whole mesh) into a
+	//low-resolution depth buffer, and the instances whose boxes are hidden behind them are dropped before the draws are
+	//recorded. For when neither a GPU culling pass nor a readback is an option.
+	bool softwareOcclusion = true;
+	OcclusionRasterizer occlusionRasterizer;
+	BoundingBoxes instanceBoxes;
+	std::vector<float> occluderPositions;
+	std::vector<uint32_t> occluderIndices;
+	std::vector<std::pair<float, uint32_t>> occluderCandidates;
+	glm::mat4 frameViewProjection = glm::mat4(1.0f);
+	uint32_t recordThreadCount = 0;
+	ParallelRecorder recorder;
+	uint32_t frameUniformOffset = 0;
+	std::vector<double> recordTimes;
+
+	//Incremental recreation only rebuilds what depends on the swap chain's extent; off rebuilds the render pass,
+	//pipeline & command buffers as well (for comparison).
+	bool incrementalSwapChainRecreation = true;
+	std::vector<double> swapChainRecreateTimes;
+
+	//Headless mode renders into offscreen images instead of a window surface & swap chain.
+	bool headless = false;
+	std::vector<GpuAllocation> offscreenImageAllocations;
+	std::vector<double> cpuFrameTimes;
+	std::vector<double> gpuFrameTimes;
 
 
 	const int WIDTH = 800;
 	const int HEIGHT = 600;
 
-	const std::string MODEL_PATH = "Models/viking_room.obj";
+	const VkFormat OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+	const uint32_t BENCHMARK_WARMUP_FRAMES = 10;
+
+	//Per frame in flight. At a 256 byte offset alignment this fits 16K uniform blocks a frame.
+	const VkDeviceSize UNIFORM_RING_SIZE = 4 * 1024 * 1024;
+
+	//The software occlusion buffer's width (its height follows the swap chain's aspect ratio) and most occluders a frame.
+	static constexpr uint32_t OCCLUSION_BUFFER_WIDTH = 320;
+	static constexpr uint32_t OCCLUDER_COUNT = 8;
+
+	//Screen-space error (in pixels) a level of detail may have where it is drawn.
+	static constexpr float LOD_PIXEL_ERROR = 1.0f;
+
+	//visibleInstanceSlots of an instance drawn without cluster culling.
+	static constexpr uint32_t NO_SLOT = ~0u;
+
+	//First of the three vec4 locations holding an instance's transform rows.
+	static constexpr uint32_t INSTANCE_TRANSFORM_LOCATION = 3;
+
 	const std::string TEXTURE_PATH = "Textures/viking_room.png";
 
 
@@ -71,52 +256,32 @@ private:
 
 public:
 
+	//Full-precision vertex the model is imported, welded and optimized as.
 	struct Vertex {
 
-		glm::vec3 pos;
-		glm::vec3 color;
-		glm::vec2 texCoord;
-
-		static VkVertexInputBindingDescription getBindingDescription() {
-
-			VkVertexInputBindingDescription bindingDescription{};
-			bindingDescription.binding = 0;
-			bindingDescription.stride = sizeof(Vertex);
-			bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-			return bindingDescription;
-		}
-
-		static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-
-			std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
-
-			
-			attributeDescriptions[0].binding = 0;
-			attributeDescriptions[0].location = 0;
-			attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-			attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-			attributeDescriptions[1].binding = 0;
-			attributeDescriptions[1].location = 1;
-			attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-			attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-			attributeDescriptions[2].binding = 0;
-			attributeDescriptions[2].location = 2;
-			attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-			attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-
-			return attributeDescriptions;
-		}
+		glm::packed_vec3 pos;
+		glm::packed_vec2 texCoord;
 
 		bool operator==(const Vertex& other) const {
 
-			return pos == other.pos && color == other.color && texCoord == other.texCoord;
+			return pos == other.pos && texCoord == other.texCoord;
 		}
 	};
 
+	//VertexWelder hashes and compares vertices as raw bytes, which padding would make depend on uninitialized memory.
+	static_assert(sizeof(Vertex) == sizeof(glm::packed_vec3) + sizeof(glm::packed_vec2), "Vertex must not contain padding");
+
+	//What the vertex buffer holds: 12 bytes (instead of 32 as floats) with snorm16 positions, quantized to the model's
+	//bounds, and unorm16 texture coordinates. Define VOLCANIC_FULL_PRECISION_VERTICES to upload floats instead.
+#ifdef VOLCANIC_FULL_PRECISION_VERTICES
+	typedef VertexLayout<
+		VertexAttribute<VertexSemantic::Position, 0, VertexEncoding::Float32x3>,
+		VertexAttribute<VertexSemantic::TexCoord, 2, VertexEncoding::Float32x2>> PackedVertex;
+#else
+	typedef VertexLayout<
+		VertexAttribute<VertexSemantic::Position, 0, VertexEncoding::Snorm16x4>,
+		VertexAttribute<VertexSemantic::TexCoord, 2, VertexEncoding::Unorm16x2>> PackedVertex;
+#endif
 
 private:
 
@@ -129,10 +294,13 @@ private:
 	std::vector<VkFence> inFlightFences;
 	std::vector<VkFence> imagesInFlight;
 	std::vector<VkBuffer> uniformBuffers;
-	std::vector<VkDeviceMemory> uniformBuffersMemory;
+	std::vector<GpuAllocation> uniformBufferAllocations;
+	std::vector<UniformRing> uniformRings;
 	std::vector<VkDescriptorSet> descriptorSets;
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
+	std::vector<PackedVertex> packedVertices;
+	std::vector<uint16_t> shortIndices;
 
 
 
@@ -148,11 +316,103 @@ public:
 
 	void run();
 
+	//Runs headless (no window or swap chain) for frameCount frames and prints frame-time percentiles as JSON.
+	void runBenchmark(uint32_t frameCount);
+
+	//Dumps per-scope GPU timings of every frame to a CSV file.
+	void setGpuProfilerCsvPath(const std::string& path);
+
+	void setBatchedUploads(bool enabled);
+
+	//On by default: texture decoding, model loading and shader reads run on the job system while the device is set up.
+	void setParallelStartup(bool enabled);
+
+	//On by default: compiled pipelines are kept in pipeline.cache and reused by later launches on the same GPU & driver.
+	void setPipelineCacheEnabled(bool enabled);
+
+	void setModelPath(const std::string& path);
+
+	//On by default: the welded model is cached in <model>.meshcache and loaded from there while the OBJ is unchanged.
+	void setMeshCacheEnabled(bool enabled);
+
+	//On by default: reorders the imported model for the vertex cache, overdraw and vertex fetch. Turning it off also
+	//bypasses the mesh cache, which only ever holds optimized meshes.
+	void setMeshOptimizationEnabled(bool enabled);
+
+	//threadCount only applies to the parallel parser; 0 uses every hardware thread.
+	void setObjParser(ObjLoader::Backend backend, uint32_t threadCount);
+
+	//Parses the model with both OBJ backends and prints their throughput (MB/s & triangles/s) as JSON.
+	void runParseBenchmark(uint32_t iterations);
+
+	//Welds the model's vertices with the old std::unordered_map pass and with VertexWelder (serial and parallel),
+	//checks that all of them agree and prints the timings as JSON. Needs no Vulkan device.
+	void runWeldBenchmark(uint32_t iterations);
+
+	//Times job spawn, steal and parallelFor scaling on the job system and prints them as JSON. Needs no Vulkan device.
+	void runJobBenchmark(uint32_t iterations);
+
+	//Resizes the window back and forth iterations times and prints how long swap chain recreation and the first
+	//frame at the new size took, as JSON.
+	void runResizeBenchmark(uint32_t iterations);
+
+	void setIncrementalSwapChainRecreation(bool enabled);
+
+	//Draws count instances of the model on a grid.
+	void setSceneObjectCount(uint32_t count);
+
+	//On by default: all instances of a mesh are drawn with one instanced draw call instead of one call each.
+	void setInstancingEnabled(bool enabled);
+
+	//On by default: with instancing, the instances are frustum culled by a compute pass and drawn indirectly.
+	void setGpuCullingEnabled(bool enabled);
+
+	//On by default: without instancing, the instances are frustum culled on the CPU before their draws are recorded.
+	void setCpuCullingEnabled(bool enabled);
+
+	//Off by default: CPU culling walks the instances' AABB tree instead of testing every instance with SIMD.
+	void setBvhCullingEnabled(bool enabled);
+
+	//On by default: GPU culling also drops instances hidden behind the previous frame's depth.
+	void setOcclusionCullingEnabled(bool enabled);
+
+	//On by default: CPU culling also drops instances hidden behind the nearest ones, rasterized in software.
+	void setSoftwareOcclusionEnabled(bool enabled);
+
+	//On by default: culled instances are drawn with the coarsest of the model's levels of detail that stays within
+	//LOD_PIXEL_ERROR pixels of the full mesh on screen.
+	void setLodSelectionEnabled(bool enabled);
+
+	//On by default: culled instances drawn with the full mesh only draw their meshlets inside the frustum that face the
+	//camera, culled by a compute pass.
+	void setClusterCullingEnabled(bool enabled);
+
+	//Frustum culls 10k to 1M random spheres and boxes with every supported ISA, on one thread and on the job system,
+	//and through an AABB tree (with its build times and batched raycasts), and prints objects/ns as JSON. Needs no
+	//Vulkan device.
+	void runCullBenchmark(uint32_t iterations);
+
+	//Rasterizes box occluders into the software occlusion buffer at 320x180 to 1920x1080 with every supported ISA, on one
+	//thread and on the job system, tests 100k boxes against it and prints pixels/ns and boxes/ns as JSON. Needs no
+	//Vulkan device.
+	void runOcclusionBenchmark(uint32_t iterations);
+
+	//Renders headless for frameCount frames at 1 to 100k instances, GPU culled with and without occlusion culling,
+	//instanced and one (CPU culled) draw per instance with and without software occlusion, and both occlusion culled
+	//ones also cluster culled, and prints the frame and recording times of each as JSON.
+	void runInstanceBenchmark(uint32_t frameCount);
+
+	//Most jobs recording the draws into secondary command buffers at once; 0 uses one per job system thread.
+	void setRecordThreadCount(uint32_t threadCount);
+
 	struct QueueFamilyIndices {
 
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
 
+		//A transfer-only family when the device has one, otherwise the graphics family.
+		std::optional<uint32_t> transferFamily;
+
 		bool isComplete() {
 			return graphicsFamily.has_value() && presentFamily.has_value();
 		}
@@ -177,7 +437,10 @@ private:
 	
 	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
-	void createSwapChain();
+	//Hands oldSwapChain over to the new swap chain; the caller destroys it afterwards.
+	void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+
+	void createOffscreenTargets();
 
 	void createImageViews();
 
@@ -189,6 +452,9 @@ private:
 
 	static std::vector<char> readFile(const std::string& filename);
 
+	//Fills vertShaderCode, fragShaderCode, cullShaderCode, clusterCullShaderCode & depthPyramidShaderCode. Runs on the job system during startup.
+	void readShaders();
+
 	void createRenderPass();
 
 	void createFramebuffers();
@@ -197,19 +463,33 @@ private:
 
 	void createCommandBuffers();
 
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+	//Records draws [begin, end) into a secondary command buffer: the culled indirect draws, instance batches, or single
+	//instances without instancing. Runs on the recorder's jobs.
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end);
+
 	void drawFrame();
 
 	void createSyncObjects();
 
+	void initGpuProfiler();
+
+	void collectGpuProfile(uint32_t slot);
+
+	//Destroys the extent-dependent resources and the swap chain (or offscreen images).
 	void cleanupSwapChain();
+
+	//Destroys the depth image, framebuffers & image views, which all depend on the swap chain's extent.
+	void cleanupSwapChainTargets();
+
+	void cleanupGraphicsPipeline();
 	
 	void recreateSwapChain();
 
 	void createVertexBuffer();
 
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, GpuAllocation& bufferAllocation);
 
 	void createIndexBuffer();
 
@@ -217,24 +497,77 @@ private:
 
 	void createUniformBuffers();
 
-	void updateUniformBuffer(uint32_t currentImage);
+	//Pushes the frame's uniform block into its ring and returns the block's dynamic offset. Also sets frameFrustum and
+	//frameLodScale.
+	uint32_t updateUniformBuffer();
+
+	//Fills the scene with sceneObjectCount copies of the model on a grid. Needs no device.
+	void buildScene();
+
+	static InstanceTransform toInstanceTransform(const glm::mat4& transform);
+
+	static VkVertexInputBindingDescription getInstanceBindingDescription(uint32_t binding);
+
+	static std::vector<VkVertexInputAttributeDescription> getInstanceAttributeDescriptions(uint32_t binding);
+
+	//Uploads the scene's transforms in batch order.
+	void createInstanceBuffer();
+
+	//Hands the scene's batches to the GPU culler (a draw per level of detail with lodSelection) and fills instanceBounds,
+	//both bounded by the sphere around the model's quantization box, and fills instanceTree & instanceBoxes with the box
+	//itself. Also hands the instance buffer & meshlets to the cluster culler. Call after createInstanceBuffer(),
+	//createIndexBuffer() & createMeshletBuffer().
+	void createCulledDraws();
+
+	//Uploads the model's meshlets for the cluster culler.
+	void createMeshletBuffer();
+
+	//Decodes the model's positions & indices for the software occlusion rasterizer. Call after the model is loaded.
+	void createOccluderMesh();
+
+	//Rasterizes the OCCLUDER_COUNT largest of visibleInstances on screen and removes the ones hidden behind them.
+	void cullOccludedInstances();
+
+	//Fills visibleInstanceLods with the level each of visibleInstances is drawn with, as Cull.comp picks them.
+	void selectInstanceLods();
+
+	//Fills clusterInstances & visibleInstanceSlots with the CPU-culled instances cluster culled this frame.
+	void assignClusterSlots();
+
+	bool isLodSelectionActive() const { return lodSelection && modelLods.size() > 1; }
+
+	bool isClusterCullingActive() const { return clusterCulling && clusterCuller.getSlotCount() > 0 && (isCpuCullingActive() || isGpuCullingActive()); }
+
+	bool isGpuCullingActive() const { return instancing && gpuCulling; }
+
+	bool isCpuCullingActive() const { return !instancing && cpuCulling; }
+
+	bool isSoftwareOcclusionActive() const { return isCpuCullingActive() && softwareOcclusion && !occluderIndices.empty(); }
+
+	bool isOcclusionCullingActive() const { return isGpuCullingActive() && occlusionCulling && depthPyramid.isSupported(); }
+
+	//"gpu-occlusion", "gpu", "cpu", "bvh" (CPU culled through instanceTree) or "none".
+	const char* getCullingMode() const;
+
+	//Per frame: indirect calls when culling on the GPU, otherwise one per batch (or per visible instance without instancing).
+	uint32_t getDrawCallCount() const;
 
 	void createDescriptorPool();
 
 	void createDescriptorSets();
 
+	//Loads the texture into texturePixels. Runs on the job system during startup.
+	void decodeTexture();
+
+	//Uploads and frees texturePixels.
 	void createTextureImage();
 
-	void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+	void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, GpuAllocation& imageAllocation);
 
 	VkCommandBuffer beginSingleTimeCommands(VkCommandPool commandPool);
 
 	void endSingleTimeCommands(VkCommandBuffer commandBuffer, VkCommandPool commandPool);
 
-	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
-
-	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-
 	void createTextureImageView();
 
 	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
@@ -243,6 +576,7 @@ private:
 
 	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
+	//Also (re)creates depthPyramid for the depth attachment.
 	void createDepthResources();
 
 	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
@@ -251,12 +585,31 @@ private:
 
 	bool hasStencilComponent(VkFormat format);
 
+	//Needs no device, so it runs on the job system during startup.
 	void loadModel();
 
-	void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+	//One vertex per index of the OBJ file, before welding.
+	void loadModelCorners(std::vector<Vertex>& corners);
+
+	//Encodes the welded vertices into PackedVertex and narrows the indices to 16 bits when they fit.
+	void packModel();
+
+	static MeshCacheLayout getVertexLayout();
+
+	void generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+
+	void createUploader();
+
+	void finishStartupUploads();
 
 	static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
 
+	static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+
+	//Casts a ray through the cursor position (in window coordinates) with the last frame's camera and prints the
+	//instance it hits first.
+	void pickInstance(double cursorX, double cursorY);
+
 	static VkResult CreateDebugUtilsMessengerEXT(VkInstance, const VkDebugUtilsMessengerCreateInfoEXT*, const VkAllocationCallbacks*, VkDebugUtilsMessengerEXT*);
 
 	static void DestroyDebugUtilsMessengerEXT(VkInstance, VkDebugUtilsMessengerEXT, const VkAllocationCallbacks*);
@@ -277,6 +630,8 @@ private:
 
 	void createLogicalDevice();
 
+	void createAllocator();
+
 	void createSurface();
 
 	void populateDebugMessangerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
@@ -287,6 +642,13 @@ private:
 
 	void mainLoop();
 
+	//Records timeToFirstFrameMs; call right after the first frame has been submitted.
+	void finishStartup();
+
+	void benchmarkLoop(uint32_t frameCount);
+
+	void printBenchmarkResults(uint32_t frameCount);
+
 	void cleanup();
 
 };
@@ -295,7 +657,7 @@ private:
 namespace std {
 	template<> struct hash<HelloTriangleApplication::Vertex> {
 		size_t operator()(HelloTriangleApplication::Vertex const& vertex) const {
-			return ((hash<glm::vec3>()(vertex.pos) ^ (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^ (hash<glm::vec2>()(vertex.texCoord) << 1);
+			return hash<glm::packed_vec3>()(vertex.pos) ^ (hash<glm::packed_vec2>()(vertex.texCoord) << 1);
 		}
 	};
 }
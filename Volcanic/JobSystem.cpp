@@ -0,0 +1,400 @@
+#include "JobSystem.h"
+#include "CpuTracer.h"
+
+#include <string>
+
+
+namespace {
+
+	thread_local const JobSystem* currentSystem = nullptr;
+	thread_local uint32_t currentWorker = 0;
+	thread_local uint32_t stealSeed = 0;
+
+
+	//Finished jobs are recycled per thread, so spawning doesn't go through the allocator once the lists are warm.
+	struct JobFreeList {
+
+		std::vector<Job*> jobs;
+
+		~JobFreeList() {
+
+			for (Job* job : jobs) {
+				delete job;
+			}
+		}
+	};
+
+	thread_local JobFreeList freeJobs;
+
+
+	uint32_t nextRandom() {
+
+		//xorshift32, only used to pick steal victims.
+		stealSeed ^= stealSeed << 13;
+		stealSeed ^= stealSeed >> 17;
+		stealSeed ^= stealSeed << 5;
+
+		return stealSeed;
+	}
+}
+
+
+bool JobSystem::WorkStealingDeque::push(Job* job){
+
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+
+	if (b - t >= CAPACITY) {
+		return false;
+	}
+
+	jobs[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+
+	//Publishes the job (and everything written to it) to thieves, which load bottom with acquire.
+	bottom.store(b + 1, std::memory_order_release);
+
+	return true;
+}
+
+
+Job* JobSystem::WorkStealingDeque::pop(){
+
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+
+	if (t > b) {
+
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+
+	Job* job = jobs[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+	//Last job: race the thieves for it.
+	if (t == b) {
+
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			job = nullptr;
+		}
+
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	return job;
+}
+
+
+Job* JobSystem::WorkStealingDeque::steal(){
+
+	int64_t t = top.load(std::memory_order_acquire);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+
+	if (t >= b) {
+		return nullptr;
+	}
+
+	Job* job = jobs[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return nullptr;
+	}
+
+	return job;
+}
+
+
+JobSystem::JobSystem(uint32_t threadCount){
+
+	this->threadCount = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+	ownerThread = std::this_thread::get_id();
+
+	for (uint32_t i = 0; i < this->threadCount; i++) {
+		deques.push_back(std::make_unique<WorkStealingDeque>());
+	}
+
+	for (uint32_t worker = 1; worker < this->threadCount; worker++) {
+		workers.emplace_back(&JobSystem::workerLoop, this, worker);
+	}
+}
+
+
+JobSystem::~JobSystem(){
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping.store(true);
+	}
+
+	wakeCondition.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+
+JobSystem& JobSystem::getDefault(){
+
+	static JobSystem defaultSystem;
+
+	return defaultSystem;
+}
+
+
+void JobSystem::spawn(std::function<void()> function, JobCounter* counter){
+
+	Job* job = allocateJob();
+	job->function = std::move(function);
+	job->counter = counter;
+
+	if (counter != nullptr) {
+		counter->pending.fetch_add(1);
+	}
+
+	push(job);
+}
+
+
+void JobSystem::spawnAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter){
+
+	Job* job = allocateJob();
+	job->function = std::move(function);
+	job->counter = counter;
+
+	if (counter != nullptr) {
+		counter->pending.fetch_add(1);
+	}
+
+
+	//finish() takes the same lock before handing out continuations, so the job is either queued here or there, never both.
+	{
+		std::lock_guard<std::mutex> lock(dependency.continuationMutex);
+
+		if (dependency.pending.load() != 0) {
+
+			dependency.continuations.push_back(job);
+			return;
+		}
+	}
+
+	push(job);
+}
+
+
+void JobSystem::wait(JobCounter& counter){
+
+	TRACE_ZONE("WaitForJobs");
+
+	uint32_t worker = getWorkerIndex();
+
+	while (!counter.isDone()) {
+
+		Job* job = findJob(worker);
+
+		if (job != nullptr) {
+			execute(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+
+uint32_t JobSystem::getWorkerIndex() const{
+
+	if (currentSystem == this) {
+		return currentWorker;
+	}
+
+	return std::this_thread::get_id() == ownerThread ? 0 : NO_WORKER;
+}
+
+
+void JobSystem::workerLoop(uint32_t worker){
+
+	currentSystem = this;
+	currentWorker = worker;
+	stealSeed = worker * 2654435761u + 1;
+
+	CpuTracer::setThreadName("Worker " + std::to_string(worker));
+
+
+	while (!stopping.load(std::memory_order_relaxed)) {
+
+		uint64_t epoch = pushEpoch.load();
+		Job* job = nullptr;
+
+		for (uint32_t spin = 0; spin < SPIN_COUNT && job == nullptr; spin++) {
+
+			job = findJob(worker);
+
+			if (job == nullptr) {
+				std::this_thread::yield();
+			}
+		}
+
+		if (job != nullptr) {
+
+			execute(job);
+			continue;
+		}
+
+
+		//Nothing was pushed since the epoch was read, so sleep until something is. push() bumps the epoch before it
+		//checks for sleepers, so either it sees this worker sleeping or the predicate sees the new epoch.
+		std::unique_lock<std::mutex> lock(sleepMutex);
+
+		sleepingCount.fetch_add(1);
+		wakeCondition.wait(lock, [this, epoch]() { return stopping.load() || pushEpoch.load() != epoch; });
+		sleepingCount.fetch_sub(1);
+	}
+}
+
+
+void JobSystem::push(Job* job){
+
+	uint32_t worker = getWorkerIndex();
+
+	if (worker != NO_WORKER) {
+
+		//A full deque means the producer is far ahead of everyone else; running the job right away bounds memory.
+		if (!deques[worker]->push(job)) {
+
+			execute(job);
+			return;
+		}
+	}
+	else {
+
+		std::lock_guard<std::mutex> lock(injectionMutex);
+
+		injectedJobs.push_back(job);
+		injectedCount.fetch_add(1);
+	}
+
+
+	pushEpoch.fetch_add(1);
+
+	if (sleepingCount.load() > 0) {
+
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wakeCondition.notify_one();
+	}
+}
+
+
+Job* JobSystem::findJob(uint32_t worker){
+
+	if (worker != NO_WORKER) {
+
+		Job* job = deques[worker]->pop();
+
+		if (job != nullptr) {
+			return job;
+		}
+	}
+
+
+	if (injectedCount.load(std::memory_order_relaxed) > 0) {
+
+		std::lock_guard<std::mutex> lock(injectionMutex);
+
+		if (!injectedJobs.empty()) {
+
+			Job* job = injectedJobs.front();
+			injectedJobs.pop_front();
+			injectedCount.fetch_sub(1);
+			stealCount.fetch_add(1, std::memory_order_relaxed);
+
+			return job;
+		}
+	}
+
+
+	//Start at a random victim so thieves spread out instead of all hammering worker 0.
+	uint32_t start = nextRandom() % threadCount;
+
+	for (uint32_t i = 0; i < threadCount; i++) {
+
+		uint32_t victim = (start + i) % threadCount;
+
+		if (victim == worker) {
+			continue;
+		}
+
+		Job* job = deques[victim]->steal();
+
+		if (job != nullptr) {
+
+			stealCount.fetch_add(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+
+void JobSystem::execute(Job* job){
+
+	job->function();
+
+	JobCounter* counter = job->counter;
+	freeJob(job);
+
+	if (counter != nullptr) {
+		finish(counter);
+	}
+}
+
+
+void JobSystem::finish(JobCounter* counter){
+
+	counter->finishing.fetch_add(1);
+
+	std::vector<Job*> ready;
+
+	if (counter->pending.fetch_sub(1) == 1) {
+
+		std::lock_guard<std::mutex> lock(counter->continuationMutex);
+		ready.swap(counter->continuations);
+	}
+
+	counter->finishing.fetch_sub(1);
+
+
+	//The counter may be gone once finishing is back to zero (a continuation can even have completed its own waiter by
+	//then), so the ready jobs are only queued afterwards.
+	for (Job* job : ready) {
+		push(job);
+	}
+}
+
+
+Job* JobSystem::allocateJob(){
+
+	if (freeJobs.jobs.empty()) {
+		return new Job();
+	}
+
+	Job* job = freeJobs.jobs.back();
+	freeJobs.jobs.pop_back();
+
+	return job;
+}
+
+
+void JobSystem::freeJob(Job* job){
+
+	job->function = nullptr;
+	job->counter = nullptr;
+
+	freeJobs.jobs.push_back(job);
+}
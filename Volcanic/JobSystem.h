@@ -0,0 +1,198 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+
+
+class JobSystem;
+struct Job;
+
+
+//Counts unfinished jobs. Jobs spawned with a counter increment it and decrement it when they finish; wait() on it, or
+//spawnAfter() jobs that must only start once it reaches zero. Must outlive every job that references it.
+class JobCounter {
+
+public:
+	JobCounter() = default;
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool isDone() const {
+
+		//finishing guards the continuation hand-off in JobSystem::finish(), so the counter can be destroyed once this is true.
+		return pending.load() == 0 && finishing.load() == 0;
+	}
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> pending{ 0 };
+	std::atomic<uint32_t> finishing{ 0 };
+	std::mutex continuationMutex;
+	std::vector<Job*> continuations;
+};
+
+
+struct Job {
+
+	std::function<void()> function;
+	JobCounter* counter = nullptr;
+};
+
+
+//Work-stealing scheduler: one worker per hardware thread, each with a lock-free Chase-Lev deque (Lê et al., "Correct and
+//Efficient Work-Stealing for Weak Memory Models", 2013). Workers push and pop at the bottom of their own deque and steal
+//from the top of others', so fine-grained jobs rarely contend. The thread that created the system is worker 0 and runs
+//jobs while it waits; other threads hand their jobs over through a locked injection queue.
+//Idle workers spin briefly, then sleep until new work is pushed.
+class JobSystem {
+
+public:
+	//parallelFor() splits its range into up to this many jobs per thread, so uneven chunks still balance.
+	static constexpr uint32_t JOBS_PER_THREAD = 4;
+
+	//threadCount 0 uses every hardware thread (including the calling one).
+	explicit JobSystem(uint32_t threadCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	//Shared by every subsystem, created on first use with one worker per hardware thread.
+	static JobSystem& getDefault();
+
+	//Queues a job. It must not throw: nothing would catch it on a worker (parallelFor() catches for its own jobs).
+	void spawn(std::function<void()> function, JobCounter* counter = nullptr);
+
+	//Queues the job once dependency has reached zero (immediately if it already has).
+	void spawnAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter = nullptr);
+
+	//Runs other jobs until the counter reaches zero.
+	void wait(JobCounter& counter);
+
+	//Calls function(begin, end) on disjoint subranges of [0, count), each at least minCountPerJob long (except the last),
+	//and returns when all of them have finished. The first exception thrown is rethrown here.
+	template<typename Function>
+	void parallelFor(uint32_t count, uint32_t minCountPerJob, Function function) {
+
+		if (count == 0) {
+			return;
+		}
+
+		uint32_t jobCount = std::clamp(count / std::max(minCountPerJob, 1u), 1u, threadCount * JOBS_PER_THREAD);
+
+		if (jobCount == 1) {
+
+			function(0u, count);
+			return;
+		}
+
+
+		JobCounter counter;
+		std::exception_ptr error;
+		std::mutex errorMutex;
+
+		auto runJob = [&](uint32_t job) {
+
+			uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * job / jobCount);
+			uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (job + 1) / jobCount);
+
+			try {
+				function(begin, end);
+			}
+			catch (...) {
+
+				std::lock_guard<std::mutex> lock(errorMutex);
+
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+		};
+
+		for (uint32_t job = 1; job < jobCount; job++) {
+			spawn([&runJob, job]() { runJob(job); }, &counter);
+		}
+
+		runJob(0);
+		wait(counter);
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	uint32_t getThreadCount() const { return threadCount; }
+
+	//Jobs executed by another worker than the one that queued them (including injected ones).
+	uint64_t getStealCount() const { return stealCount.load(std::memory_order_relaxed); }
+
+private:
+	//Single-owner deque of fixed capacity. push() and pop() only from the owning worker, steal() from any thread.
+	class WorkStealingDeque {
+
+	public:
+		static constexpr int64_t CAPACITY = 4096;
+
+		bool push(Job* job);
+
+		Job* pop();
+
+		Job* steal();
+
+	private:
+		std::atomic<int64_t> top{ 0 };
+		std::atomic<int64_t> bottom{ 0 };
+		std::atomic<Job*> jobs[CAPACITY];
+	};
+
+	//Idle workers check for work this many times before going to sleep.
+	static constexpr uint32_t SPIN_COUNT = 64;
+
+	//The calling thread's worker index in this system, or NO_WORKER for threads that don't belong to it.
+	uint32_t getWorkerIndex() const;
+
+	static constexpr uint32_t NO_WORKER = ~0u;
+
+	void workerLoop(uint32_t worker);
+
+	//Queues a ready job on the calling worker's deque (or the injection queue) and wakes a sleeping worker.
+	void push(Job* job);
+
+	Job* findJob(uint32_t worker);
+
+	void execute(Job* job);
+
+	//Decrements the counter and queues its continuations once it reaches zero.
+	void finish(JobCounter* counter);
+
+	static Job* allocateJob();
+
+	static void freeJob(Job* job);
+
+	uint32_t threadCount = 1;
+	std::thread::id ownerThread;
+	std::vector<std::unique_ptr<WorkStealingDeque>> deques;
+	std::vector<std::thread> workers;
+
+	std::mutex injectionMutex;
+	std::deque<Job*> injectedJobs;
+	std::atomic<size_t> injectedCount{ 0 };
+
+	std::mutex sleepMutex;
+	std::condition_variable wakeCondition;
+	std::atomic<uint64_t> pushEpoch{ 0 };
+	std::atomic<uint32_t> sleepingCount{ 0 };
+	std::atomic<bool> stopping{ false };
+
+	std::atomic<uint64_t> stealCount{ 0 };
+};
@@ -6,16 +6,283 @@
 #include <functional>
 #include <cstdlib>
 #include <vector>
+#include <string>
 
 #include "HelloTriangleApplication.h"
+#include "CpuTracer.h"
 
 
-int main() {
+namespace {
+
+	//Lists the command line options on stderr.
+	void printUsage(const char* program) {
+
+		std::cerr << "Usage: " << program << " [options]\n"
+			"  --benchmark [frameCount] renders headless and prints frame-time percentiles as JSON.\n"
+			"  --weld-benchmark [iterations] times vertex welding of the model (no Vulkan device needed) and prints JSON.\n"
+			"  --job-benchmark [iterations] times job spawn, steal & parallelFor scaling (no Vulkan device needed) and prints JSON.\n"
+			"  --cull-benchmark [iterations] frustum culls up to 1M objects with every supported ISA and an AABB tree, and casts\n"
+			"    rays through the tree (no Vulkan device needed), and prints objects/ns as JSON.\n"
+			"  --resize-benchmark [iterations] resizes the window back and forth and prints swap chain recreation times as JSON.\n"
+			"  --full-swapchain-recreate also rebuilds the render pass, pipeline & command buffers on resize (to compare).\n"
+			"  --objects <count> draws count instances of the model.\n"
+			"  --no-instancing draws every instance with its own draw call instead of one instanced call per mesh (to compare).\n"
+			"  --no-gpu-culling draws every instance instead of frustum culling them in a compute pass and drawing indirectly (to compare).\n"
+			"  --no-occlusion-culling only frustum culls on the GPU, without testing against the previous frame's depth pyramid.\n"
+			"  --no-cpu-culling draws every instance without instancing, instead of only those inside the frustum (to compare).\n"
+			"  --bvh-culling culls on the CPU through the instances' AABB tree instead of testing each of them with SIMD.\n"
+			"  --no-software-occlusion only frustum culls on the CPU, without rasterizing the nearest instances as occluders.\n"
+			"  --no-lod draws culled instances with the full mesh instead of the coarsest level of detail within a pixel of error.\n"
+			"  --no-cluster-culling draws full-detail instances whole instead of only their meshlets in view and facing the camera.\n"
+			"  --occlusion-benchmark [iterations] rasterizes box occluders in software at up to 1920x1080 with every supported ISA\n"
+			"    and tests 100k boxes against them (no Vulkan device needed), and prints pixels/ns and boxes/ns as JSON.\n"
+			"  --instance-benchmark [frameCount] renders headless at 1 to 100k instances, GPU culled (with and without occlusion\n"
+			"    culling), instanced and one draw per instance (with and without software occlusion), the two occlusion culled ones\n"
+			"    also cluster culled, and prints JSON.\n"
+			"  --record-threads <count> records the draws in at most count jobs (0, the default, uses one per job system thread).\n"
+			"  --model <path> loads another OBJ file instead of the default model.\n"
+			"  --no-mesh-cache always parses the OBJ file instead of loading (and writing) <model>.meshcache.\n"
+			"  --no-mesh-optimization keeps the OBJ's triangle & vertex order (and skips the mesh cache).\n"
+			"  --obj-parser <tinyobj|tinyobj-opt> [threads] selects the OBJ parser; tinyobj-opt parses on several threads.\n"
+			"  --parse-benchmark [iterations] times both OBJ parsers on the model and prints MB/s and triangles/s as JSON.\n"
+			"  --gpu-profile-csv <path> writes per-scope GPU timings of every frame to a CSV file.\n"
+			"  --no-pipeline-cache compiles every pipeline from scratch instead of loading (and saving) pipeline.cache.\n"
+			"  --serial-startup decodes the texture, loads the model and reads the shaders one after another on the main thread\n"
+			"    instead of overlapping them with device setup (to compare time to first frame).\n"
+			"  --immediate-uploads submits every startup upload separately instead of batching them (to compare startup times).\n"
+			"  --trace <path> records CPU zones and writes them as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) on exit.\n";
+	}
+}
+
+
+int main(int argc, char* argv[]) {
 
 	HelloTriangleApplication app;
 
+	bool benchmark = false;
+	uint32_t benchmarkFrames = 1000;
+	bool weldBenchmark = false;
+	uint32_t weldIterations = 10;
+	bool jobBenchmark = false;
+	uint32_t jobIterations = 10;
+	bool cullBenchmark = false;
+	uint32_t cullIterations = 20;
+	bool occlusionBenchmark = false;
+	uint32_t occlusionIterations = 20;
+	bool instanceBenchmark = false;
+	uint32_t instanceFrames = 100;
+	bool resizeBenchmark = false;
+	uint32_t resizeIterations = 20;
+	bool parseBenchmark = false;
+	uint32_t parseIterations = 5;
+	std::string tracePath;
+
+	for (int i = 1; i < argc; i++) {
+
+		std::string arg = argv[i];
+
+		if (arg == "--benchmark") {
+
+			benchmark = true;
+
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				benchmarkFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--weld-benchmark") {
+
+			weldBenchmark = true;
+
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				weldIterations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--job-benchmark") {
+
+			jobBenchmark = true;
+
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				jobIterations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--resize-benchmark") {
+
+			resizeBenchmark = true;
+
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				resizeIterations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--full-swapchain-recreate") {
+
+			app.setIncrementalSwapChainRecreation(false);
+		}
+		else if (arg == "--objects" && i + 1 < argc) {
+
+			app.setSceneObjectCount(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+		}
+		else if (arg == "--no-instancing") {
+
+			app.setInstancingEnabled(false);
+		}
+		else if (arg == "--no-gpu-culling") {
+
+			app.setGpuCullingEnabled(false);
+		}
+		else if (arg == "--no-occlusion-culling") {
+
+			app.setOcclusionCullingEnabled(false);
+		}
+		else if (arg == "--no-cpu-culling") {
+
+			app.setCpuCullingEnabled(false);
+		}
+		else if (arg == "--bvh-culling") {
+
+			app.setBvhCullingEnabled(true);
+		}
+		else if (arg == "--no-software-occlusion") {
+
+			app.setSoftwareOcclusionEnabled(false);
+		}
+		else if (arg == "--no-lod") {
+
+			app.setLodSelectionEnabled(false);
+		}
+		else if (arg == "--no-cluster-culling") {
+
+			app.setClusterCullingEnabled(false);
+		}
+		else if (arg == "--occlusion-benchmark") {
+
+			occlusionBenchmark = true;
+
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				occlusionIterations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--cull-benchmark") {
+
+			cullBenchmark = true;
+
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				cullIterations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--instance-benchmark") {
+
+			instanceBenchmark = true;
+
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				instanceFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--record-threads" && i + 1 < argc) {
+
+			app.setRecordThreadCount(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+		}
+		else if (arg == "--model" && i + 1 < argc) {
+
+			app.setModelPath(argv[++i]);
+		}
+		else if (arg == "--no-mesh-cache") {
+
+			app.setMeshCacheEnabled(false);
+		}
+		else if (arg == "--no-mesh-optimization") {
+
+			app.setMeshOptimizationEnabled(false);
+		}
+		else if (arg == "--obj-parser" && i + 1 < argc) {
+
+			ObjLoader::Backend backend;
+
+			if (!ObjLoader::findBackend(argv[++i], backend)) {
+
+				std::cerr << "Unknown OBJ parser! Name: " << argv[i] << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			uint32_t threads = 0;
+
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				threads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+
+			app.setObjParser(backend, threads);
+		}
+		else if (arg == "--parse-benchmark") {
+
+			parseBenchmark = true;
+
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				parseIterations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--gpu-profile-csv" && i + 1 < argc) {
+
+			app.setGpuProfilerCsvPath(argv[++i]);
+		}
+		else if (arg == "--no-pipeline-cache") {
+
+			app.setPipelineCacheEnabled(false);
+		}
+		else if (arg == "--serial-startup") {
+
+			app.setParallelStartup(false);
+		}
+		else if (arg == "--immediate-uploads") {
+
+			app.setBatchedUploads(false);
+		}
+		else if (arg == "--trace" && i + 1 < argc) {
+
+			tracePath = argv[++i];
+		}
+		else {
+
+			std::cerr << "Unknown option or missing value! Argument: " << arg << std::endl;
+			printUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+
+	if (!tracePath.empty()) {
+
+		CpuTracer::setThreadName("Main");
+		CpuTracer::setEnabled(true);
+	}
+
+
 	try {
-		app.run();
+		if (parseBenchmark) {
+			app.runParseBenchmark(parseIterations);
+		}
+		else if (weldBenchmark) {
+			app.runWeldBenchmark(weldIterations);
+		}
+		else if (jobBenchmark) {
+			app.runJobBenchmark(jobIterations);
+		}
+		else if (cullBenchmark) {
+			app.runCullBenchmark(cullIterations);
+		}
+		else if (occlusionBenchmark) {
+			app.runOcclusionBenchmark(occlusionIterations);
+		}
+		else if (instanceBenchmark) {
+			app.runInstanceBenchmark(instanceFrames);
+		}
+		else if (resizeBenchmark) {
+			app.runResizeBenchmark(resizeIterations);
+		}
+		else if (benchmark) {
+			app.runBenchmark(benchmarkFrames);
+		}
+		else {
+			app.run();
+		}
 	}
 	catch (const std::exception& e) {
 
@@ -23,5 +290,12 @@ int main() {
 		return EXIT_FAILURE;
 	}
 
+
+	if (!tracePath.empty() && !CpuTracer::exportChromeTrace(tracePath)) {
+
+		std::cerr << "Failed to write trace file! Filename: " << tracePath << std::endl;
+		return EXIT_FAILURE;
+	}
+
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,156 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path){
+
+	close();
+
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file, &fileSize)) {
+
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+	if (size == 0) {
+		return true;
+	}
+
+
+	mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (mappingHandle == nullptr) {
+
+		close();
+		return false;
+	}
+
+	data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+	if (data == nullptr) {
+
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+
+void MappedFile::close(){
+
+	if (data != nullptr) {
+		UnmapViewOfFile(data);
+	}
+
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+	}
+
+	if (fileHandle != nullptr) {
+		CloseHandle(fileHandle);
+	}
+
+	data = nullptr;
+	size = 0;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+}
+
+
+bool replaceFile(const std::string& from, const std::string& to){
+
+	//std::rename fails on Windows if to exists, and removing it first leaves a window without the file.
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path){
+
+	close();
+
+
+	int file = ::open(path.c_str(), O_RDONLY);
+
+	if (file < 0) {
+		return false;
+	}
+
+
+	struct stat fileInfo;
+
+	if (fstat(file, &fileInfo) != 0) {
+
+		::close(file);
+		return false;
+	}
+
+	size = static_cast<size_t>(fileInfo.st_size);
+
+
+	//The mapping stays valid after the descriptor is closed.
+	if (size > 0) {
+
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (mapping == MAP_FAILED) {
+
+			::close(file);
+			size = 0;
+			return false;
+		}
+
+		madvise(mapping, size, MADV_SEQUENTIAL);
+		data = static_cast<const char*>(mapping);
+	}
+
+	::close(file);
+
+	return true;
+}
+
+
+void MappedFile::close(){
+
+	if (data != nullptr) {
+		munmap(const_cast<char*>(data), size);
+	}
+
+	data = nullptr;
+	size = 0;
+}
+
+
+bool replaceFile(const std::string& from, const std::string& to){
+
+	return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+#endif
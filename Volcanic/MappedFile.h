@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+
+//Read-only memory mapping of a whole file. The pages are faulted in on first access, so parsers can read the file
+//without copying it into a heap buffer first.
+class MappedFile {
+
+public:
+	MappedFile() = default;
+	~MappedFile() { close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	//Returns false if the file can't be opened or mapped. Empty files map to a null pointer with size 0.
+	bool open(const std::string& path);
+
+	void close();
+
+	const char* getData() const { return data; }
+
+	size_t getSize() const { return size; }
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
+
+//Moves the file at from to to, replacing an existing file in a single step, so readers never find to missing or half
+//written. Returns false if the move fails.
+bool replaceFile(const std::string& from, const std::string& to);
@@ -0,0 +1,208 @@
+#include "MeshCache.h"
+#include "Hash.h"
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+
+namespace {
+
+	const char MAGIC[4] = { 'V', 'M', 'S', 'H' };
+
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment) {
+
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+
+bool MeshCache::hashSourceFile(const std::string& path, uint64_t& hash){
+
+	MappedFile source;
+
+	if (!source.open(path)) {
+		return false;
+	}
+
+	hash = Hash::xxHash64(source.getData(), source.getSize());
+
+	return true;
+}
+
+
+bool MeshCache::write(const std::string& path, uint64_t sourceHash, const MeshCacheLayout& layout, const VertexQuantization& quantization,
+	const void* vertexData, uint64_t vertexCount, const void* indexData, uint32_t indexSize, uint64_t indexCount, const std::vector<MeshLod>& lods,
+	const std::vector<Meshlet>& meshlets){
+
+	Header header{};
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.sourceHash = sourceHash;
+	header.vertexStride = layout.vertexStride;
+	header.attributeCount = static_cast<uint32_t>(layout.attributes.size());
+	header.vertexCount = vertexCount;
+	header.vertexOffset = alignUp(sizeof(Header) + sizeof(MeshCacheAttribute) * layout.attributes.size(), BLOB_ALIGNMENT);
+	header.indexCount = indexCount;
+	header.indexOffset = alignUp(header.vertexOffset + vertexCount * layout.vertexStride, BLOB_ALIGNMENT);
+	header.indexSize = indexSize;
+	header.quantization = quantization;
+	header.lodCount = static_cast<uint32_t>(lods.size());
+	header.lodOffset = alignUp(header.indexOffset + indexCount * indexSize, BLOB_ALIGNMENT);
+	header.meshletCount = static_cast<uint32_t>(meshlets.size());
+	header.meshletOffset = alignUp(header.lodOffset + sizeof(MeshLod) * lods.size(), BLOB_ALIGNMENT);
+
+
+	std::string tempPath = path + ".tmp";
+	std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+
+	if (!out.is_open()) {
+		return false;
+	}
+
+
+	const char padding[BLOB_ALIGNMENT] = {};
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	out.write(reinterpret_cast<const char*>(layout.attributes.data()), sizeof(MeshCacheAttribute) * layout.attributes.size());
+	out.write(padding, header.vertexOffset - (sizeof(Header) + sizeof(MeshCacheAttribute) * layout.attributes.size()));
+
+	out.write(static_cast<const char*>(vertexData), vertexCount * layout.vertexStride);
+	out.write(padding, header.indexOffset - (header.vertexOffset + vertexCount * layout.vertexStride));
+
+	out.write(static_cast<const char*>(indexData), indexCount * indexSize);
+	out.write(padding, header.lodOffset - (header.indexOffset + indexCount * indexSize));
+
+	out.write(reinterpret_cast<const char*>(lods.data()), sizeof(MeshLod) * lods.size());
+	out.write(padding, header.meshletOffset - (header.lodOffset + sizeof(MeshLod) * lods.size()));
+
+	out.write(reinterpret_cast<const char*>(meshlets.data()), sizeof(Meshlet) * meshlets.size());
+
+	out.close();
+
+
+	if (out.fail()) {
+
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	return replaceFile(tempPath, path);
+}
+
+
+bool MeshCache::open(const std::string& path, uint64_t sourceHash, const MeshCacheLayout& layout){
+
+	close();
+
+	if (!file.open(path) || file.getSize() < sizeof(Header)) {
+
+		close();
+		return false;
+	}
+
+
+	const char* data = file.getData();
+	Header header;
+	memcpy(&header, data, sizeof(Header));
+
+	bool valid = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION && header.sourceHash == sourceHash;
+
+
+	//The cached vertices are only usable if they were written with the exact layout the pipeline expects.
+	valid = valid && layout.vertexStride > 0 && header.vertexStride == layout.vertexStride && header.attributeCount == layout.attributes.size();
+	valid = valid && file.getSize() >= sizeof(Header) + sizeof(MeshCacheAttribute) * layout.attributes.size();
+	valid = valid && memcmp(data + sizeof(Header), layout.attributes.data(), sizeof(MeshCacheAttribute) * layout.attributes.size()) == 0;
+
+
+	//Bounds checks (in this order, so none of the sums can overflow) guard against truncated files.
+	valid = valid && header.vertexOffset <= file.getSize() && header.vertexCount <= (file.getSize() - header.vertexOffset) / layout.vertexStride;
+	valid = valid && (header.indexSize == sizeof(uint16_t) || header.indexSize == sizeof(uint32_t));
+	valid = valid && header.indexOffset <= file.getSize() && header.indexCount <= (file.getSize() - header.indexOffset) / header.indexSize;
+	valid = valid && header.lodOffset <= file.getSize() && header.lodCount <= (file.getSize() - header.lodOffset) / sizeof(MeshLod);
+	valid = valid && header.meshletOffset <= file.getSize() && header.meshletCount <= (file.getSize() - header.meshletOffset) / sizeof(Meshlet);
+	valid = valid && header.vertexOffset % BLOB_ALIGNMENT == 0 && header.indexOffset % BLOB_ALIGNMENT == 0 && header.lodOffset % BLOB_ALIGNMENT == 0
+		&& header.meshletOffset % BLOB_ALIGNMENT == 0;
+
+	if (!valid) {
+
+		close();
+		return false;
+	}
+
+
+	vertexData = data + header.vertexOffset;
+	vertexCount = header.vertexCount;
+	indexData = data + header.indexOffset;
+	indexSize = header.indexSize;
+	indexCount = header.indexCount;
+	quantization = header.quantization;
+	lods.resize(header.lodCount);
+	memcpy(lods.data(), data + header.lodOffset, sizeof(MeshLod) * header.lodCount);
+	meshlets.resize(header.meshletCount);
+	memcpy(meshlets.data(), data + header.meshletOffset, sizeof(Meshlet) * header.meshletCount);
+
+
+	//Every level has to lie within the index blob, and there's always at least the full mesh.
+	valid = !lods.empty();
+
+	for (const MeshLod& lod : lods) {
+		valid = valid && lod.firstIndex <= indexCount && lod.indexCount <= indexCount - lod.firstIndex && lod.indexCount % 3 == 0;
+	}
+
+	for (const Meshlet& meshlet : meshlets) {
+		valid = valid && meshlet.firstIndex <= indexCount && meshlet.indexCount <= indexCount - meshlet.firstIndex && meshlet.indexCount % 3 == 0;
+	}
+
+	if (!valid) {
+
+		close();
+		return false;
+	}
+
+
+	//A single out-of-range index would make the GPU read past the vertex buffer.
+	uint32_t maxIndex = 0;
+
+	if (indexSize == sizeof(uint16_t)) {
+
+		const uint16_t* indices = static_cast<const uint16_t*>(indexData);
+
+		for (uint64_t i = 0; i < indexCount; i++) {
+			maxIndex = std::max<uint32_t>(maxIndex, indices[i]);
+		}
+	}
+	else {
+
+		const uint32_t* indices = static_cast<const uint32_t*>(indexData);
+
+		for (uint64_t i = 0; i < indexCount; i++) {
+			maxIndex = std::max(maxIndex, indices[i]);
+		}
+	}
+
+	if (indexCount > 0 && maxIndex >= vertexCount) {
+
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+
+void MeshCache::close(){
+
+	file.close();
+
+	vertexData = nullptr;
+	vertexCount = 0;
+	indexData = nullptr;
+	indexSize = 0;
+	indexCount = 0;
+	quantization = VertexQuantization();
+	lods.clear();
+	meshlets.clear();
+}
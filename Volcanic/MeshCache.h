@@ -0,0 +1,102 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "MappedFile.h"
+#include "VertexLayout.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+
+
+//One vertex attribute of the cached layout, laid out like VkVertexInputAttributeDescription.
+struct MeshCacheAttribute {
+
+	uint32_t location;
+	uint32_t format;
+	uint32_t offset;
+};
+
+
+struct MeshCacheLayout {
+
+	uint32_t vertexStride = 0;
+	std::vector<MeshCacheAttribute> attributes;
+};
+
+
+//Welded model geometry in a binary file next to its source: a header, the vertex layout it was written with, then the
+//vertex and index blobs, then the levels of detail and the full mesh's meshlets (both ranges of the index blob). A cache is only used when its version, vertex layout and the XXH64 of the source file all match,
+//so changing the model or the Vertex struct rebuilds it on the next launch.
+//The file is memory-mapped and the blobs are read in place, so uploading them is a single copy into staging memory.
+class MeshCache {
+
+public:
+	//Bumped whenever the file layout or the meaning of its contents changes.
+	static const uint32_t VERSION = 5;
+
+	//Returns false if the source file can't be read.
+	static bool hashSourceFile(const std::string& path, uint64_t& hash);
+
+	//Writes to a temporary file first and renames it, so a crash never leaves a truncated cache behind.
+	//indexSize is 2 or 4 bytes. lods & meshlets index into indexData.
+	static bool write(const std::string& path, uint64_t sourceHash, const MeshCacheLayout& layout, const VertexQuantization& quantization,
+		const void* vertexData, uint64_t vertexCount, const void* indexData, uint32_t indexSize, uint64_t indexCount, const std::vector<MeshLod>& lods,
+		const std::vector<Meshlet>& meshlets);
+
+	//Maps the cache and validates it. Returns false (and stays closed) if the file is missing, stale or malformed.
+	bool open(const std::string& path, uint64_t sourceHash, const MeshCacheLayout& layout);
+
+	void close();
+
+	bool isOpen() const { return file.getData() != nullptr; }
+
+	const void* getVertexData() const { return vertexData; }
+
+	uint64_t getVertexCount() const { return vertexCount; }
+
+	const void* getIndexData() const { return indexData; }
+
+	uint32_t getIndexSize() const { return indexSize; }
+
+	uint64_t getIndexCount() const { return indexCount; }
+
+	const VertexQuantization& getQuantization() const { return quantization; }
+
+	const std::vector<MeshLod>& getLods() const { return lods; }
+
+	const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+
+private:
+	//Blobs start at multiples of this, so they can be read (and copied) with aligned loads straight from the mapping.
+	static const uint64_t BLOB_ALIGNMENT = 16;
+
+	struct Header {
+
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+		uint32_t vertexStride;
+		uint32_t attributeCount;
+		uint64_t vertexCount;
+		uint64_t vertexOffset;
+		uint64_t indexCount;
+		uint64_t indexOffset;
+		uint32_t indexSize;
+		VertexQuantization quantization;
+		uint32_t lodCount;
+		uint64_t lodOffset;
+		uint32_t meshletCount;
+		uint64_t meshletOffset;
+	};
+
+	MappedFile file;
+	const void* vertexData = nullptr;
+	uint64_t vertexCount = 0;
+	const void* indexData = nullptr;
+	uint32_t indexSize = 0;
+	uint64_t indexCount = 0;
+	VertexQuantization quantization;
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
+};
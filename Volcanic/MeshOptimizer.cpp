@@ -0,0 +1,398 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+
+namespace {
+
+	struct Float3 {
+
+		float x, y, z;
+	};
+
+
+	Float3 loadPosition(const char* positions, size_t positionStride, uint32_t vertex) {
+
+		Float3 position;
+		memcpy(&position, positions + vertex * positionStride, sizeof(Float3));
+
+		return position;
+	}
+
+
+	//FIFO cache over per-vertex timestamps: a vertex is cached while fewer than cacheSize vertices were inserted after it.
+	class FifoCache {
+
+	public:
+		FifoCache(size_t vertexCount, uint32_t cacheSize) : insertTimes(vertexCount, 0), cacheSize(cacheSize), time(cacheSize + 1) {}
+
+		//Returns true (and inserts the vertex) on a miss.
+		bool access(uint32_t vertex) {
+
+			if (time - insertTimes[vertex] > cacheSize) {
+
+				insertTimes[vertex] = time++;
+				return true;
+			}
+
+			return false;
+		}
+
+		uint32_t accessTriangle(const uint32_t* triangle) {
+
+			return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+		}
+
+		void flush() { time += cacheSize + 1; }
+
+		//How many vertices were inserted since this one; more than cacheSize means it has been evicted.
+		uint32_t age(uint32_t vertex) const { return time - insertTimes[vertex]; }
+
+	private:
+		std::vector<uint32_t> insertTimes;
+		uint32_t cacheSize;
+		uint32_t time;
+	};
+}
+
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize){
+
+	VertexCacheStats stats;
+
+	if (indices.empty()) {
+		return stats;
+	}
+
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<char> referenced(vertexCount, 0);
+	size_t misses = 0;
+	size_t referencedCount = 0;
+
+	for (uint32_t vertex : indices) {
+
+		misses += cache.access(vertex);
+
+		referencedCount += referenced[vertex] == 0;
+		referenced[vertex] = 1;
+	}
+
+
+	stats.acmr = static_cast<double>(misses) / static_cast<double>(indices.size() / 3);
+	stats.atvr = static_cast<double>(misses) / static_cast<double>(referencedCount);
+
+	return stats;
+}
+
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize){
+
+	size_t triangleCount = indices.size() / 3;
+
+	if (triangleCount == 0) {
+		return;
+	}
+
+
+	//Vertex -> triangle adjacency in CSR form, plus the number of not yet emitted triangles of every vertex.
+	std::vector<uint32_t> liveCounts(vertexCount, 0);
+
+	for (uint32_t vertex : indices) {
+		liveCounts[vertex]++;
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+
+	for (size_t v = 0; v < vertexCount; v++) {
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveCounts[v];
+	}
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+	for (size_t i = 0; i < indices.size(); i++) {
+		adjacency[fillOffsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<char> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEndStack;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+
+	deadEndStack.reserve(indices.size());
+	output.reserve(indices.size());
+
+	const uint32_t NO_VERTEX = ~0u;
+	uint32_t fanningVertex = indices[0];
+	size_t inputCursor = 0;
+
+
+	while (fanningVertex != NO_VERTEX) {
+
+		//Emit every remaining triangle around the fanning vertex.
+		candidates.clear();
+
+		for (uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; a++) {
+
+			uint32_t triangle = adjacency[a];
+
+			if (emitted[triangle]) {
+				continue;
+			}
+
+			for (uint32_t corner = 0; corner < 3; corner++) {
+
+				uint32_t vertex = indices[triangle * 3 + corner];
+
+				output.push_back(vertex);
+				deadEndStack.push_back(vertex);
+				candidates.push_back(vertex);
+
+				liveCounts[vertex]--;
+				cache.access(vertex);
+			}
+
+			emitted[triangle] = 1;
+		}
+
+
+		//Next fanning vertex: the oldest candidate that will still be cached after emitting all its triangles
+		//(each adds at most two new vertices), otherwise any candidate with triangles left.
+		uint32_t next = NO_VERTEX;
+		int64_t bestPriority = -1;
+
+		for (uint32_t vertex : candidates) {
+
+			if (liveCounts[vertex] == 0) {
+				continue;
+			}
+
+			int64_t priority = 0;
+
+			if (static_cast<int64_t>(cache.age(vertex)) + 2 * static_cast<int64_t>(liveCounts[vertex]) <= static_cast<int64_t>(cacheSize)) {
+				priority = cache.age(vertex);
+			}
+
+			if (priority > bestPriority) {
+
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+
+
+		//Dead end: back up to the most recently used vertex with triangles left, then fall back to input order.
+		while (next == NO_VERTEX && !deadEndStack.empty()) {
+
+			uint32_t vertex = deadEndStack.back();
+			deadEndStack.pop_back();
+
+			if (liveCounts[vertex] > 0) {
+				next = vertex;
+			}
+		}
+
+		while (next == NO_VERTEX && inputCursor < indices.size()) {
+
+			uint32_t vertex = indices[inputCursor++];
+
+			if (liveCounts[vertex] > 0) {
+				next = vertex;
+			}
+		}
+
+		fanningVertex = next;
+	}
+
+
+	indices = std::move(output);
+}
+
+
+std::vector<uint32_t> MeshOptimizer::findClusters(const std::vector<uint32_t>& indices, size_t vertexCount, float threshold, uint32_t cacheSize){
+
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	FifoCache cache(vertexCount, cacheSize);
+
+
+	//Hard boundaries: triangles that miss on all three vertices start over anyway, so splitting there costs nothing.
+	std::vector<uint32_t> hardBoundaries;
+
+	for (uint32_t t = 0; t < triangleCount; t++) {
+
+		if (cache.accessTriangle(&indices[t * 3]) == 3 || t == 0) {
+			hardBoundaries.push_back(t);
+		}
+	}
+
+	hardBoundaries.push_back(triangleCount);
+
+
+	std::vector<uint32_t> clusters;
+
+	for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+
+		uint32_t start = hardBoundaries[h];
+		uint32_t end = hardBoundaries[h + 1];
+
+
+		cache.flush();
+		uint32_t clusterMisses = 0;
+
+		for (uint32_t t = start; t < end; t++) {
+			clusterMisses += cache.accessTriangle(&indices[t * 3]);
+		}
+
+		float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+
+		//Soft boundaries: split as soon as the running ACMR (with a cold cache) is within threshold of the whole cluster's.
+		cache.flush();
+		clusters.push_back(start);
+
+		uint32_t runningMisses = 0;
+		uint32_t runningTriangles = 0;
+
+		for (uint32_t t = start; t < end; t++) {
+
+			runningMisses += cache.accessTriangle(&indices[t * 3]);
+			runningTriangles++;
+
+			if (t + 1 < end && static_cast<float>(runningMisses) <= clusterThreshold * static_cast<float>(runningTriangles)) {
+
+				clusters.push_back(t + 1);
+				cache.flush();
+
+				runningMisses = 0;
+				runningTriangles = 0;
+			}
+		}
+	}
+
+	return clusters;
+}
+
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const char* positions, size_t positionStride, size_t vertexCount, float threshold, uint32_t cacheSize){
+
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+	if (triangleCount == 0 || vertexCount == 0) {
+		return;
+	}
+
+
+	std::vector<uint32_t> clusters = findClusters(indices, vertexCount, threshold, cacheSize);
+	clusters.push_back(triangleCount);
+
+	size_t clusterCount = clusters.size() - 1;
+
+
+	Float3 meshCenter = { 0.0f, 0.0f, 0.0f };
+
+	for (uint32_t v = 0; v < vertexCount; v++) {
+
+		Float3 p = loadPosition(positions, positionStride, v);
+
+		meshCenter.x += p.x;
+		meshCenter.y += p.y;
+		meshCenter.z += p.z;
+	}
+
+	meshCenter.x /= static_cast<float>(vertexCount);
+	meshCenter.y /= static_cast<float>(vertexCount);
+	meshCenter.z /= static_cast<float>(vertexCount);
+
+
+	//Clusters facing away from the mesh center are likely to occlude the rest, so they draw first.
+	std::vector<float> sortKeys(clusterCount);
+
+	for (size_t c = 0; c < clusterCount; c++) {
+
+		Float3 centroid = { 0.0f, 0.0f, 0.0f };
+		Float3 normal = { 0.0f, 0.0f, 0.0f };
+		float areaSum = 0.0f;
+
+		for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+
+			Float3 p0 = loadPosition(positions, positionStride, indices[t * 3 + 0]);
+			Float3 p1 = loadPosition(positions, positionStride, indices[t * 3 + 1]);
+			Float3 p2 = loadPosition(positions, positionStride, indices[t * 3 + 2]);
+
+			Float3 e1 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+			Float3 e2 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+			Float3 cross = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+
+			float area = std::sqrt(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z);
+
+			centroid.x += (p0.x + p1.x + p2.x) / 3.0f * area;
+			centroid.y += (p0.y + p1.y + p2.y) / 3.0f * area;
+			centroid.z += (p0.z + p1.z + p2.z) / 3.0f * area;
+			areaSum += area;
+
+			normal.x += cross.x;
+			normal.y += cross.y;
+			normal.z += cross.z;
+		}
+
+		if (areaSum > 0.0f) {
+
+			centroid.x /= areaSum;
+			centroid.y /= areaSum;
+			centroid.z /= areaSum;
+		}
+
+		float normalLength = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+
+		if (normalLength > 0.0f) {
+
+			normal.x /= normalLength;
+			normal.y /= normalLength;
+			normal.z /= normalLength;
+		}
+
+		sortKeys[c] = (centroid.x - meshCenter.x) * normal.x + (centroid.y - meshCenter.y) * normal.y + (centroid.z - meshCenter.z) * normal.z;
+	}
+
+
+	std::vector<uint32_t> order(clusterCount);
+
+	for (size_t c = 0; c < clusterCount; c++) {
+		order[c] = static_cast<uint32_t>(c);
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+
+	for (uint32_t c : order) {
+		sorted.insert(sorted.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+
+	indices = std::move(sorted);
+}
+
+
+size_t MeshOptimizer::optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& remap){
+
+	remap.assign(vertexCount, UNUSED_VERTEX);
+	uint32_t nextVertex = 0;
+
+	for (uint32_t& index : indices) {
+
+		if (remap[index] == UNUSED_VERTEX) {
+			remap[index] = nextVertex++;
+		}
+
+		index = remap[index];
+	}
+
+	return nextVertex;
+}
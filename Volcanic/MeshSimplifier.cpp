@@ -0,0 +1,555 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "CpuTracer.h"
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+
+
+namespace {
+
+	//A collapse of every wedge at corner from onto corner to, costed when it was queued. It's stale once either corner
+	//has changed since.
+	struct Collapse {
+
+		double cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t fromVersion;
+		uint32_t toVersion;
+
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+
+
+	void cross(const double* a, const double* b, double* result) {
+
+		result[0] = a[1] * b[2] - a[2] * b[1];
+		result[1] = a[2] * b[0] - a[0] * b[2];
+		result[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+
+	//Twice the area, along the normal.
+	void triangleNormal(const float* p0, const float* p1, const float* p2, double* normal) {
+
+		double e1[3] = { double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2] };
+		double e2[3] = { double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2] };
+
+		cross(e1, e2, normal);
+	}
+}
+
+
+void MeshSimplifier::Quadric::addPlane(double nx, double ny, double nz, double d, double planeWeight){
+
+	a00 += planeWeight * nx * nx;
+	a01 += planeWeight * nx * ny;
+	a02 += planeWeight * nx * nz;
+	a11 += planeWeight * ny * ny;
+	a12 += planeWeight * ny * nz;
+	a22 += planeWeight * nz * nz;
+	b0 += planeWeight * nx * d;
+	b1 += planeWeight * ny * d;
+	b2 += planeWeight * nz * d;
+	c += planeWeight * d * d;
+	weight += planeWeight;
+}
+
+
+void MeshSimplifier::Quadric::add(const Quadric& other){
+
+	a00 += other.a00;
+	a01 += other.a01;
+	a02 += other.a02;
+	a11 += other.a11;
+	a12 += other.a12;
+	a22 += other.a22;
+	b0 += other.b0;
+	b1 += other.b1;
+	b2 += other.b2;
+	c += other.c;
+	weight += other.weight;
+}
+
+
+double MeshSimplifier::Quadric::evaluate(const float* p) const{
+
+	double x = p[0], y = p[1], z = p[2];
+
+	//p^T A p + 2 b^T p + c
+	return a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+		+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+}
+
+
+std::vector<MeshLod> MeshSimplifier::generateLods(const char* positions, size_t positionStride, size_t vertexCount, std::vector<uint32_t>& indices){
+
+	TRACE_FUNCTION();
+
+	std::vector<MeshLod> lods(1);
+	lods[0].indexCount = static_cast<uint32_t>(indices.size());
+
+	std::vector<size_t> targetIndexCounts;
+
+	for (float ratio : LOD_RATIOS) {
+		targetIndexCounts.push_back(static_cast<size_t>(indices.size() / 3 * ratio) * 3);
+	}
+
+	//One pass of collapses, kept at every level, so each level's error is measured against the full mesh and never
+	//shrinks from one level to the next (which keeps selecting by error monotonic).
+	std::vector<float> errors;
+	std::vector<std::vector<uint32_t>> levels = simplify(positions, positionStride, vertexCount, indices, targetIndexCounts, errors);
+
+	for (size_t level = 0; level < levels.size(); level++) {
+
+		std::vector<uint32_t>& lodIndices = levels[level];
+
+		if (lodIndices.empty() || lodIndices.size() > lods.back().indexCount * (1.0f - MIN_LOD_REDUCTION)) {
+			break;
+		}
+
+		MeshOptimizer::optimizeVertexCache(lodIndices, vertexCount);
+
+
+		MeshLod lod;
+		lod.firstIndex = static_cast<uint32_t>(indices.size());
+		lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+		lod.error = errors[level];
+
+		lods.push_back(lod);
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+	}
+
+	return lods;
+}
+
+
+std::vector<std::vector<uint32_t>> MeshSimplifier::simplify(const char* positions, size_t positionStride, size_t vertexCount, const std::vector<uint32_t>& indices,
+	const std::vector<size_t>& targetIndexCounts, std::vector<float>& errors){
+
+	TRACE_FUNCTION();
+
+	float error = 0.0f;
+
+	auto position = [&](uint32_t vertex) { return reinterpret_cast<const float*>(positions + vertex * positionStride); };
+
+
+	//Vertices at the same position are wedges of one corner (split by their other attributes); collapses move corners.
+	std::vector<uint32_t> sortedVertices(vertexCount);
+
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		sortedVertices[v] = v;
+	}
+
+	std::sort(sortedVertices.begin(), sortedVertices.end(), [&](uint32_t a, uint32_t b) { return memcmp(position(a), position(b), 3 * sizeof(float)) < 0; });
+
+	std::vector<uint32_t> vertexCorners(vertexCount);
+	std::vector<uint32_t> cornerWedgeStarts;
+
+	for (size_t i = 0; i < vertexCount; i++) {
+
+		if (i == 0 || memcmp(position(sortedVertices[i]), position(sortedVertices[i - 1]), 3 * sizeof(float)) != 0) {
+			cornerWedgeStarts.push_back(static_cast<uint32_t>(i));
+		}
+
+		vertexCorners[sortedVertices[i]] = static_cast<uint32_t>(cornerWedgeStarts.size() - 1);
+	}
+
+	uint32_t cornerCount = static_cast<uint32_t>(cornerWedgeStarts.size());
+	cornerWedgeStarts.push_back(static_cast<uint32_t>(vertexCount));
+
+	auto cornerPosition = [&](uint32_t corner) { return position(sortedVertices[cornerWedgeStarts[corner]]); };
+
+
+	//Triangles folded onto a single corner have no surface to keep.
+	size_t triangleCount = indices.size() / 3;
+	std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+	std::vector<uint8_t> triangleAlive(triangleCount, 1);
+	std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+	size_t aliveTriangleCount = 0;
+
+	for (uint32_t t = 0; t < triangleCount; t++) {
+
+		uint32_t c0 = vertexCorners[triangles[t * 3]];
+		uint32_t c1 = vertexCorners[triangles[t * 3 + 1]];
+		uint32_t c2 = vertexCorners[triangles[t * 3 + 2]];
+
+		if (c0 == c1 || c1 == c2 || c2 == c0) {
+
+			triangleAlive[t] = 0;
+			continue;
+		}
+
+		for (int k = 0; k < 3; k++) {
+			vertexTriangles[triangles[t * 3 + k]].push_back(t);
+		}
+
+		aliveTriangleCount++;
+	}
+
+
+	//Every corner starts with the planes of its triangles, weighted by area.
+	std::vector<Quadric> quadrics(cornerCount);
+	std::unordered_map<uint64_t, uint32_t> edgeTriangleCounts;
+
+	auto edgeKey = [](uint32_t a, uint32_t b) { return static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b); };
+
+	for (uint32_t t = 0; t < triangleCount; t++) {
+
+		if (!triangleAlive[t]) {
+			continue;
+		}
+
+		const float* p0 = position(triangles[t * 3]);
+		double normal[3];
+		triangleNormal(p0, position(triangles[t * 3 + 1]), position(triangles[t * 3 + 2]), normal);
+
+		double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+		for (int k = 0; k < 3; k++) {
+			edgeTriangleCounts[edgeKey(vertexCorners[triangles[t * 3 + k]], vertexCorners[triangles[t * 3 + (k + 1) % 3]])]++;
+		}
+
+		if (length == 0.0) {
+			continue;
+		}
+
+		double n[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+		double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+
+		for (int k = 0; k < 3; k++) {
+			quadrics[vertexCorners[triangles[t * 3 + k]]].addPlane(n[0], n[1], n[2], d, 0.5 * length);
+		}
+	}
+
+	//An edge of a single triangle is on an open border: a plane through it, perpendicular to the triangle, keeps its
+	//corners from wandering off the border.
+	for (uint32_t t = 0; t < triangleCount; t++) {
+
+		if (!triangleAlive[t]) {
+			continue;
+		}
+
+		double normal[3];
+		triangleNormal(position(triangles[t * 3]), position(triangles[t * 3 + 1]), position(triangles[t * 3 + 2]), normal);
+
+		for (int k = 0; k < 3; k++) {
+
+			uint32_t a = vertexCorners[triangles[t * 3 + k]];
+			uint32_t b = vertexCorners[triangles[t * 3 + (k + 1) % 3]];
+
+			if (edgeTriangleCounts[edgeKey(a, b)] != 1) {
+				continue;
+			}
+
+			const float* pa = cornerPosition(a);
+			const float* pb = cornerPosition(b);
+			double edge[3] = { double(pb[0]) - pa[0], double(pb[1]) - pa[1], double(pb[2]) - pa[2] };
+
+			double n[3];
+			cross(edge, normal, n);
+
+			double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			if (length == 0.0) {
+				continue;
+			}
+
+			n[0] /= length;
+			n[1] /= length;
+			n[2] /= length;
+
+			double d = -(n[0] * pa[0] + n[1] * pa[1] + n[2] * pa[2]);
+			double weight = BORDER_WEIGHT * (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]);
+
+			quadrics[a].addPlane(n[0], n[1], n[2], d, weight);
+			quadrics[b].addPlane(n[0], n[1], n[2], d, weight);
+		}
+	}
+
+
+	std::vector<uint8_t> cornerAlive(cornerCount, 1);
+	std::vector<uint32_t> cornerVersions(cornerCount, 0);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+	auto costOf = [&](uint32_t from, uint32_t to) {
+
+		Quadric sum = quadrics[from];
+		sum.add(quadrics[to]);
+
+		return sum.evaluate(cornerPosition(to));
+	};
+
+	auto push = [&](uint32_t from, uint32_t to) {
+
+		queue.push({ costOf(from, to), from, to, cornerVersions[from], cornerVersions[to] });
+	};
+
+	for (uint32_t t = 0; t < triangleCount; t++) {
+
+		if (!triangleAlive[t]) {
+			continue;
+		}
+
+		for (int k = 0; k < 3; k++) {
+
+			uint32_t a = vertexCorners[triangles[t * 3 + k]];
+			uint32_t b = vertexCorners[triangles[t * 3 + (k + 1) % 3]];
+
+			push(a, b);
+			push(b, a);
+		}
+	}
+
+
+	//The live triangles around a corner, and the other corners they reach.
+	std::vector<uint32_t> fromTriangles;
+	std::vector<uint32_t> fromNeighbours;
+	std::vector<uint32_t> toNeighbours;
+	std::vector<uint32_t> wedgeTargets;
+
+	auto gatherTriangles = [&](uint32_t corner, std::vector<uint32_t>& cornerTriangles) {
+
+		cornerTriangles.clear();
+
+		for (uint32_t w = cornerWedgeStarts[corner]; w < cornerWedgeStarts[corner + 1]; w++) {
+			for (uint32_t t : vertexTriangles[sortedVertices[w]]) {
+
+				//Lists keep triangles that died or moved on to another wedge; only the wedge's live ones count.
+				bool hasWedge = triangles[t * 3] == sortedVertices[w] || triangles[t * 3 + 1] == sortedVertices[w] || triangles[t * 3 + 2] == sortedVertices[w];
+
+				if (triangleAlive[t] && hasWedge) {
+					cornerTriangles.push_back(t);
+				}
+			}
+		}
+	};
+
+	auto gatherNeighbours = [&](uint32_t corner, const std::vector<uint32_t>& cornerTriangles, std::vector<uint32_t>& neighbours) {
+
+		neighbours.clear();
+
+		for (uint32_t t : cornerTriangles) {
+			for (int k = 0; k < 3; k++) {
+
+				uint32_t other = vertexCorners[triangles[t * 3 + k]];
+
+				if (other != corner) {
+					neighbours.push_back(other);
+				}
+			}
+		}
+
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+	};
+
+	std::vector<uint32_t> toTriangles;
+
+
+	std::vector<std::vector<uint32_t>> levels;
+	errors.clear();
+
+	auto keepLevel = [&]() {
+
+		levels.emplace_back();
+		levels.back().reserve(aliveTriangleCount * 3);
+
+		for (uint32_t t = 0; t < triangleCount; t++) {
+
+			if (triangleAlive[t]) {
+				levels.back().insert(levels.back().end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+			}
+		}
+
+		errors.push_back(error);
+	};
+
+	while (levels.size() < targetIndexCounts.size()) {
+
+		if (aliveTriangleCount * 3 <= targetIndexCounts[levels.size()] || queue.empty()) {
+
+			keepLevel();
+			continue;
+		}
+
+		Collapse collapse = queue.top();
+		queue.pop();
+
+		uint32_t from = collapse.from;
+		uint32_t to = collapse.to;
+
+		if (!cornerAlive[from] || !cornerAlive[to] || collapse.fromVersion != cornerVersions[from] || collapse.toVersion != cornerVersions[to]) {
+			continue;
+		}
+
+		gatherTriangles(from, fromTriangles);
+
+
+		//Each wedge of from that still has triangles moves onto the one wedge of to it shares an edge with. A wedge with
+		//none (a seam crossed instead of followed) or several can't move without tearing its attributes.
+		uint32_t wedgeCount = cornerWedgeStarts[from + 1] - cornerWedgeStarts[from];
+		wedgeTargets.assign(wedgeCount, UINT32_MAX);
+		uint32_t edgeTriangleCount = 0;
+		bool valid = true;
+
+		for (uint32_t t : fromTriangles) {
+
+			uint32_t wedge = UINT32_MAX;
+			uint32_t target = UINT32_MAX;
+
+			for (int k = 0; k < 3; k++) {
+
+				uint32_t v = triangles[t * 3 + k];
+
+				if (vertexCorners[v] == from) {
+					wedge = v;
+				}
+				else if (vertexCorners[v] == to) {
+					target = v;
+				}
+			}
+
+			if (target == UINT32_MAX) {
+				continue;
+			}
+
+			edgeTriangleCount++;
+
+			uint32_t slot = static_cast<uint32_t>(std::find(sortedVertices.begin() + cornerWedgeStarts[from], sortedVertices.begin() + cornerWedgeStarts[from + 1], wedge)
+				- (sortedVertices.begin() + cornerWedgeStarts[from]));
+
+			if (wedgeTargets[slot] != UINT32_MAX && wedgeTargets[slot] != target) {
+				valid = false;
+			}
+
+			wedgeTargets[slot] = target;
+		}
+
+		for (uint32_t t : fromTriangles) {
+			for (uint32_t w = 0; w < wedgeCount && valid; w++) {
+
+				bool hasWedge = triangles[t * 3] == sortedVertices[cornerWedgeStarts[from] + w] || triangles[t * 3 + 1] == sortedVertices[cornerWedgeStarts[from] + w] ||
+					triangles[t * 3 + 2] == sortedVertices[cornerWedgeStarts[from] + w];
+
+				valid = !hasWedge || wedgeTargets[w] != UINT32_MAX;
+			}
+		}
+
+		if (!valid || edgeTriangleCount == 0) {
+			continue;
+		}
+
+
+		//Link condition: the corners both ends reach must be exactly the tips of the triangles on the edge, or the
+		//collapse would pinch the surface.
+		gatherTriangles(to, toTriangles);
+		gatherNeighbours(from, fromTriangles, fromNeighbours);
+		gatherNeighbours(to, toTriangles, toNeighbours);
+
+		uint32_t sharedCount = 0;
+
+		for (uint32_t neighbour : fromNeighbours) {
+			sharedCount += std::binary_search(toNeighbours.begin(), toNeighbours.end(), neighbour) ? 1 : 0;
+		}
+
+		if (sharedCount != edgeTriangleCount) {
+			continue;
+		}
+
+
+		//No remaining triangle may turn over.
+		const float* destination = cornerPosition(to);
+
+		for (uint32_t t : fromTriangles) {
+
+			const float* before[3];
+			const float* after[3];
+			bool onEdge = false;
+
+			for (int k = 0; k < 3; k++) {
+
+				uint32_t corner = vertexCorners[triangles[t * 3 + k]];
+
+				before[k] = position(triangles[t * 3 + k]);
+				after[k] = corner == from ? destination : before[k];
+				onEdge = onEdge || corner == to;
+			}
+
+			if (onEdge) {
+				continue;
+			}
+
+			double normalBefore[3], normalAfter[3];
+			triangleNormal(before[0], before[1], before[2], normalBefore);
+			triangleNormal(after[0], after[1], after[2], normalAfter);
+
+			if (normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2] <= 0.0) {
+
+				valid = false;
+				break;
+			}
+		}
+
+		if (!valid) {
+			continue;
+		}
+
+
+		//Collapse: the edge's triangles disappear, the others move onto to's wedges.
+		double weight = quadrics[from].weight + quadrics[to].weight;
+		error = std::max(error, static_cast<float>(std::sqrt(std::max(collapse.cost, 0.0) / std::max(weight, 1e-30))));
+
+		for (uint32_t t : fromTriangles) {
+
+			for (int k = 0; k < 3 && triangleAlive[t]; k++) {
+
+				if (vertexCorners[triangles[t * 3 + k]] == to) {
+
+					triangleAlive[t] = 0;
+					aliveTriangleCount--;
+				}
+			}
+
+			if (!triangleAlive[t]) {
+				continue;
+			}
+
+			for (int k = 0; k < 3; k++) {
+
+				uint32_t v = triangles[t * 3 + k];
+
+				if (vertexCorners[v] == from) {
+
+					uint32_t slot = static_cast<uint32_t>(std::find(sortedVertices.begin() + cornerWedgeStarts[from], sortedVertices.begin() + cornerWedgeStarts[from + 1], v)
+						- (sortedVertices.begin() + cornerWedgeStarts[from]));
+
+					triangles[t * 3 + k] = wedgeTargets[slot];
+					vertexTriangles[wedgeTargets[slot]].push_back(t);
+				}
+			}
+		}
+
+		quadrics[to].add(quadrics[from]);
+		cornerAlive[from] = 0;
+		cornerVersions[to]++;
+
+
+		//Only collapses touching to have changed cost.
+		gatherTriangles(to, toTriangles);
+		gatherNeighbours(to, toTriangles, toNeighbours);
+
+		for (uint32_t neighbour : toNeighbours) {
+
+			push(to, neighbour);
+			push(neighbour, to);
+		}
+	}
+
+
+	return levels;
+}
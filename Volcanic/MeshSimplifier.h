@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+//One level of detail of a mesh: its range of the mesh's index buffer and how far (in the mesh's units) its surface may
+//stray from the full-resolution mesh. Every level indexes the same vertices.
+struct MeshLod {
+
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	float error = 0.0f;
+};
+
+
+//Quadric error simplification (Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics", SIGGRAPH 1997)
+//restricted to half-edge collapses, so a simplified mesh only drops vertices and can share the original vertex buffer.
+//Vertices with the same position but different attributes (texture seams) only collapse together, along the seam,
+//and open borders are held in place by extra planes through their edges. Collapses that would flip a triangle or make
+//the mesh non-manifold are skipped.
+class MeshSimplifier {
+
+public:
+	//Triangle ratios of the levels generateLods() builds after the full mesh.
+	static constexpr float LOD_RATIOS[] = { 0.5f, 0.25f, 0.125f };
+
+	//A level must drop at least this share of the previous one's triangles (and keep some), or the chain ends there.
+	static constexpr float MIN_LOD_REDUCTION = 0.1f;
+
+	//Weight of the planes holding open borders, relative to the triangles' own.
+	static constexpr double BORDER_WEIGHT = 10.0;
+
+	//Appends the levels of LOD_RATIOS to indices, each simplified from the full mesh and optimized for the vertex cache,
+	//and returns the chain: the full mesh first, then the levels in order. The vertex type needs three consecutive
+	//floats (the position) at positionOffset.
+	template<typename T>
+	static std::vector<MeshLod> generateLods(const std::vector<T>& vertices, std::vector<uint32_t>& indices, size_t positionOffset) {
+
+		return generateLods(reinterpret_cast<const char*>(vertices.data()) + positionOffset, sizeof(T), vertices.size(), indices);
+	}
+
+	static std::vector<MeshLod> generateLods(const char* positions, size_t positionStride, size_t vertexCount, std::vector<uint32_t>& indices);
+
+	//Collapses edges of the triangle list until at most each of targetIndexCounts (in decreasing order) indices are left,
+	//or nothing more can go, and returns the remaining triangles at each. errors is set to the largest deviation of any
+	//collapse up to each level, in the mesh's units.
+	static std::vector<std::vector<uint32_t>> simplify(const char* positions, size_t positionStride, size_t vertexCount, const std::vector<uint32_t>& indices,
+		const std::vector<size_t>& targetIndexCounts, std::vector<float>& errors);
+
+private:
+	//Sum of squared distances to a set of weighted planes, as a symmetric 4x4 matrix.
+	struct Quadric {
+
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+
+		//Sum of the planes' weights, to turn the error back into a distance.
+		double weight = 0.0;
+
+		void addPlane(double nx, double ny, double nz, double d, double planeWeight);
+
+		void add(const Quadric& other);
+
+		double evaluate(const float* p) const;
+	};
+};
@@ -0,0 +1,158 @@
+#include "MeshletBuilder.h"
+#include "CpuTracer.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+std::vector<Meshlet> MeshletBuilder::build(const char* positions, size_t positionStride, size_t vertexCount, const uint32_t* indices, uint32_t firstIndex,
+	uint32_t indexCount){
+
+	TRACE_FUNCTION();
+
+	std::vector<Meshlet> meshlets;
+
+	//The meshlet each vertex was last counted in (+1, so 0 is none): a vertex is only new to the current one once.
+	std::vector<uint32_t> vertexMeshlets(vertexCount, 0);
+	uint32_t meshletVertexCount = 0;
+
+	Meshlet meshlet;
+	meshlet.firstIndex = firstIndex;
+
+	for (uint32_t i = firstIndex; i + 2 < firstIndex + indexCount; i += 3) {
+
+		uint32_t stamp = static_cast<uint32_t>(meshlets.size()) + 1;
+		uint32_t newVertexCount = 0;
+
+		for (uint32_t k = 0; k < 3; k++) {
+
+			//A triangle repeating a vertex only counts it once.
+			bool repeated = (k > 0 && indices[i + k] == indices[i]) || (k > 1 && indices[i + k] == indices[i + 1]);
+			newVertexCount += vertexMeshlets[indices[i + k]] != stamp && !repeated ? 1 : 0;
+		}
+
+		if (meshletVertexCount + newVertexCount > MAX_VERTICES || meshlet.indexCount / 3 == MAX_TRIANGLES) {
+
+			computeBounds(positions, positionStride, indices, meshlet);
+			meshlets.push_back(meshlet);
+
+			meshlet = Meshlet();
+			meshlet.firstIndex = i;
+			meshletVertexCount = 0;
+			stamp++;
+		}
+
+		for (uint32_t k = 0; k < 3; k++) {
+
+			if (vertexMeshlets[indices[i + k]] != stamp) {
+
+				vertexMeshlets[indices[i + k]] = stamp;
+				meshletVertexCount++;
+			}
+		}
+
+		meshlet.indexCount += 3;
+	}
+
+	if (meshlet.indexCount > 0) {
+
+		computeBounds(positions, positionStride, indices, meshlet);
+		meshlets.push_back(meshlet);
+	}
+
+	return meshlets;
+}
+
+
+void MeshletBuilder::computeBounds(const char* positions, size_t positionStride, const uint32_t* indices, Meshlet& meshlet){
+
+	auto position = [&](uint32_t vertex) { return reinterpret_cast<const float*>(positions + vertex * positionStride); };
+
+
+	//Centered on the vertices' box, reaching the farthest of them.
+	float min[3] = { INFINITY, INFINITY, INFINITY };
+	float max[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+	for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++) {
+
+		const float* p = position(indices[i]);
+
+		for (int axis = 0; axis < 3; axis++) {
+
+			min[axis] = std::min(min[axis], p[axis]);
+			max[axis] = std::max(max[axis], p[axis]);
+		}
+	}
+
+	float radiusSquared = 0.0f;
+
+	for (int axis = 0; axis < 3; axis++) {
+		meshlet.boundingSphere[axis] = 0.5f * (min[axis] + max[axis]);
+	}
+
+	for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++) {
+
+		const float* p = position(indices[i]);
+
+		float dx = p[0] - meshlet.boundingSphere[0];
+		float dy = p[1] - meshlet.boundingSphere[1];
+		float dz = p[2] - meshlet.boundingSphere[2];
+
+		radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+	}
+
+	meshlet.boundingSphere[3] = std::sqrt(radiusSquared);
+
+
+	//The cone's axis is the average of the triangles' unit normals, its width set by the one farthest from it.
+	std::vector<float> normals;
+	float axis[3] = {};
+
+	for (uint32_t i = meshlet.firstIndex; i + 2 < meshlet.firstIndex + meshlet.indexCount; i += 3) {
+
+		const float* p0 = position(indices[i]);
+		const float* p1 = position(indices[i + 1]);
+		const float* p2 = position(indices[i + 2]);
+
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+
+		float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		//Degenerate triangles face nowhere, and don't draw anyway.
+		if (length == 0.0f) {
+			continue;
+		}
+
+		for (int k = 0; k < 3; k++) {
+
+			normals.push_back(n[k] / length);
+			axis[k] += n[k] / length;
+		}
+	}
+
+	float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+
+	if (axisLength == 0.0f) {
+		return;
+	}
+
+	float minCosine = 1.0f;
+
+	for (size_t n = 0; n < normals.size(); n += 3) {
+		minCosine = std::min(minCosine, (normals[n] * axis[0] + normals[n + 1] * axis[1] + normals[n + 2] * axis[2]) / axisLength);
+	}
+
+	if (minCosine < MIN_CONE_COSINE) {
+		return;
+	}
+
+	for (int k = 0; k < 3; k++) {
+		meshlet.coneAxis[k] = axis[k] / axisLength;
+	}
+
+	//Every normal is within acos(minCosine) of the axis, so the triangles all face away once the view direction is
+	//within 90 - acos(minCosine) degrees of it: the sine of the normals' spread.
+	meshlet.coneCutoff = std::sqrt(1.0f - minCosine * minCosine);
+}
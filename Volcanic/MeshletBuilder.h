@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+//A cluster of a mesh's triangles: a contiguous range of its index buffer, a bounding sphere (center & radius) and the
+//cone of its triangles' normals. Every triangle faces away from a camera at p when
+//dot(center - p, coneAxis) >= coneCutoff * |center - p| + radius; a cutoff of 1 never culls.
+//Laid out like Meshlet in ClusterCull.comp (std430).
+struct Meshlet {
+
+	float boundingSphere[4] = {};
+	float coneAxis[3] = { 0.0f, 0.0f, 1.0f };
+	float coneCutoff = 1.0f;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+
+	//Rounds the struct up to the shader's array stride.
+	uint32_t padding[2] = {};
+};
+
+
+//Splits a triangle list into meshlets of at most MAX_VERTICES vertices and MAX_TRIANGLES triangles, after the
+//"scan" clustering of meshoptimizer (Kapoulkine): triangles are taken in index buffer order, which the vertex cache
+//optimization has already made local, so every meshlet is a range of the existing index buffer and needs no indices
+//of its own. Cones wider than about 84 degrees (which would almost never cull) get a cutoff of 1.
+class MeshletBuilder {
+
+public:
+	//The sizes mesh shading hardware favours; without mesh shaders they still keep each cluster's bounds tight.
+	static constexpr uint32_t MAX_VERTICES = 64;
+	static constexpr uint32_t MAX_TRIANGLES = 124;
+
+	//Below this cosine between the cone's axis and its widest normal, the cone is dropped.
+	static constexpr float MIN_CONE_COSINE = 0.1f;
+
+	//Clusters indices [firstIndex, firstIndex + indexCount). The vertex type needs three consecutive floats (the
+	//position) at positionOffset.
+	template<typename T>
+	static std::vector<Meshlet> build(const std::vector<T>& vertices, const std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount,
+		size_t positionOffset) {
+
+		return build(reinterpret_cast<const char*>(vertices.data()) + positionOffset, sizeof(T), vertices.size(), indices.data(), firstIndex, indexCount);
+	}
+
+	static std::vector<Meshlet> build(const char* positions, size_t positionStride, size_t vertexCount, const uint32_t* indices, uint32_t firstIndex,
+		uint32_t indexCount);
+
+private:
+	//Sets the meshlet's sphere & cone from its triangles.
+	static void computeBounds(const char* positions, size_t positionStride, const uint32_t* indices, Meshlet& meshlet);
+};
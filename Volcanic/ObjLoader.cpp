@@ -0,0 +1,179 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+
+//tinyobj_loader_opt includes windows.h.
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#define TINYOBJ_LOADER_OPT_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+#include <tinyobj_loader_opt.h>
+
+#include <stdexcept>
+#include <streambuf>
+#include <istream>
+#include <algorithm>
+#include <thread>
+
+
+namespace {
+
+	//Lets the reference parser read straight from the mapping instead of opening the file through std::ifstream.
+	class MemoryStreamBuffer : public std::streambuf {
+
+	public:
+		MemoryStreamBuffer(const char* data, size_t size) {
+
+			char* begin = const_cast<char*>(data);
+			setg(begin, begin, begin + size);
+		}
+	};
+}
+
+
+ObjLoader::ObjLoader(Backend backend, uint32_t threadCount) : backend(backend), threadCount(threadCount){
+
+}
+
+
+uint32_t ObjLoader::getThreadCount() const{
+
+	if (backend == Backend::TinyObj) {
+		return 1;
+	}
+
+	return threadCount > 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+
+const char* ObjLoader::getBackendName(Backend backend){
+
+	return backend == Backend::TinyObj ? "tinyobj" : "tinyobj-opt";
+}
+
+
+bool ObjLoader::findBackend(const std::string& name, Backend& backend){
+
+	for (Backend candidate : { Backend::TinyObj, Backend::TinyObjOpt }) {
+
+		if (name == getBackendName(candidate)) {
+
+			backend = candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+size_t ObjLoader::load(const std::string& path, ObjMesh& mesh) const{
+
+	MappedFile file;
+
+	if (!file.open(path)) {
+
+		throw std::runtime_error("Failed to open model file! Filename: " + path);
+	}
+
+
+	mesh.positions.clear();
+	mesh.texCoords.clear();
+	mesh.indices.clear();
+
+	if (backend == Backend::TinyObj) {
+		loadTinyObj(file.getData(), file.getSize(), mesh);
+	}
+	else {
+		loadTinyObjOpt(file.getData(), file.getSize(), mesh);
+	}
+
+	return file.getSize();
+}
+
+
+void ObjLoader::loadTinyObj(const char* data, size_t size, ObjMesh& mesh) const{
+
+	MemoryStreamBuffer streamBuffer(data, size);
+	std::istream stream(&streamBuffer);
+
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string warn, err;
+
+
+	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream)) {
+
+		throw std::runtime_error(warn + err);
+	}
+
+
+	mesh.positions = std::move(attrib.vertices);
+	mesh.texCoords = std::move(attrib.texcoords);
+
+	size_t indexCount = 0;
+
+	for (const auto& shape : shapes) {
+		indexCount += shape.mesh.indices.size();
+	}
+
+	mesh.indices.reserve(indexCount);
+
+
+	for (const auto& shape : shapes) {
+
+		for (const auto& index : shape.mesh.indices) {
+			mesh.indices.push_back({ index.vertex_index, index.texcoord_index });
+		}
+	}
+}
+
+
+void ObjLoader::loadTinyObjOpt(const char* data, size_t size, ObjMesh& mesh) const{
+
+	tinyobj_opt::attrib_t attrib;
+	std::vector<tinyobj_opt::shape_t> shapes;
+	std::vector<tinyobj_opt::material_t> materials;
+
+	tinyobj_opt::LoadOption option;
+	option.req_num_threads = static_cast<int>(getThreadCount());
+	option.triangulate = true;
+
+
+	//The parser's line splitter drops a last line without a line ending, so such files are parsed from a copy with one.
+	std::vector<char> terminated;
+
+	if (size > 0 && data[size - 1] != '\n') {
+
+		terminated.reserve(size + 1);
+		terminated.assign(data, data + size);
+		terminated.push_back('\n');
+
+		data = terminated.data();
+		size = terminated.size();
+	}
+
+
+	if (!tinyobj_opt::parseObj(&attrib, &shapes, &materials, data, size, option)) {
+
+		throw std::runtime_error("Failed to parse model file!");
+	}
+
+
+	//The parser keeps its arrays in a pool allocator, so they are copied out rather than moved.
+	mesh.positions.assign(attrib.vertices.begin(), attrib.vertices.end());
+	mesh.texCoords.assign(attrib.texcoords.begin(), attrib.texcoords.end());
+	mesh.indices.resize(attrib.indices.size());
+
+	//The parser marks missing texture coordinates with INT_MIN rather than -1.
+	for (size_t i = 0; i < attrib.indices.size(); i++) {
+
+		int texCoord = attrib.indices[i].texcoord_index;
+
+		mesh.indices[i] = { attrib.indices[i].vertex_index, texCoord >= 0 ? texCoord : -1 };
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+
+
+struct ObjIndex {
+
+	int position;
+
+	//-1 if the face gave the corner no texture coordinate.
+	int texCoord;
+};
+
+
+//Triangulated geometry of an OBJ file. Positions are xyz, texture coordinates uv; three indices per triangle.
+struct ObjMesh {
+
+	std::vector<float> positions;
+	std::vector<float> texCoords;
+	std::vector<ObjIndex> indices;
+};
+
+
+//Parses OBJ files from a memory mapping with one of two backends: tinyobjloader's reference parser (single-threaded)
+//or the experimental tinyobj_loader_opt, which splits the file into line ranges and parses them on several threads.
+//Materials aren't loaded.
+class ObjLoader {
+
+public:
+	enum class Backend { TinyObj, TinyObjOpt };
+
+	//threadCount only applies to TinyObjOpt; 0 uses one thread per hardware thread.
+	explicit ObjLoader(Backend backend = Backend::TinyObj, uint32_t threadCount = 0);
+
+	//Throws if the file can't be read or parsed. Returns the size of the file in bytes.
+	size_t load(const std::string& path, ObjMesh& mesh) const;
+
+	Backend getBackend() const { return backend; }
+
+	uint32_t getThreadCount() const;
+
+	static const char* getBackendName(Backend backend);
+
+	//Accepts the names returned by getBackendName().
+	static bool findBackend(const std::string& name, Backend& backend);
+
+private:
+	Backend backend;
+	uint32_t threadCount;
+
+	void loadTinyObj(const char* data, size_t size, ObjMesh& mesh) const;
+
+	void loadTinyObjOpt(const char* data, size_t size, ObjMesh& mesh) const;
+};
@@ -0,0 +1,591 @@
+#include "OcclusionRasterizer.h"
+#include "JobSystem.h"
+#include "CpuTracer.h"
+#include "SimdTarget.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+
+void OcclusionRasterizer::resize(uint32_t newWidth, uint32_t newHeight){
+
+	width = newWidth;
+	height = newHeight;
+	tileCountX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+	tileCountY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+
+	depth.assign(static_cast<size_t>(tileCountX) * TILE_WIDTH * tileCountY * TILE_HEIGHT, 1.0f);
+	tileMaxDepth.assign(static_cast<size_t>(tileCountX) * tileCountY, 1.0f);
+	tileTriangles.resize(static_cast<size_t>(tileCountX) * tileCountY);
+
+	clearOccluders();
+}
+
+
+void OcclusionRasterizer::clearOccluders(){
+
+	triangles.clear();
+
+	//Keeps every bin's allocation for the next frame.
+	for (std::vector<uint32_t>& bin : tileTriangles) {
+		bin.clear();
+	}
+}
+
+
+void OcclusionRasterizer::addOccluder(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const float* modelViewProjection){
+
+	TRACE_FUNCTION();
+
+	const float* m = modelViewProjection;
+	clipPositions.resize(static_cast<size_t>(vertexCount) * 4);
+
+	for (uint32_t v = 0; v < vertexCount; v++) {
+
+		const float* p = positions + v * 3;
+		float* clip = &clipPositions[v * 4];
+
+		for (int row = 0; row < 4; row++) {
+			clip[row] = m[row] * p[0] + m[4 + row] * p[1] + m[8 + row] * p[2] + m[12 + row];
+		}
+	}
+
+
+	for (uint32_t i = 0; i + 3 <= indexCount; i += 3) {
+
+		float x[3], y[3], z[3];
+		bool clipped = false;
+
+		for (int corner = 0; corner < 3; corner++) {
+
+			const float* clip = &clipPositions[indices[i + corner] * 4];
+
+			//z < 0 is in front of the near plane (or behind the camera); clipping it would only make it smaller.
+			if (clip[3] <= 0.0f || clip[2] < 0.0f) {
+
+				clipped = true;
+				break;
+			}
+
+			float inverseW = 1.0f / clip[3];
+
+			x[corner] = (clip[0] * inverseW * 0.5f + 0.5f) * width;
+			y[corner] = (clip[1] * inverseW * 0.5f + 0.5f) * height;
+			z[corner] = clip[2] * inverseW;
+		}
+
+		if (clipped) {
+			continue;
+		}
+
+
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+
+		if (area == 0.0f) {
+			continue;
+		}
+
+		//Counter-clockwise in screen space, so the inside is positive for every edge.
+		if (area < 0.0f) {
+
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+		}
+
+
+		//The pixels whose centers lie within the triangle's bounds.
+		Triangle triangle;
+		triangle.minX = std::max(static_cast<int32_t>(std::ceil(std::min({ x[0], x[1], x[2] }) - 0.5f)), 0);
+		triangle.minY = std::max(static_cast<int32_t>(std::ceil(std::min({ y[0], y[1], y[2] }) - 0.5f)), 0);
+		triangle.maxX = std::min(static_cast<int32_t>(std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f)), static_cast<int32_t>(width) - 1);
+		triangle.maxY = std::min(static_cast<int32_t>(std::floor(std::max({ y[0], y[1], y[2] }) - 0.5f)), static_cast<int32_t>(height) - 1);
+
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+			continue;
+		}
+
+
+		//Edge e runs from corner e to the next one; its function is the (doubled) area spanned with the pixel, so
+		//edge e divided by the area weights the corner opposite of it.
+		for (int e = 0; e < 3; e++) {
+
+			int next = (e + 1) % 3;
+
+			triangle.edges[e][0] = y[e] - y[next];
+			triangle.edges[e][1] = x[next] - x[e];
+			triangle.edges[e][2] = x[e] * y[next] - x[next] * y[e];
+
+			triangle.ownsEdge[e] = triangle.edges[e][0] > 0.0f || (triangle.edges[e][0] == 0.0f && triangle.edges[e][1] > 0.0f) ? ~0 : 0;
+		}
+
+		for (int c = 0; c < 3; c++) {
+			triangle.depthPlane[c] = (z[0] * triangle.edges[1][c] + z[1] * triangle.edges[2][c] + z[2] * triangle.edges[0][c]) / area;
+		}
+
+
+		uint32_t index = static_cast<uint32_t>(triangles.size());
+		triangles.push_back(triangle);
+
+		for (uint32_t tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / TILE_HEIGHT; tileY++) {
+			for (uint32_t tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / TILE_WIDTH; tileX++) {
+				tileTriangles[tileY * tileCountX + tileX].push_back(index);
+			}
+		}
+	}
+}
+
+
+void OcclusionRasterizer::rasterize(Isa isa, bool parallel){
+
+	TRACE_FUNCTION();
+
+	if (!FrustumCuller::isSupported(isa)) {
+		throw std::runtime_error("Occlusion rasterizer ISA not supported!");
+	}
+
+	TileKernel kernel = isa == Isa::Avx ? rasterizeTileAvx : isa == Isa::Sse ? rasterizeTileSse : rasterizeTileScalar;
+
+	auto rasterizeTiles = [&](uint32_t begin, uint32_t end) {
+
+		for (uint32_t tile = begin; tile < end; tile++) {
+			rasterizeTile(kernel, tile);
+		}
+	};
+
+	uint32_t tileCount = tileCountX * tileCountY;
+
+	if (parallel) {
+		JobSystem::getDefault().parallelFor(tileCount, 1, rasterizeTiles);
+	}
+	else {
+		rasterizeTiles(0, tileCount);
+	}
+}
+
+
+void OcclusionRasterizer::rasterizeTile(TileKernel kernel, uint32_t tile){
+
+	int32_t tileX = static_cast<int32_t>((tile % tileCountX) * TILE_WIDTH);
+	int32_t tileY = static_cast<int32_t>((tile / tileCountX) * TILE_HEIGHT);
+	uint32_t stride = getStride();
+
+	for (uint32_t row = 0; row < TILE_HEIGHT; row++) {
+
+		float* rowDepth = &depth[(tileY + row) * stride + tileX];
+		std::fill(rowDepth, rowDepth + TILE_WIDTH, 1.0f);
+	}
+
+	const std::vector<uint32_t>& bin = tileTriangles[tile];
+
+	if (!bin.empty()) {
+		kernel(triangles.data(), bin.data(), static_cast<uint32_t>(bin.size()), tileX, tileY, depth.data(), stride);
+	}
+
+
+	//Only the pixels inside the buffer count; the padding stays at the far plane.
+	int32_t endX = std::min(tileX + static_cast<int32_t>(TILE_WIDTH), static_cast<int32_t>(width));
+	int32_t endY = std::min(tileY + static_cast<int32_t>(TILE_HEIGHT), static_cast<int32_t>(height));
+	float maxDepth = 0.0f;
+
+	for (int32_t y = tileY; y < endY; y++) {
+		for (int32_t x = tileX; x < endX; x++) {
+			maxDepth = std::max(maxDepth, depth[y * stride + x]);
+		}
+	}
+
+	tileMaxDepth[tile] = maxDepth;
+}
+
+
+void OcclusionRasterizer::cullBoxes(const BoundingBoxes& boxes, const float* viewProjection, std::vector<uint32_t>& visible, Isa isa, bool parallel) const{
+
+	TRACE_FUNCTION();
+
+	if (!FrustumCuller::isSupported(isa)) {
+		throw std::runtime_error("Occlusion rasterizer ISA not supported!");
+	}
+
+	RectKernel kernel = isa == Isa::Avx ? testRectAvx : isa == Isa::Sse ? testRectSse : testRectScalar;
+
+	uint32_t count = static_cast<uint32_t>(visible.size());
+	std::vector<uint8_t> keep(count);
+
+	auto testBoxes = [&](uint32_t begin, uint32_t end) {
+
+		for (uint32_t i = begin; i < end; i++) {
+			keep[i] = isBoxVisible(kernel, boxes, visible[i], viewProjection) ? 1 : 0;
+		}
+	};
+
+	if (parallel) {
+		JobSystem::getDefault().parallelFor(count, BOXES_PER_JOB, testBoxes);
+	}
+	else {
+		testBoxes(0, count);
+	}
+
+
+	uint32_t visibleCount = 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+
+		visible[visibleCount] = visible[i];
+		visibleCount += keep[i];
+	}
+
+	visible.resize(visibleCount);
+}
+
+
+bool OcclusionRasterizer::isBoxVisible(RectKernel kernel, const BoundingBoxes& boxes, uint32_t index, const float* viewProjection) const{
+
+	if (width == 0 || height == 0) {
+		return true;
+	}
+
+	const float* m = viewProjection;
+	float center[3] = { boxes.centerX[index], boxes.centerY[index], boxes.centerZ[index] };
+	float extent[3] = { boxes.extentX[index], boxes.extentY[index], boxes.extentZ[index] };
+
+	float minX = static_cast<float>(width);
+	float minY = static_cast<float>(height);
+	float maxX = 0.0f;
+	float maxY = 0.0f;
+	float nearest = 1.0f;
+
+	//The projected box lies within the bounds of its projected corners, and is nearest at one of them.
+	for (int corner = 0; corner < 8; corner++) {
+
+		float p[3];
+
+		for (int axis = 0; axis < 3; axis++) {
+			p[axis] = center[axis] + ((corner >> axis) & 1 ? extent[axis] : -extent[axis]);
+		}
+
+		float clip[4];
+
+		for (int row = 0; row < 4; row++) {
+			clip[row] = m[row] * p[0] + m[4 + row] * p[1] + m[8 + row] * p[2] + m[12 + row];
+		}
+
+		if (clip[3] <= 0.0f || clip[2] < 0.0f) {
+			return true;
+		}
+
+		float inverseW = 1.0f / clip[3];
+		float x = (clip[0] * inverseW * 0.5f + 0.5f) * width;
+		float y = (clip[1] * inverseW * 0.5f + 0.5f) * height;
+
+		minX = std::min(minX, x);
+		minY = std::min(minY, y);
+		maxX = std::max(maxX, x);
+		maxY = std::max(maxY, y);
+		nearest = std::min(nearest, clip[2] * inverseW);
+	}
+
+
+	//Every pixel the bounds touch, not only those whose centers they contain.
+	int32_t x0 = std::max(static_cast<int32_t>(std::floor(minX)), 0);
+	int32_t y0 = std::max(static_cast<int32_t>(std::floor(minY)), 0);
+	int32_t x1 = std::min(static_cast<int32_t>(std::ceil(maxX)), static_cast<int32_t>(width));
+	int32_t y1 = std::min(static_cast<int32_t>(std::ceil(maxY)), static_cast<int32_t>(height));
+
+	//Off screen.
+	if (x0 >= x1 || y0 >= y1) {
+		return false;
+	}
+
+
+	for (int32_t tileY = y0 / TILE_HEIGHT; tileY <= (y1 - 1) / static_cast<int32_t>(TILE_HEIGHT); tileY++) {
+		for (int32_t tileX = x0 / TILE_WIDTH; tileX <= (x1 - 1) / static_cast<int32_t>(TILE_WIDTH); tileX++) {
+
+			//Every pixel of the tile is nearer than the box.
+			if (tileMaxDepth[tileY * tileCountX + tileX] < nearest) {
+				continue;
+			}
+
+			int32_t rectX0 = std::max(x0, tileX * static_cast<int32_t>(TILE_WIDTH));
+			int32_t rectY0 = std::max(y0, tileY * static_cast<int32_t>(TILE_HEIGHT));
+			int32_t rectX1 = std::min(x1, (tileX + 1) * static_cast<int32_t>(TILE_WIDTH));
+			int32_t rectY1 = std::min(y1, (tileY + 1) * static_cast<int32_t>(TILE_HEIGHT));
+
+			if (kernel(depth.data(), getStride(), rectX0, rectY0, rectX1, rectY1, nearest)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+//The scalar kernels evaluate the edge & depth planes in the same order as the SIMD ones, so all ISAs agree bit for bit.
+void OcclusionRasterizer::rasterizeTileScalar(const Triangle* triangles, const uint32_t* indices, uint32_t count, int32_t tileX, int32_t tileY, float* depth, uint32_t stride){
+
+	for (uint32_t t = 0; t < count; t++) {
+
+		const Triangle& triangle = triangles[indices[t]];
+		const float (*e)[3] = triangle.edges;
+		const float* d = triangle.depthPlane;
+
+		int32_t x0 = std::max(triangle.minX, tileX);
+		int32_t y0 = std::max(triangle.minY, tileY);
+		int32_t x1 = std::min(triangle.maxX, tileX + static_cast<int32_t>(TILE_WIDTH) - 1);
+		int32_t y1 = std::min(triangle.maxY, tileY + static_cast<int32_t>(TILE_HEIGHT) - 1);
+
+		for (int32_t y = y0; y <= y1; y++) {
+
+			float py = static_cast<float>(y) + 0.5f;
+			float* row = depth + y * stride;
+
+			for (int32_t x = x0; x <= x1; x++) {
+
+				float px = static_cast<float>(x) + 0.5f;
+
+				bool inside = true;
+
+				for (int i = 0; i < 3; i++) {
+
+					float edge = e[i][0] * px + e[i][1] * py + e[i][2];
+					inside = inside && (edge > 0.0f || (edge == 0.0f && triangle.ownsEdge[i] != 0));
+				}
+
+				float z = d[0] * px + d[1] * py + d[2];
+
+				if (inside && z < row[x]) {
+					row[x] = z;
+				}
+			}
+		}
+	}
+}
+
+
+bool OcclusionRasterizer::testRectScalar(const float* depth, uint32_t stride, int32_t x0, int32_t y0, int32_t x1, int32_t y1, float nearest){
+
+	for (int32_t y = y0; y < y1; y++) {
+		for (int32_t x = x0; x < x1; x++) {
+
+			if (depth[y * stride + x] >= nearest) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+#ifdef VOLCANIC_SIMD_X86
+
+void OcclusionRasterizer::rasterizeTileSse(const Triangle* triangles, const uint32_t* indices, uint32_t count, int32_t tileX, int32_t tileY, float* depth, uint32_t stride){
+
+	const __m128 laneCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for (uint32_t t = 0; t < count; t++) {
+
+		const Triangle& triangle = triangles[indices[t]];
+
+		__m128 e[3][3];
+		__m128 owns[3];
+		__m128 d[3];
+
+		for (int i = 0; i < 3; i++) {
+
+			owns[i] = _mm_castsi128_ps(_mm_set1_epi32(triangle.ownsEdge[i]));
+			d[i] = _mm_set1_ps(triangle.depthPlane[i]);
+
+			for (int j = 0; j < 3; j++) {
+				e[i][j] = _mm_set1_ps(triangle.edges[i][j]);
+			}
+		}
+
+		int32_t x0 = std::max(triangle.minX, tileX);
+		int32_t y0 = std::max(triangle.minY, tileY);
+		int32_t x1 = std::min(triangle.maxX, tileX + static_cast<int32_t>(TILE_WIDTH) - 1);
+		int32_t y1 = std::min(triangle.maxY, tileY + static_cast<int32_t>(TILE_HEIGHT) - 1);
+
+		//Lanes outside the triangle's bounds are masked off, as the scalar kernel never visits them.
+		__m128 firstCenter = _mm_set1_ps(static_cast<float>(x0) + 0.5f);
+		__m128 lastCenter = _mm_set1_ps(static_cast<float>(x1) + 0.5f);
+
+		for (int32_t y = y0; y <= y1; y++) {
+
+			__m128 py = _mm_set1_ps(static_cast<float>(y) + 0.5f);
+			float* row = depth + y * stride;
+
+			//Groups of 4 start at multiples of 4, which the tiles (and the stride) are.
+			for (int32_t x = x0 & ~3; x <= x1; x += 4) {
+
+				__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneCenters);
+
+				__m128 inside = _mm_and_ps(_mm_cmpge_ps(px, firstCenter), _mm_cmple_ps(px, lastCenter));
+
+				for (int i = 0; i < 3; i++) {
+
+					__m128 edge = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e[i][0], px), _mm_mul_ps(e[i][1], py)), e[i][2]);
+					__m128 onEdge = _mm_and_ps(_mm_cmpeq_ps(edge, _mm_setzero_ps()), owns[i]);
+
+					inside = _mm_and_ps(inside, _mm_or_ps(_mm_cmpgt_ps(edge, _mm_setzero_ps()), onEdge));
+				}
+
+				__m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d[0], px), _mm_mul_ps(d[1], py)), d[2]);
+				__m128 old = _mm_loadu_ps(row + x);
+
+				//SSE2 has no blend: take the nearer depth where covered, the old one elsewhere.
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(z, old)), _mm_andnot_ps(inside, old)));
+			}
+		}
+	}
+}
+
+
+bool OcclusionRasterizer::testRectSse(const float* depth, uint32_t stride, int32_t x0, int32_t y0, int32_t x1, int32_t y1, float nearest){
+
+	const __m128 laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+	__m128 nearestDepth = _mm_set1_ps(nearest);
+	__m128 first = _mm_set1_ps(static_cast<float>(x0));
+	__m128 end = _mm_set1_ps(static_cast<float>(x1));
+
+	for (int32_t y = y0; y < y1; y++) {
+
+		const float* row = depth + y * stride;
+
+		for (int32_t x = x0 & ~3; x < x1; x += 4) {
+
+			__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+			__m128 inRect = _mm_and_ps(_mm_cmpge_ps(px, first), _mm_cmplt_ps(px, end));
+
+			if (_mm_movemask_ps(_mm_and_ps(inRect, _mm_cmpge_ps(_mm_loadu_ps(row + x), nearestDepth))) != 0) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+VOLCANIC_TARGET_AVX
+void OcclusionRasterizer::rasterizeTileAvx(const Triangle* triangles, const uint32_t* indices, uint32_t count, int32_t tileX, int32_t tileY, float* depth, uint32_t stride){
+
+	const __m256 laneCenters = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+
+	for (uint32_t t = 0; t < count; t++) {
+
+		const Triangle& triangle = triangles[indices[t]];
+
+		__m256 e[3][3];
+		__m256 owns[3];
+		__m256 d[3];
+
+		for (int i = 0; i < 3; i++) {
+
+			owns[i] = _mm256_castsi256_ps(_mm256_set1_epi32(triangle.ownsEdge[i]));
+			d[i] = _mm256_set1_ps(triangle.depthPlane[i]);
+
+			for (int j = 0; j < 3; j++) {
+				e[i][j] = _mm256_set1_ps(triangle.edges[i][j]);
+			}
+		}
+
+		int32_t x0 = std::max(triangle.minX, tileX);
+		int32_t y0 = std::max(triangle.minY, tileY);
+		int32_t x1 = std::min(triangle.maxX, tileX + static_cast<int32_t>(TILE_WIDTH) - 1);
+		int32_t y1 = std::min(triangle.maxY, tileY + static_cast<int32_t>(TILE_HEIGHT) - 1);
+
+		__m256 firstCenter = _mm256_set1_ps(static_cast<float>(x0) + 0.5f);
+		__m256 lastCenter = _mm256_set1_ps(static_cast<float>(x1) + 0.5f);
+
+		for (int32_t y = y0; y <= y1; y++) {
+
+			__m256 py = _mm256_set1_ps(static_cast<float>(y) + 0.5f);
+			float* row = depth + y * stride;
+
+			for (int32_t x = x0 & ~7; x <= x1; x += 8) {
+
+				__m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneCenters);
+
+				__m256 inside = _mm256_and_ps(_mm256_cmp_ps(px, firstCenter, _CMP_GE_OQ), _mm256_cmp_ps(px, lastCenter, _CMP_LE_OQ));
+
+				for (int i = 0; i < 3; i++) {
+
+					__m256 edge = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e[i][0], px), _mm256_mul_ps(e[i][1], py)), e[i][2]);
+					__m256 onEdge = _mm256_and_ps(_mm256_cmp_ps(edge, _mm256_setzero_ps(), _CMP_EQ_OQ), owns[i]);
+
+					inside = _mm256_and_ps(inside, _mm256_or_ps(_mm256_cmp_ps(edge, _mm256_setzero_ps(), _CMP_GT_OQ), onEdge));
+				}
+
+				__m256 z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(d[0], px), _mm256_mul_ps(d[1], py)), d[2]);
+				__m256 old = _mm256_loadu_ps(row + x);
+
+				//And/or rather than blendv, which GCC splits into lanes inside target("avx") functions.
+				_mm256_storeu_ps(row + x, _mm256_or_ps(_mm256_and_ps(inside, _mm256_min_ps(z, old)), _mm256_andnot_ps(inside, old)));
+			}
+		}
+	}
+
+	//Leaving AVX code without clearing the upper halves stalls following SSE code on older CPUs.
+	_mm256_zeroupper();
+}
+
+
+VOLCANIC_TARGET_AVX
+bool OcclusionRasterizer::testRectAvx(const float* depth, uint32_t stride, int32_t x0, int32_t y0, int32_t x1, int32_t y1, float nearest){
+
+	const __m256 laneOffsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+	__m256 nearestDepth = _mm256_set1_ps(nearest);
+	__m256 first = _mm256_set1_ps(static_cast<float>(x0));
+	__m256 end = _mm256_set1_ps(static_cast<float>(x1));
+	bool visible = false;
+
+	for (int32_t y = y0; y < y1 && !visible; y++) {
+
+		const float* row = depth + y * stride;
+
+		for (int32_t x = x0 & ~7; x < x1 && !visible; x += 8) {
+
+			__m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneOffsets);
+			__m256 inRect = _mm256_and_ps(_mm256_cmp_ps(px, first, _CMP_GE_OQ), _mm256_cmp_ps(px, end, _CMP_LT_OQ));
+
+			visible = _mm256_movemask_ps(_mm256_and_ps(inRect, _mm256_cmp_ps(_mm256_loadu_ps(row + x), nearestDepth, _CMP_GE_OQ))) != 0;
+		}
+	}
+
+	_mm256_zeroupper();
+
+	return visible;
+}
+
+#else
+
+//Without x86 intrinsics FrustumCuller::isSupported() only reports scalar, so these are never called.
+void OcclusionRasterizer::rasterizeTileSse(const Triangle* triangles, const uint32_t* indices, uint32_t count, int32_t tileX, int32_t tileY, float* depth, uint32_t stride){
+
+	rasterizeTileScalar(triangles, indices, count, tileX, tileY, depth, stride);
+}
+
+
+bool OcclusionRasterizer::testRectSse(const float* depth, uint32_t stride, int32_t x0, int32_t y0, int32_t x1, int32_t y1, float nearest){
+
+	return testRectScalar(depth, stride, x0, y0, x1, y1, nearest);
+}
+
+
+void OcclusionRasterizer::rasterizeTileAvx(const Triangle* triangles, const uint32_t* indices, uint32_t count, int32_t tileX, int32_t tileY, float* depth, uint32_t stride){
+
+	rasterizeTileScalar(triangles, indices, count, tileX, tileY, depth, stride);
+}
+
+
+bool OcclusionRasterizer::testRectAvx(const float* depth, uint32_t stride, int32_t x0, int32_t y0, int32_t x1, int32_t y1, float nearest){
+
+	return testRectScalar(depth, stride, x0, y0, x1, y1, nearest);
+}
+
+#endif
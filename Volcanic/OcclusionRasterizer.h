@@ -0,0 +1,107 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "FrustumCuller.h"
+
+
+//A low-resolution CPU depth buffer for occlusion culling without a GPU pass or readback, after masked software
+//occlusion culling (Hasselgren et al., 2016): a handful of large occluders are rasterized, then the bounding boxes of
+//everything else are tested against them. The buffer is split into tiles; triangles are binned to the tiles they touch
+//and every tile is rasterized by its own job, 1, 4 (SSE) or 8 (AVX) pixels at a time. Each tile also keeps its farthest
+//depth, so most boxes behind an occluder are rejected without reading their pixels.
+//Unlike the paper, pixels hold a full float depth rather than a coverage bit against two depth layers per tile, and the
+//kernels use SSE2/AVX rather than SSE4.1/AVX2. That is simpler and exact, but every covered pixel costs a depth test and
+//a 4-byte write (32 times the memory of a coverage mask), so rasterizing is bandwidth-bound at high resolutions.
+//Depth is z / w of Vulkan's [0, 1] clip space and clears to the far plane (1). Coverage is sampled at pixel centers.
+class OcclusionRasterizer {
+
+public:
+	typedef FrustumCuller::Isa Isa;
+
+	//Multiples of 8, so a SIMD row never straddles two tiles.
+	static constexpr uint32_t TILE_WIDTH = 32;
+	static constexpr uint32_t TILE_HEIGHT = 16;
+
+	//Boxes tested by one job.
+	static constexpr uint32_t BOXES_PER_JOB = 1024;
+
+	//Resizes the buffer and clears it. Until the first call, nothing is ever occluded.
+	void resize(uint32_t width, uint32_t height);
+
+	//Forgets the binned occluders. The buffer keeps its depth until the next rasterize().
+	void clearOccluders();
+
+	//Transforms an indexed mesh (positions as consecutive xyz) by a column-major model-view-projection matrix and bins
+	//its triangles. Triangles crossing the near plane are dropped, which only makes the occluder smaller; both windings
+	//are kept.
+	void addOccluder(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const float* modelViewProjection);
+
+	//Clears every tile and rasterizes the triangles binned to it. Throws if the ISA is not supported.
+	void rasterize(Isa isa = FrustumCuller::getBestIsa(), bool parallel = true);
+
+	//Removes the boxes hidden behind the rasterized occluders from visible (indices into boxes), keeping the others in
+	//order. viewProjection is column-major, like the occluders'. Boxes reaching in front of the near plane are kept.
+	void cullBoxes(const BoundingBoxes& boxes, const float* viewProjection, std::vector<uint32_t>& visible,
+		Isa isa = FrustumCuller::getBestIsa(), bool parallel = true) const;
+
+	uint32_t getWidth() const { return width; }
+
+	uint32_t getHeight() const { return height; }
+
+	//Binned since the last clearOccluders().
+	uint32_t getTriangleCount() const { return static_cast<uint32_t>(triangles.size()); }
+
+	//Row-major, getStride() floats per row: the width rounded up to whole tiles.
+	const float* getDepth() const { return depth.data(); }
+
+	uint32_t getStride() const { return tileCountX * TILE_WIDTH; }
+
+private:
+	//A triangle set up in screen space: edge functions A * x + B * y + C, positive inside, the plane its depth lies on,
+	//and the pixels its bounds cover (inclusive, clamped to the buffer). A pixel center exactly on an edge is inside if
+	//the triangle owns the edge (~0, else 0): the neighbour sharing it sees the negated function and doesn't, so the
+	//seams of a mesh leave no holes.
+	struct Triangle {
+
+		float edges[3][3];
+		int32_t ownsEdge[3];
+		float depthPlane[3];
+		int32_t minX;
+		int32_t minY;
+		int32_t maxX;
+		int32_t maxY;
+	};
+
+	//Rasterize the triangles with the given indices into the tile whose top left pixel is (tileX, tileY).
+	typedef void(*TileKernel)(const Triangle* triangles, const uint32_t* indices, uint32_t count, int32_t tileX, int32_t tileY, float* depth, uint32_t stride);
+
+	//True if a pixel of [x0, x1) x [y0, y1) (within one tile) is at or behind nearest, so the box could show through.
+	typedef bool(*RectKernel)(const float* depth, uint32_t stride, int32_t x0, int32_t y0, int32_t x1, int32_t y1, float nearest);
+
+	static void rasterizeTileScalar(const Triangle* triangles, const uint32_t* indices, uint32_t count, int32_t tileX, int32_t tileY, float* depth, uint32_t stride);
+	static void rasterizeTileSse(const Triangle* triangles, const uint32_t* indices, uint32_t count, int32_t tileX, int32_t tileY, float* depth, uint32_t stride);
+	static void rasterizeTileAvx(const Triangle* triangles, const uint32_t* indices, uint32_t count, int32_t tileX, int32_t tileY, float* depth, uint32_t stride);
+
+	static bool testRectScalar(const float* depth, uint32_t stride, int32_t x0, int32_t y0, int32_t x1, int32_t y1, float nearest);
+	static bool testRectSse(const float* depth, uint32_t stride, int32_t x0, int32_t y0, int32_t x1, int32_t y1, float nearest);
+	static bool testRectAvx(const float* depth, uint32_t stride, int32_t x0, int32_t y0, int32_t x1, int32_t y1, float nearest);
+
+	void rasterizeTile(TileKernel kernel, uint32_t tile);
+
+	bool isBoxVisible(RectKernel kernel, const BoundingBoxes& boxes, uint32_t index, const float* viewProjection) const;
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t tileCountX = 0;
+	uint32_t tileCountY = 0;
+
+	std::vector<float> depth;
+	std::vector<float> tileMaxDepth;
+
+	std::vector<Triangle> triangles;
+	std::vector<std::vector<uint32_t>> tileTriangles;
+
+	//addOccluder()'s transformed vertices, kept to reuse the allocation.
+	std::vector<float> clipPositions;
+};
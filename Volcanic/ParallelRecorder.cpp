@@ -0,0 +1,113 @@
+#include "ParallelRecorder.h"
+#include "CpuTracer.h"
+#include "JobSystem.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+
+void ParallelRecorder::init(VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount, uint32_t maxSliceCount){
+
+	this->device = device;
+	this->maxSliceCount = maxSliceCount > 0 ? maxSliceCount : JobSystem::getDefault().getThreadCount();
+
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamilyIndex;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	allocInfo.commandBufferCount = 1;
+
+	commandPools.resize(static_cast<size_t>(frameCount) * this->maxSliceCount);
+	commandBuffers.resize(commandPools.size());
+
+	for (size_t i = 0; i < commandPools.size(); i++) {
+
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPools[i]) != VK_SUCCESS) {
+
+			throw std::runtime_error("Failed to create recording command pool!");
+		}
+
+		allocInfo.commandPool = commandPools[i];
+
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffers[i]) != VK_SUCCESS) {
+
+			throw std::runtime_error("Failed to allocate secondary command buffer!");
+		}
+	}
+}
+
+
+void ParallelRecorder::cleanup(){
+
+	//Destroying a pool frees its command buffers.
+	for (VkCommandPool commandPool : commandPools) {
+		vkDestroyCommandPool(device, commandPool, nullptr);
+	}
+
+	commandPools.clear();
+	commandBuffers.clear();
+	recorded.clear();
+}
+
+
+const std::vector<VkCommandBuffer>& ParallelRecorder::record(uint32_t frame, const VkCommandBufferInheritanceInfo& inheritance, uint32_t drawCount,
+	const RecordFunction& recordSlice){
+
+	TRACE_FUNCTION();
+
+	uint32_t sliceCount = std::clamp(drawCount / MIN_DRAWS_PER_SLICE, 1u, maxSliceCount);
+	recorded.assign(sliceCount, VK_NULL_HANDLE);
+
+	JobSystem::getDefault().parallelFor(sliceCount, 1, [&](uint32_t beginSlice, uint32_t endSlice) {
+
+		for (uint32_t slice = beginSlice; slice < endSlice; slice++) {
+
+			uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * slice / sliceCount);
+			uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * (slice + 1) / sliceCount);
+
+			this->recordSlice(frame, slice, inheritance, begin, end, recordSlice);
+		}
+	});
+
+	return recorded;
+}
+
+
+void ParallelRecorder::recordSlice(uint32_t frame, uint32_t slice, const VkCommandBufferInheritanceInfo& inheritance, uint32_t begin, uint32_t end,
+	const RecordFunction& function){
+
+	TRACE_ZONE("RecordSlice");
+
+	size_t index = static_cast<size_t>(frame) * maxSliceCount + slice;
+	VkCommandBuffer commandBuffer = commandBuffers[index];
+
+	//The frame's previous submission has completed, so everything recorded from this pool can go.
+	vkResetCommandPool(device, commandPools[index], 0);
+
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritance;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to begin recording secondary command buffer!");
+	}
+
+
+	function(commandBuffer, begin, end);
+
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to record secondary command buffer!");
+	}
+
+	recorded[slice] = commandBuffer;
+}
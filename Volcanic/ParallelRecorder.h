@@ -0,0 +1,46 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <functional>
+
+
+//Records a draw list into secondary command buffers on the job system. Every slice of the draws owns one VkCommandPool
+//per frame in flight (pools are externally synchronized, so no two jobs ever share one), resets it when the frame's slot
+//comes around again and records one contiguous range of the draws. The caller executes the returned buffers, in slice
+//order, inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+class ParallelRecorder {
+
+public:
+	//Records draws [begin, end) into an already begun secondary command buffer. Called concurrently, one slice per job.
+	typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end)> RecordFunction;
+
+	//Smaller slices cost more in job handoff and vkCmdExecuteCommands than they save.
+	static constexpr uint32_t MIN_DRAWS_PER_SLICE = 256;
+
+	//maxSliceCount 0 allows one slice per job system thread.
+	void init(VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount, uint32_t maxSliceCount = 0);
+
+	void cleanup();
+
+	//Only call once the frame's previous submission has completed. Rethrows anything recordSlice threw.
+	const std::vector<VkCommandBuffer>& record(uint32_t frame, const VkCommandBufferInheritanceInfo& inheritance, uint32_t drawCount,
+		const RecordFunction& recordSlice);
+
+	uint32_t getMaxSliceCount() const { return maxSliceCount; }
+
+	//Slices the last record() call was split into.
+	uint32_t getSliceCount() const { return static_cast<uint32_t>(recorded.size()); }
+
+private:
+	void recordSlice(uint32_t frame, uint32_t slice, const VkCommandBufferInheritanceInfo& inheritance, uint32_t begin, uint32_t end,
+		const RecordFunction& function);
+
+	VkDevice device = VK_NULL_HANDLE;
+	uint32_t maxSliceCount = 1;
+
+	//[frame * maxSliceCount + slice]
+	std::vector<VkCommandPool> commandPools;
+	std::vector<VkCommandBuffer> commandBuffers;
+
+	std::vector<VkCommandBuffer> recorded;
+};
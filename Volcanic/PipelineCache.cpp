@@ -0,0 +1,291 @@
+#include "PipelineCache.h"
+#include "MappedFile.h"
+#include "Hash.h"
+
+#include <stdexcept>
+#include <fstream>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+
+
+namespace {
+
+	const char MAGIC[4] = { 'V', 'P', 'L', 'C' };
+}
+
+
+void PipelineCache::init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path){
+
+	this->device = device;
+	this->path = path;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	memcpy(deviceHeader.magic, MAGIC, sizeof(MAGIC));
+	deviceHeader.version = VERSION;
+	deviceHeader.vendorID = properties.vendorID;
+	deviceHeader.deviceID = properties.deviceID;
+	deviceHeader.driverVersion = properties.driverVersion;
+	memcpy(deviceHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+
+	MappedFile file;
+	size_t dataSize = 0;
+	bool stale = false;
+	bool hit = false;
+
+	if (path.empty()) {
+		loadResult = "disabled";
+	}
+	else if (!file.open(path)) {
+		loadResult = "miss";
+	}
+	else if (!validate(file.getData(), file.getSize(), deviceHeader, dataSize)) {
+
+		loadResult = "stale";
+		stale = true;
+	}
+	else {
+
+		loadResult = "hit";
+		hit = true;
+	}
+
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	if (dataSize > 0) {
+
+		cacheInfo.initialDataSize = dataSize;
+		cacheInfo.pInitialData = file.getData() + sizeof(Header);
+		loadedBytes = dataSize;
+	}
+
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create pipeline cache!");
+	}
+
+
+	//Drivers may rewrite loaded data, so what they return for it is what later data is compared against.
+	std::vector<char> data;
+
+	if (hit && getData(data)) {
+
+		savedDataSize = data.size();
+		savedDataHash = Hash::xxHash64(data.data(), data.size());
+	}
+
+	//A stale file gets replaced by the first save, even if no pipeline is ever created.
+	dirty = stale;
+	lastSave = std::chrono::steady_clock::now();
+}
+
+
+void PipelineCache::cleanup(){
+
+	if (!save()) {
+		std::cerr << "Failed to write pipeline cache! Filename: " << path << std::endl;
+	}
+
+	vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+}
+
+
+VkResult PipelineCache::createGraphicsPipelines(uint32_t createInfoCount, const VkGraphicsPipelineCreateInfo* createInfos, VkPipeline* pipelines){
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	VkResult result = vkCreateGraphicsPipelines(device, cache, createInfoCount, createInfos, nullptr, pipelines);
+
+	recordCreate(createInfoCount, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+
+	return result;
+}
+
+
+VkResult PipelineCache::createComputePipelines(uint32_t createInfoCount, const VkComputePipelineCreateInfo* createInfos, VkPipeline* pipelines){
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	VkResult result = vkCreateComputePipelines(device, cache, createInfoCount, createInfos, nullptr, pipelines);
+
+	recordCreate(createInfoCount, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+
+	return result;
+}
+
+
+void PipelineCache::recordCreate(uint32_t createInfoCount, double milliseconds){
+
+	if (pipelineCount == 0) {
+		firstCreateMs = milliseconds;
+	}
+
+	totalCreateMs += milliseconds;
+	pipelineCount += createInfoCount;
+	updateDirty();
+}
+
+
+void PipelineCache::update(){
+
+	if (!dirty) {
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+
+	if (std::chrono::duration<double>(now - lastSave).count() >= SAVE_INTERVAL_SECONDS && !save()) {
+		std::cerr << "Failed to write pipeline cache! Filename: " << path << std::endl;
+	}
+}
+
+
+void PipelineCache::updateDirty(){
+
+	if (dirty || path.empty()) {
+		return;
+	}
+
+
+	//Pipelines found in the cache (such as every one of a warm launch) leave its data as it was saved.
+	size_t dataSize = 0;
+
+	if (vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS || dataSize != savedDataSize) {
+
+		dirty = true;
+		return;
+	}
+
+	std::vector<char> data;
+
+	dirty = !getData(data) || Hash::xxHash64(data.data(), data.size()) != savedDataHash;
+}
+
+
+bool PipelineCache::getData(std::vector<char>& data) const{
+
+	size_t dataSize = 0;
+
+	if (vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS) {
+		return false;
+	}
+
+	data.resize(dataSize);
+
+	if (vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS) {
+		return false;
+	}
+
+	//The data may have shrunk between the calls.
+	data.resize(dataSize);
+
+	return true;
+}
+
+
+bool PipelineCache::save(){
+
+	if (!dirty || path.empty() || cache == VK_NULL_HANDLE) {
+		return true;
+	}
+
+	lastSave = std::chrono::steady_clock::now();
+
+
+	std::vector<char> data;
+
+	if (!getData(data)) {
+		return false;
+	}
+
+
+	Header header = deviceHeader;
+	header.dataSize = data.size();
+	header.dataHash = Hash::xxHash64(data.data(), data.size());
+
+
+	std::string tempPath = path + ".tmp";
+	std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+
+	if (!out.is_open()) {
+		return false;
+	}
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	out.write(data.data(), data.size());
+	out.close();
+
+	if (out.fail()) {
+
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	if (!replaceFile(tempPath, path)) {
+		return false;
+	}
+
+
+	dirty = false;
+	savedDataSize = header.dataSize;
+	savedDataHash = header.dataHash;
+	saveCount++;
+
+	return true;
+}
+
+
+bool PipelineCache::validate(const char* fileData, size_t fileSize, const Header& expected, size_t& dataSize) const{
+
+	if (fileSize < sizeof(Header)) {
+		return false;
+	}
+
+	Header header;
+	memcpy(&header, fileData, sizeof(Header));
+
+	bool valid = memcmp(header.magic, expected.magic, sizeof(MAGIC)) == 0 && header.version == expected.version;
+	valid = valid && header.vendorID == expected.vendorID && header.deviceID == expected.deviceID && header.driverVersion == expected.driverVersion;
+	valid = valid && memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	valid = valid && header.dataSize == fileSize - sizeof(Header);
+
+	if (!valid) {
+		return false;
+	}
+
+
+	const char* data = fileData + sizeof(Header);
+
+	if (Hash::xxHash64(data, header.dataSize) != header.dataHash) {
+		return false;
+	}
+
+
+	//Drivers are supposed to reject foreign data themselves, but some crash instead, so check their header too.
+	DriverHeader driverHeader;
+
+	if (header.dataSize < sizeof(DriverHeader)) {
+		return false;
+	}
+
+	memcpy(&driverHeader, data, sizeof(DriverHeader));
+
+	valid = driverHeader.headerSize >= sizeof(DriverHeader) && driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+	valid = valid && driverHeader.vendorID == expected.vendorID && driverHeader.deviceID == expected.deviceID;
+	valid = valid && memcmp(driverHeader.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+	if (!valid) {
+		return false;
+	}
+
+	dataSize = static_cast<size_t>(header.dataSize);
+
+	return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+
+//A VkPipelineCache persisted in a file, so pipelines compiled by an earlier launch (or before a resize) are reused.
+//The file carries the device's vendor & device ID, driver version and pipelineCacheUUID, plus an XXH64 of the driver's
+//data; a cache from another GPU or driver, or a damaged one, is discarded instead of being handed to the driver.
+//Saving writes a temporary file that replaces the old one, so a crash never leaves a truncated cache behind.
+class PipelineCache {
+
+public:
+	//Dirty caches are saved by update() at most this often, so new pipelines survive a crash.
+	static constexpr double SAVE_INTERVAL_SECONDS = 30.0;
+
+	//An empty path keeps the cache in memory only.
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path);
+
+	//Saves (if dirty) and destroys the cache.
+	void cleanup();
+
+	//Compiles through the cache and records how long it took.
+	VkResult createGraphicsPipelines(uint32_t createInfoCount, const VkGraphicsPipelineCreateInfo* createInfos, VkPipeline* pipelines);
+
+	VkResult createComputePipelines(uint32_t createInfoCount, const VkComputePipelineCreateInfo* createInfos, VkPipeline* pipelines);
+
+	//Saves if created pipelines changed the driver's data since the last save and SAVE_INTERVAL_SECONDS have passed.
+	//Call once per frame.
+	void update();
+
+	//Returns false if the file can't be written. Does nothing while the cache is clean.
+	bool save();
+
+	VkPipelineCache getHandle() const { return cache; }
+
+	//"hit" if the driver's data was loaded from the file, "miss" if there was no file, "stale" if it belonged to another
+	//device or driver (or was damaged), "disabled" without a path.
+	const char* getLoadResult() const { return loadResult; }
+
+	uint64_t getLoadedBytes() const { return loadedBytes; }
+
+	uint32_t getPipelineCount() const { return pipelineCount; }
+
+	//Time spent creating pipelines: the first call (cold on a miss, warm on a hit) and all of them.
+	double getFirstCreateMilliseconds() const { return firstCreateMs; }
+
+	double getTotalCreateMilliseconds() const { return totalCreateMs; }
+
+	uint32_t getSaveCount() const { return saveCount; }
+
+private:
+	static const uint32_t VERSION = 1;
+
+	struct Header {
+
+		char magic[4];
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+		uint64_t dataHash;
+	};
+
+	//The header every driver puts in front of its cache data (VkPipelineCacheHeaderVersionOne).
+	struct DriverHeader {
+
+		uint32_t headerSize;
+		uint32_t headerVersion;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	};
+
+	//True if the file was written for this device & driver and is intact. dataSize is the size of the driver's data,
+	//which follows the header.
+	bool validate(const char* fileData, size_t fileSize, const Header& expected, size_t& dataSize) const;
+
+	void recordCreate(uint32_t createInfoCount, double milliseconds);
+
+	//Marks the cache dirty if the driver's data no longer matches what was saved.
+	void updateDirty();
+
+	//Copies the driver's current cache data.
+	bool getData(std::vector<char>& data) const;
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	std::string path;
+	Header deviceHeader{};
+
+	//Set once the driver's data differs from the saved blob's size or hash.
+	bool dirty = false;
+	uint64_t savedDataSize = 0;
+	uint64_t savedDataHash = 0;
+	std::chrono::steady_clock::time_point lastSave;
+	const char* loadResult = "disabled";
+	uint64_t loadedBytes = 0;
+	uint32_t pipelineCount = 0;
+	uint32_t saveCount = 0;
+	double firstCreateMs = 0.0;
+	double totalCreateMs = 0.0;
+};
@@ -0,0 +1,60 @@
+#include "Scene.h"
+#include "CpuTracer.h"
+
+#include <algorithm>
+
+
+uint32_t Scene::addInstance(uint32_t mesh, const InstanceTransform& transform){
+
+	meshes.push_back(mesh);
+	transforms.push_back(transform);
+
+	return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+
+void Scene::clear(){
+
+	meshes.clear();
+	transforms.clear();
+	sortedTransforms.clear();
+	batches.clear();
+}
+
+
+void Scene::build(){
+
+	TRACE_FUNCTION();
+
+	batches.clear();
+	sortedTransforms.resize(transforms.size());
+
+	if (meshes.empty()) {
+		return;
+	}
+
+
+	//Counting sort by mesh: mesh indices are small and dense, and it keeps instances of a mesh in the order they were added.
+	uint32_t meshCount = *std::max_element(meshes.begin(), meshes.end()) + 1;
+	std::vector<uint32_t> firstInstances(meshCount + 1, 0);
+
+	for (uint32_t mesh : meshes) {
+		firstInstances[mesh + 1]++;
+	}
+
+	for (uint32_t mesh = 0; mesh < meshCount; mesh++) {
+
+		if (firstInstances[mesh + 1] > 0) {
+			batches.push_back({ mesh, firstInstances[mesh], firstInstances[mesh + 1] });
+		}
+
+		firstInstances[mesh + 1] += firstInstances[mesh];
+	}
+
+
+	std::vector<uint32_t> cursors(firstInstances.begin(), firstInstances.end() - 1);
+
+	for (size_t i = 0; i < meshes.size(); i++) {
+		sortedTransforms[cursors[meshes[i]]++] = transforms[i];
+	}
+}
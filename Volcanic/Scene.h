@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+
+//Object-to-world transform of one instance: the first three rows of its 4x4 matrix (the last row is always 0, 0, 0, 1).
+//This is also the per-instance vertex stream, read as three vec4 attributes.
+struct InstanceTransform {
+
+	float rows[3][4];
+};
+
+//Consecutive instances of one mesh, drawn by a single instanced draw call.
+struct InstanceBatch {
+
+	uint32_t mesh;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
+
+
+//Mesh instances grouped by mesh. Instances can be added in any order; build() sorts them into one contiguous range per
+//mesh (keeping their relative order), so the scene costs one draw call per mesh instead of one per object.
+class Scene {
+
+public:
+	//Returns the instance's index in the order it was added (not its position after build()).
+	uint32_t addInstance(uint32_t mesh, const InstanceTransform& transform);
+
+	void clear();
+
+	//Groups the instances by mesh into getTransforms() & getBatches().
+	void build();
+
+	uint32_t getInstanceCount() const { return static_cast<uint32_t>(meshes.size()); }
+
+	//In batch order, valid after build().
+	const std::vector<InstanceTransform>& getTransforms() const { return sortedTransforms; }
+
+	const std::vector<InstanceBatch>& getBatches() const { return batches; }
+
+private:
+	std::vector<uint32_t> meshes;
+	std::vector<InstanceTransform> transforms;
+
+	std::vector<InstanceTransform> sortedTransforms;
+	std::vector<InstanceBatch> batches;
+};
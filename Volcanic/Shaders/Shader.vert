@@ -10,17 +10,25 @@ layout(binding = 0) uniform UniformBufferObject {
 } ubo;
 
 
+//Packed positions arrive in [-1, 1]; the model matrix scales them back to the model's bounds.
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
+//Per instance: the rows of the object-to-world transform (the last row is 0, 0, 0, 1).
+layout(location = 3) in vec4 inInstanceRow0;
+layout(location = 4) in vec4 inInstanceRow1;
+layout(location = 5) in vec4 inInstanceRow2;
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 
 void main() {
 
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
+    vec4 localPosition = ubo.model * vec4(inPosition, 1.0);
+    vec4 worldPosition = vec4(dot(inInstanceRow0, localPosition), dot(inInstanceRow1, localPosition), dot(inInstanceRow2, localPosition), 1.0);
+
+    gl_Position = ubo.proj * ubo.view * worldPosition;
+    fragColor = vec3(1.0);
     fragTexCoord = inTexCoord;
 }
\ No newline at end of file
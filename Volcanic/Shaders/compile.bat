@@ -1,3 +1,6 @@
 C:/VulkanSDK/1.1.101.0/Bin32/glslc.exe shader.vert -o vert.spv
 C:/VulkanSDK/1.1.101.0/Bin32/glslc.exe shader.frag -o frag.spv
+C:/VulkanSDK/1.1.101.0/Bin32/glslc.exe cull.comp -o cull.spv
+C:/VulkanSDK/1.1.101.0/Bin32/glslc.exe depthpyramid.comp -o depthpyramid.spv
+C:/VulkanSDK/1.1.101.0/Bin32/glslc.exe clustercull.comp -o clustercull.spv
 pause
\ No newline at end of file
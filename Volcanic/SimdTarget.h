@@ -0,0 +1,18 @@
+#pragma once
+
+//x86 SIMD intrinsics for the kernels that pick SSE or AVX at runtime (see FrustumCuller::isSupported()).
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VOLCANIC_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(VOLCANIC_SIMD_X86)
+#include <intrin.h>
+#endif
+
+//MSVC compiles any intrinsic in any function; GCC & Clang need AVX functions marked, since the build targets plain x86-64.
+#if defined(__GNUC__) || defined(__clang__)
+#define VOLCANIC_TARGET_AVX __attribute__((target("avx")))
+#else
+#define VOLCANIC_TARGET_AVX
+#endif
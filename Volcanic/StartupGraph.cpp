@@ -0,0 +1,205 @@
+#include "StartupGraph.h"
+#include "CpuTracer.h"
+
+#include <stdexcept>
+#include <iomanip>
+
+
+StartupGraph::TaskId StartupGraph::add(const char* name, Thread thread, std::function<void()> function, std::initializer_list<TaskId> dependencies){
+
+	TaskId id = static_cast<TaskId>(tasks.size());
+
+	for (TaskId dependency : dependencies) {
+
+		if (dependency >= id) {
+			throw std::runtime_error(std::string("Startup task depends on a later task! Task: ") + name);
+		}
+
+		if (thread == Thread::Worker && tasks[dependency]->thread == Thread::Main) {
+			throw std::runtime_error(std::string("Worker startup task depends on a main thread task! Task: ") + name);
+		}
+	}
+
+
+	auto task = std::make_unique<Task>();
+	task->name = name;
+	task->thread = thread;
+	task->function = std::move(function);
+	task->dependencies.assign(dependencies.begin(), dependencies.end());
+
+	tasks.push_back(std::move(task));
+
+	return id;
+}
+
+
+void StartupGraph::run(bool parallel, std::chrono::high_resolution_clock::time_point origin){
+
+	TRACE_FUNCTION();
+
+	this->origin = origin;
+
+	if (!parallel) {
+
+		for (auto& task : tasks) {
+
+			execute(*task);
+
+			if (task->error) {
+				std::rethrow_exception(task->error);
+			}
+		}
+
+		return;
+	}
+
+
+	JobSystem& jobs = JobSystem::getDefault();
+
+	//Spawn every worker task up front, each behind its first dependency; it waits for the rest (running other jobs
+	//meanwhile) once that one is done. Startup graphs are small and mostly flat, so that wait is rare.
+	for (auto& task : tasks) {
+
+		if (task->thread != Thread::Worker) {
+			continue;
+		}
+
+		Task* worker = task.get();
+
+		auto function = [this, worker, &jobs]() {
+
+			for (TaskId dependency : worker->dependencies) {
+				jobs.wait(tasks[dependency]->done);
+			}
+
+			execute(*worker);
+		};
+
+		if (worker->dependencies.empty()) {
+			jobs.spawn(function, &worker->done);
+		}
+		else {
+			jobs.spawnAfter(tasks[worker->dependencies.front()]->done, function, &worker->done);
+		}
+	}
+
+
+	for (auto& task : tasks) {
+
+		if (task->thread != Thread::Main) {
+			continue;
+		}
+
+		double waitStart = getElapsedMs();
+
+		for (TaskId dependency : task->dependencies) {
+			jobs.wait(tasks[dependency]->done);
+		}
+
+		task->waitMs = getElapsedMs() - waitStart;
+
+		execute(*task);
+
+		if (task->error) {
+
+			waitForWorkers();
+			std::rethrow_exception(task->error);
+		}
+	}
+
+
+	//Worker tasks nothing depended on still have to finish (and report their errors).
+	waitForWorkers();
+
+	for (auto& task : tasks) {
+
+		if (task->error) {
+			std::rethrow_exception(task->error);
+		}
+	}
+}
+
+
+void StartupGraph::execute(Task& task){
+
+	for (TaskId dependency : task.dependencies) {
+
+		if (tasks[dependency]->error) {
+
+			task.error = tasks[dependency]->error;
+			return;
+		}
+	}
+
+
+	TRACE_ZONE(task.name);
+
+	task.startMs = getElapsedMs();
+
+	try {
+		task.function();
+	}
+	catch (...) {
+		task.error = std::current_exception();
+	}
+
+	task.endMs = getElapsedMs();
+}
+
+
+double StartupGraph::getElapsedMs() const{
+
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - origin).count();
+}
+
+
+void StartupGraph::waitForWorkers(){
+
+	JobSystem& jobs = JobSystem::getDefault();
+
+	for (auto& task : tasks) {
+
+		if (task->thread == Thread::Worker) {
+			jobs.wait(task->done);
+		}
+	}
+}
+
+
+void StartupGraph::writeJson(std::ostream& out) const{
+
+	out << "[";
+
+	for (size_t i = 0; i < tasks.size(); i++) {
+
+		const Task& task = *tasks[i];
+
+		out << (i > 0 ? "," : "") << "{\"name\":\"" << task.name << "\",\"thread\":\"" << (task.thread == Thread::Main ? "main" : "worker") << "\"";
+		out << ",\"startMs\":" << task.startMs << ",\"endMs\":" << task.endMs << ",\"waitMs\":" << task.waitMs << "}";
+	}
+
+	out << "]";
+}
+
+
+void StartupGraph::print(std::ostream& out) const{
+
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(1);
+
+	for (const auto& task : tasks) {
+
+		out << "  " << std::left << std::setw(24) << task->name << (task->thread == Thread::Main ? "main   " : "worker ")
+			<< std::right << std::setw(8) << task->startMs << " ms +" << std::setw(7) << task->endMs - task->startMs << " ms";
+
+		if (!task->dependencies.empty() && task->thread == Thread::Main) {
+			out << " (waited " << task->waitMs << " ms)";
+		}
+
+		out << std::endl;
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
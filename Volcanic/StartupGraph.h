@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <chrono>
+#include <ostream>
+#include <initializer_list>
+#include <cstdint>
+
+#include "JobSystem.h"
+
+
+//Startup expressed as tasks and the tasks they depend on. Worker tasks (file reads, decoding, parsing) are spawned on
+//the job system as soon as their dependencies have finished; main tasks (anything touching the Vulkan device, window
+//or uploader) run on the calling thread in the order they were added, each waiting only for the worker tasks it
+//names. Every task's start, end and wait time is recorded for the time-to-first-frame breakdown.
+class StartupGraph {
+
+public:
+	enum class Thread { Main, Worker };
+
+	typedef uint32_t TaskId;
+
+	//Dependencies must have been added before. Worker tasks can only depend on other worker tasks; main tasks already
+	//run after every main task added before them.
+	TaskId add(const char* name, Thread thread, std::function<void()> function, std::initializer_list<TaskId> dependencies = {});
+
+	//Runs every task and returns once all of them have finished. Times are measured from origin. Serial runs every
+	//task on the calling thread in the order they were added (for comparison). The first exception thrown by any
+	//task is rethrown, after every worker task has stopped.
+	void run(bool parallel, std::chrono::high_resolution_clock::time_point origin);
+
+	//[{"name":..., "thread":"main"|"worker", "startMs":..., "endMs":..., "waitMs":...}, ...]
+	void writeJson(std::ostream& out) const;
+
+	//One line per task: name, start & duration, and how long the main thread waited for its dependencies.
+	void print(std::ostream& out) const;
+
+private:
+	struct Task {
+
+		const char* name;
+		Thread thread;
+		std::function<void()> function;
+		std::vector<TaskId> dependencies;
+
+		//Main tasks only: time spent waiting for worker dependencies before starting.
+		double waitMs = 0.0;
+		double startMs = 0.0;
+		double endMs = 0.0;
+
+		JobCounter done;
+		std::exception_ptr error;
+	};
+
+	//Runs the task unless a dependency failed, in which case it inherits that error instead.
+	void execute(Task& task);
+
+	double getElapsedMs() const;
+
+	//Worker tasks may still be running after a main task threw; this keeps them from outliving the graph.
+	void waitForWorkers();
+
+	std::vector<std::unique_ptr<Task>> tasks;
+	std::chrono::high_resolution_clock::time_point origin;
+};
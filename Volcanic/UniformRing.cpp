@@ -0,0 +1,31 @@
+#include "UniformRing.h"
+
+#include <stdexcept>
+#include <cstring>
+
+
+void UniformRing::init(VkBuffer buffer, void* mappedData, VkDeviceSize capacity, VkDeviceSize minOffsetAlignment){
+
+	this->buffer = buffer;
+	this->mappedData = static_cast<char*>(mappedData);
+	this->capacity = capacity;
+	this->alignment = minOffsetAlignment > 0 ? minOffsetAlignment : 1;
+	this->head = 0;
+}
+
+
+uint32_t UniformRing::push(const void* data, VkDeviceSize size){
+
+	//Dynamic offsets must be multiples of minUniformBufferOffsetAlignment.
+	VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+
+	if (offset + size > capacity) {
+		throw std::runtime_error("Uniform ring overflow!");
+	}
+
+
+	memcpy(mappedData + offset, data, static_cast<size_t>(size));
+	head = offset + size;
+
+	return static_cast<uint32_t>(offset);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+
+//Linear bump allocator over a persistently mapped, host-coherent uniform buffer. There is one ring per frame in flight,
+//reset once that frame's fence has signalled. Every push returns the dynamic offset to bind the data with
+//(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC), so per-draw constants need neither map calls nor descriptor updates.
+class UniformRing {
+
+public:
+	void init(VkBuffer buffer, void* mappedData, VkDeviceSize capacity, VkDeviceSize minOffsetAlignment);
+
+	void reset() { head = 0; }
+
+	//Copies the data into the ring and returns its dynamic offset. Throws if the ring is full.
+	uint32_t push(const void* data, VkDeviceSize size);
+
+	template<typename T>
+	uint32_t push(const T& value) { return push(&value, sizeof(T)); }
+
+	VkBuffer getBuffer() const { return buffer; }
+
+	VkDeviceSize getUsedBytes() const { return head; }
+
+	VkDeviceSize getCapacity() const { return capacity; }
+
+private:
+	VkBuffer buffer = VK_NULL_HANDLE;
+	char* mappedData = nullptr;
+	VkDeviceSize capacity = 0;
+	VkDeviceSize alignment = 1;
+	VkDeviceSize head = 0;
+};
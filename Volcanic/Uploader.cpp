@@ -0,0 +1,483 @@
+#include "Uploader.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+
+namespace {
+
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+
+void Uploader::init(VkDevice device, VkPhysicalDevice physicalDevice, GpuAllocator* allocator, VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily, VkDeviceSize arenaSize){
+
+	this->device = device;
+	this->allocator = allocator;
+	this->transferQueue = transferQueue;
+	this->transferFamily = transferFamily;
+	this->graphicsFamily = graphicsFamily;
+
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = transferFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create upload command pool!");
+	}
+
+
+	//Buffer-to-image copies need offsets that are a multiple of 4 and of the texel size; 16 covers every colour format.
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	copyOffsetAlignment = std::max<VkDeviceSize>(16, deviceProperties.limits.optimalBufferCopyOffsetAlignment);
+
+
+	arena = createStagingBuffer(arenaSize);
+	arenaCapacity = arenaSize;
+}
+
+
+void Uploader::cleanup(){
+
+	if (batching) {
+		submitBatch();
+	}
+
+	waitAll();
+
+
+	destroyStagingBuffer(arena);
+
+
+	for (auto fence : freeFences) {
+		vkDestroyFence(device, fence, nullptr);
+	}
+
+	freeFences.clear();
+	pendingAcquires.clear();
+
+
+	vkDestroyCommandPool(device, commandPool, nullptr);
+}
+
+
+Uploader::StagingBuffer Uploader::createStagingBuffer(VkDeviceSize size){
+
+	StagingBuffer stagingBuffer{};
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &stagingBuffer.buffer) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to create staging buffer!");
+	}
+
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, stagingBuffer.buffer, &memRequirements);
+
+	uint32_t memoryType = allocator->findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	stagingBuffer.allocation = allocator->allocate(memRequirements, memoryType, GpuAllocator::ResourceType::Linear);
+
+	vkBindBufferMemory(device, stagingBuffer.buffer, stagingBuffer.allocation.memory, stagingBuffer.allocation.offset);
+
+
+	return stagingBuffer;
+}
+
+
+void Uploader::destroyStagingBuffer(StagingBuffer& stagingBuffer){
+
+	vkDestroyBuffer(device, stagingBuffer.buffer, nullptr);
+	allocator->free(stagingBuffer.allocation);
+
+	stagingBuffer.buffer = VK_NULL_HANDLE;
+}
+
+
+void Uploader::beginBatch(){
+
+	batching = true;
+
+
+	//The arena can only be rewritten once the previous batch that read from it has completed.
+	if (arenaTicket > completedTicket) {
+		wait(arenaTicket);
+	}
+
+	arenaHead = 0;
+}
+
+
+uint64_t Uploader::submitBatch(){
+
+	batching = false;
+
+	if (recording.commandBuffer == VK_NULL_HANDLE) {
+		return 0;
+	}
+
+	return submitRecording();
+}
+
+
+VkCommandBuffer Uploader::getRecordingCommandBuffer(){
+
+	if (recording.commandBuffer != VK_NULL_HANDLE) {
+		return recording.commandBuffer;
+	}
+
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = commandPool;
+	allocInfo.commandBufferCount = 1;
+
+
+	if (vkAllocateCommandBuffers(device, &allocInfo, &recording.commandBuffer) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to allocate upload command buffer!");
+	}
+
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(recording.commandBuffer, &beginInfo);
+
+
+	return recording.commandBuffer;
+}
+
+
+void Uploader::stage(const void* data, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset){
+
+	if (batching && size <= arenaCapacity) {
+
+		offset = alignUp(arenaHead, copyOffsetAlignment);
+
+
+		//Arena full: send what has been recorded so far and reuse the arena once it has been consumed.
+		if (offset + size > arenaCapacity) {
+
+			wait(submitRecording());
+			offset = 0;
+		}
+
+
+		memcpy(static_cast<char*>(arena.allocation.mappedData) + offset, data, static_cast<size_t>(size));
+
+		buffer = arena.buffer;
+		arenaHead = offset + size;
+		arenaTicket = nextTicket;
+
+		return;
+	}
+
+
+	StagingBuffer stagingBuffer = createStagingBuffer(size);
+
+	memcpy(stagingBuffer.allocation.mappedData, data, static_cast<size_t>(size));
+
+	recording.stagingBuffers.push_back(stagingBuffer);
+
+	buffer = stagingBuffer.buffer;
+	offset = 0;
+}
+
+
+uint64_t Uploader::submitRecording(){
+
+	VkCommandBuffer commandBuffer = recording.commandBuffer;
+
+	vkEndCommandBuffer(commandBuffer);
+
+
+	if (freeFences.empty()) {
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+
+		if (vkCreateFence(device, &fenceInfo, nullptr, &recording.fence) != VK_SUCCESS) {
+
+			throw std::runtime_error("Failed to create upload fence!");
+		}
+	}
+	else {
+
+		recording.fence = freeFences.back();
+		freeFences.pop_back();
+	}
+
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+
+	if (vkQueueSubmit(transferQueue, 1, &submitInfo, recording.fence) != VK_SUCCESS) {
+
+		throw std::runtime_error("Failed to submit upload command buffer!");
+	}
+
+
+	recording.ticket = nextTicket++;
+	submitCount++;
+
+	submissions.push_back(std::move(recording));
+	recording = Submission{};
+
+	return submissions.back().ticket;
+}
+
+
+uint64_t Uploader::finishUpload(PendingAcquire& acquire){
+
+	uploadCount++;
+
+
+	//Inside a batch every upload shares the ticket the batch will be submitted with.
+	acquire.ticket = batching ? nextTicket : submitRecording();
+
+	pendingAcquires.push_back(acquire);
+
+	return acquire.ticket;
+}
+
+
+uint64_t Uploader::uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess){
+
+	VkBuffer stagingBuffer;
+	VkDeviceSize stagingOffset;
+	stage(data, size, stagingBuffer, stagingOffset);
+
+	VkCommandBuffer commandBuffer = getRecordingCommandBuffer();
+
+
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = stagingOffset;
+	copyRegion.size = size;
+
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, dstBuffer, 1, &copyRegion);
+
+
+	PendingAcquire acquire{};
+	acquire.dstStage = dstStage;
+	acquire.bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	acquire.bufferBarrier.srcAccessMask = 0;
+	acquire.bufferBarrier.dstAccessMask = dstAccess;
+	acquire.bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	acquire.bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	acquire.bufferBarrier.buffer = dstBuffer;
+	acquire.bufferBarrier.offset = 0;
+	acquire.bufferBarrier.size = VK_WHOLE_SIZE;
+
+
+	//Release to the graphics family. The matching acquire must name the same families.
+	if (usesDedicatedQueue()) {
+
+		VkBufferMemoryBarrier release = acquire.bufferBarrier;
+		release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		release.dstAccessMask = 0;
+		release.srcQueueFamilyIndex = transferFamily;
+		release.dstQueueFamilyIndex = graphicsFamily;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &release, 0, nullptr);
+
+		acquire.bufferBarrier.srcQueueFamilyIndex = transferFamily;
+		acquire.bufferBarrier.dstQueueFamilyIndex = graphicsFamily;
+	}
+
+
+	return finishUpload(acquire);
+}
+
+
+uint64_t Uploader::uploadImage(VkImage dstImage, const void* data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t mipLevels,
+	VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess){
+
+	VkBuffer stagingBuffer;
+	VkDeviceSize stagingOffset;
+	stage(data, size, stagingBuffer, stagingOffset);
+
+	VkCommandBuffer commandBuffer = getRecordingCommandBuffer();
+
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = dstImage;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipLevels;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = stagingOffset;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { width, height, 1 };
+
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+
+	//The layout transition happens in the release barrier. With a queue family ownership transfer the acquire
+	//must repeat the same layouts; without one the image already is in finalLayout when the graphics queue sees it.
+	VkImageMemoryBarrier release = barrier;
+	release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	release.newLayout = finalLayout;
+	release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	release.dstAccessMask = 0;
+
+	PendingAcquire acquire{};
+	acquire.dstStage = dstStage;
+	acquire.isImage = true;
+	acquire.imageBarrier = release;
+	acquire.imageBarrier.srcAccessMask = 0;
+	acquire.imageBarrier.dstAccessMask = dstAccess;
+
+	if (usesDedicatedQueue()) {
+
+		release.srcQueueFamilyIndex = transferFamily;
+		release.dstQueueFamilyIndex = graphicsFamily;
+
+		acquire.imageBarrier.srcQueueFamilyIndex = transferFamily;
+		acquire.imageBarrier.dstQueueFamilyIndex = graphicsFamily;
+	}
+	else {
+
+		acquire.imageBarrier.oldLayout = finalLayout;
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &release);
+
+
+	return finishUpload(acquire);
+}
+
+
+void Uploader::retire(Submission& submission){
+
+	for (auto& stagingBuffer : submission.stagingBuffers) {
+		destroyStagingBuffer(stagingBuffer);
+	}
+
+	vkFreeCommandBuffers(device, commandPool, 1, &submission.commandBuffer);
+
+	vkResetFences(device, 1, &submission.fence);
+	freeFences.push_back(submission.fence);
+
+	completedTicket = submission.ticket;
+}
+
+
+void Uploader::poll(){
+
+	while (!submissions.empty() && vkGetFenceStatus(device, submissions.front().fence) == VK_SUCCESS) {
+
+		retire(submissions.front());
+		submissions.pop_front();
+	}
+}
+
+
+bool Uploader::isComplete(uint64_t ticket){
+
+	if (ticket > completedTicket) {
+		poll();
+	}
+
+	return ticket <= completedTicket;
+}
+
+
+void Uploader::wait(uint64_t ticket){
+
+	while (ticket > completedTicket && !submissions.empty()) {
+
+		vkWaitForFences(device, 1, &submissions.front().fence, VK_TRUE, UINT64_MAX);
+		poll();
+	}
+}
+
+
+void Uploader::recordAcquireBarriers(VkCommandBuffer graphicsCommandBuffer){
+
+	if (pendingAcquires.empty()) {
+		return;
+	}
+
+	poll();
+
+
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	VkPipelineStageFlags dstStages = 0;
+
+	for (const auto& acquire : pendingAcquires) {
+
+		if (acquire.ticket > completedTicket) {
+			continue;
+		}
+
+		if (acquire.isImage) {
+			imageBarriers.push_back(acquire.imageBarrier);
+		}
+		else {
+			bufferBarriers.push_back(acquire.bufferBarrier);
+		}
+
+		dstStages |= acquire.dstStage;
+	}
+
+
+	if (bufferBarriers.empty() && imageBarriers.empty()) {
+		return;
+	}
+
+
+	//The transfer queue's work is already complete (its fence signalled), so no source stage needs to be waited on here.
+	vkCmdPipelineBarrier(graphicsCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStages, 0, 0, nullptr,
+		static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+
+	uint64_t completed = completedTicket;
+
+	pendingAcquires.erase(std::remove_if(pendingAcquires.begin(), pendingAcquires.end(), [completed](const PendingAcquire& acquire) { return acquire.ticket <= completed; }), pendingAcquires.end());
+
+	acquiredTicket = completedTicket;
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+
+#include "GpuAllocator.h"
+
+
+//Uploads buffer and image data on a (preferably dedicated) transfer queue. Each submission has its own fence and
+//is identified by a ticket, so the CPU never idles the queue. When the transfer family differs from the graphics family,
+//ownership is released on the transfer queue and acquired on the graphics queue by recordAcquireBarriers().
+//
+//Between beginBatch() and submitBatch() uploads are packed into a persistently mapped staging arena and recorded into
+//a single command buffer, so loading many assets costs one submit and one fence instead of one per upload.
+//Not thread-safe: call from the thread that records graphics command buffers.
+class Uploader {
+
+public:
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, GpuAllocator* allocator, VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily,
+		VkDeviceSize arenaSize = 32ull * 1024 * 1024);
+
+	void cleanup();
+
+	void beginBatch();
+
+	//Submits everything recorded since beginBatch(). Returns the batch's ticket (0 if nothing was recorded).
+	uint64_t submitBatch();
+
+	bool isBatching() const { return batching; }
+
+	//Copies the data into staging memory and records the copy. The destination is usable on the graphics queue
+	//at dstStage/dstAccess once isReady(ticket) returns true. Inside a batch the returned ticket is the batch's.
+	uint64_t uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+	//Copies the data into mip level 0. Every mip level leaves the transfer queue in finalLayout.
+	uint64_t uploadImage(VkImage dstImage, const void* data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t mipLevels,
+		VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+	//Non-blocking: true once the transfer queue has finished the upload.
+	bool isComplete(uint64_t ticket);
+
+	//True once the upload's acquire barrier has been recorded into a graphics command buffer.
+	bool isReady(uint64_t ticket) const { return ticket <= acquiredTicket; }
+
+	//Blocks on the upload's fence (not the whole queue).
+	void wait(uint64_t ticket);
+
+	void waitAll() { wait(nextTicket - 1); }
+
+	//Records the graphics-side acquire barriers of every completed upload that hasn't been acquired yet.
+	//Cheap when nothing is pending, so it can be called at the start of every frame.
+	void recordAcquireBarriers(VkCommandBuffer graphicsCommandBuffer);
+
+	bool usesDedicatedQueue() const { return transferFamily != graphicsFamily; }
+
+	uint32_t getSubmitCount() const { return submitCount; }
+
+	uint32_t getUploadCount() const { return uploadCount; }
+
+private:
+	struct StagingBuffer {
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		GpuAllocation allocation;
+	};
+
+	struct Submission {
+
+		uint64_t ticket = 0;
+		VkFence fence = VK_NULL_HANDLE;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+		//Uploads that didn't go through the arena (outside a batch, or larger than the whole arena).
+		std::vector<StagingBuffer> stagingBuffers;
+	};
+
+	struct PendingAcquire {
+
+		uint64_t ticket = 0;
+		VkPipelineStageFlags dstStage = 0;
+		bool isImage = false;
+		VkBufferMemoryBarrier bufferBarrier{};
+		VkImageMemoryBarrier imageBarrier{};
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	GpuAllocator* allocator = nullptr;
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	uint32_t transferFamily = 0;
+	uint32_t graphicsFamily = 0;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+
+	uint64_t nextTicket = 1;
+	uint64_t completedTicket = 0;
+	uint64_t acquiredTicket = 0;
+	uint32_t submitCount = 0;
+	uint32_t uploadCount = 0;
+
+	//In submission order; the transfer queue completes them in the same order.
+	std::deque<Submission> submissions;
+	std::vector<PendingAcquire> pendingAcquires;
+
+	//Fences of retired submissions, reused to avoid creating one per upload.
+	std::vector<VkFence> freeFences;
+
+	//Bump-allocated staging memory shared by every upload of a batch. Reset once the last batch using it has completed.
+	StagingBuffer arena;
+	VkDeviceSize arenaCapacity = 0;
+	VkDeviceSize arenaHead = 0;
+	uint64_t arenaTicket = 0;
+	VkDeviceSize copyOffsetAlignment = 16;
+
+	bool batching = false;
+	Submission recording;
+
+	StagingBuffer createStagingBuffer(VkDeviceSize size);
+
+	void destroyStagingBuffer(StagingBuffer& stagingBuffer);
+
+	//Returns the command buffer to record the next upload into, beginning one if needed.
+	VkCommandBuffer getRecordingCommandBuffer();
+
+	//Copies the data into staging memory for the recording submission and returns the buffer & offset to copy from.
+	void stage(const void* data, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset);
+
+	//Submits the recording command buffer and returns its ticket.
+	uint64_t submitRecording();
+
+	//Ends the upload: outside a batch the recording is submitted right away.
+	uint64_t finishUpload(PendingAcquire& acquire);
+
+	//Retires every submission whose fence has signalled and frees its staging memory.
+	void poll();
+
+	void retire(Submission& submission);
+};
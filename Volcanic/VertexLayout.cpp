@@ -0,0 +1,139 @@
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+VertexQuantization VertexQuantization::fromPositions(const char* positions, size_t stride, size_t count){
+
+	VertexQuantization quantization;
+
+	if (count == 0) {
+		return quantization;
+	}
+
+
+	float minimum[3], maximum[3];
+	memcpy(minimum, positions, sizeof(minimum));
+	memcpy(maximum, positions, sizeof(maximum));
+
+	for (size_t v = 1; v < count; v++) {
+
+		float position[3];
+		memcpy(position, positions + v * stride, sizeof(position));
+
+		for (int i = 0; i < 3; i++) {
+
+			minimum[i] = std::min(minimum[i], position[i]);
+			maximum[i] = std::max(maximum[i], position[i]);
+		}
+	}
+
+
+	for (int i = 0; i < 3; i++) {
+
+		quantization.positionOffset[i] = 0.5f * (minimum[i] + maximum[i]);
+
+		//Flat axes keep a scale of 1, so encoding never divides by zero.
+		float halfExtent = 0.5f * (maximum[i] - minimum[i]);
+		quantization.positionScale[i] = halfExtent > 0.0f ? halfExtent : 1.0f;
+	}
+
+	return quantization;
+}
+
+
+uint16_t VertexEncoding::floatToHalf(float value){
+
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000u;
+	uint32_t exponent = (bits >> 23) & 0xFFu;
+	uint32_t mantissa = bits & 0x7FFFFFu;
+
+
+	//Infinity & NaN (keeping NaNs quiet).
+	if (exponent == 0xFFu) {
+		return static_cast<uint16_t>(sign | 0x7C00u | (mantissa != 0 ? 0x200u : 0u));
+	}
+
+	int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+
+	if (halfExponent >= 31) {
+		return static_cast<uint16_t>(sign | 0x7C00u);
+	}
+
+
+	//Denormals: shift the implicit bit into the mantissa. Values below half the smallest denormal flush to zero.
+	if (halfExponent <= 0) {
+
+		if (halfExponent < -10) {
+			return static_cast<uint16_t>(sign);
+		}
+
+		mantissa |= 0x800000u;
+		uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+
+		//Round to nearest even.
+		if (remainder > halfway || (remainder == halfway && (half & 1u))) {
+			half++;
+		}
+
+		return static_cast<uint16_t>(sign | half);
+	}
+
+
+	uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFFu;
+
+	//Round to nearest even; a carry out of the mantissa correctly bumps the exponent (up to infinity).
+	if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+		half++;
+	}
+
+	return static_cast<uint16_t>(sign | half);
+}
+
+
+int16_t VertexEncoding::floatToSnorm16(float value){
+
+	return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+
+uint16_t VertexEncoding::floatToUnorm16(float value){
+
+	return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+
+void VertexEncoding::OctahedralSnorm16x2::encode(const float* value){
+
+	float length = std::abs(value[0]) + std::abs(value[1]) + std::abs(value[2]);
+
+	if (length == 0.0f) {
+
+		data = { 0, 0 };
+		return;
+	}
+
+
+	float x = value[0] / length;
+	float y = value[1] / length;
+
+	//The lower hemisphere folds over the diagonals onto the outer triangles of the square.
+	if (value[2] < 0.0f) {
+
+		float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+
+		x = foldedX;
+		y = foldedY;
+	}
+
+	data = { floatToSnorm16(x), floatToSnorm16(y) };
+}
@@ -0,0 +1,241 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+
+enum class VertexSemantic { Position, Normal, TexCoord, Color, Count };
+
+
+//Full-precision values of one vertex, indexed by VertexSemantic (positions, normals & colors have 3 floats, texture
+//coordinates 2). Semantics the layout doesn't store may be null.
+struct VertexAttributeValues {
+
+	const float* values[static_cast<size_t>(VertexSemantic::Count)] = {};
+
+	const float* operator[](VertexSemantic semantic) const { return values[static_cast<size_t>(semantic)]; }
+};
+
+
+//Maps positions into [-1, 1] for normalized position encodings: encoded = (position - offset) / scale.
+//The inverse (translate(offset) * scale(scale)) is folded into the model matrix, so shaders need no changes.
+struct VertexQuantization {
+
+	float positionOffset[3] = { 0.0f, 0.0f, 0.0f };
+	float positionScale[3] = { 1.0f, 1.0f, 1.0f };
+
+	//Fits the bounding box of count positions (stride bytes apart).
+	static VertexQuantization fromPositions(const char* positions, size_t stride, size_t count);
+};
+
+
+//Attribute encodings: the bytes one attribute occupies in the vertex buffer and the format the input assembler decodes
+//them with. Encodings with four components pad the fourth, since three-component 16-bit formats are rarely supported.
+struct VertexEncoding {
+
+	static uint16_t floatToHalf(float value);
+
+	static int16_t floatToSnorm16(float value);
+
+	static uint16_t floatToUnorm16(float value);
+
+
+	struct Float32x2 {
+
+		static constexpr VkFormat FORMAT = VK_FORMAT_R32G32_SFLOAT;
+		static constexpr bool NORMALIZED = false;
+		typedef float Component;
+		std::array<float, 2> data;
+
+		void encode(const float* value) { data = { value[0], value[1] }; }
+	};
+
+	struct Float32x3 {
+
+		static constexpr VkFormat FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+		static constexpr bool NORMALIZED = false;
+		typedef float Component;
+		std::array<float, 3> data;
+
+		void encode(const float* value) { data = { value[0], value[1], value[2] }; }
+	};
+
+	struct Float16x2 {
+
+		static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_SFLOAT;
+		static constexpr bool NORMALIZED = false;
+		typedef uint16_t Component;
+		std::array<uint16_t, 2> data;
+
+		void encode(const float* value) { data = { floatToHalf(value[0]), floatToHalf(value[1]) }; }
+	};
+
+	struct Float16x4 {
+
+		static constexpr VkFormat FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+		static constexpr bool NORMALIZED = false;
+		typedef uint16_t Component;
+		std::array<uint16_t, 4> data;
+
+		void encode(const float* value) { data = { floatToHalf(value[0]), floatToHalf(value[1]), floatToHalf(value[2]), 0 }; }
+	};
+
+	//Positions are mapped through VertexQuantization first.
+	struct Snorm16x4 {
+
+		static constexpr VkFormat FORMAT = VK_FORMAT_R16G16B16A16_SNORM;
+		static constexpr bool NORMALIZED = true;
+		typedef int16_t Component;
+		std::array<int16_t, 4> data;
+
+		void encode(const float* value) { data = { floatToSnorm16(value[0]), floatToSnorm16(value[1]), floatToSnorm16(value[2]), 0 }; }
+	};
+
+	//Values are clamped to [0, 1], so only for texture coordinates that don't wrap.
+	struct Unorm16x2 {
+
+		static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_UNORM;
+		static constexpr bool NORMALIZED = false;
+		typedef uint16_t Component;
+		std::array<uint16_t, 2> data;
+
+		void encode(const float* value) { data = { floatToUnorm16(value[0]), floatToUnorm16(value[1]) }; }
+	};
+
+	//Unit vectors projected onto an octahedron and unfolded into a square (Cigolle et al. 2014). The shader decodes with
+	//n = vec3(e.xy, 1 - |e.x| - |e.y|); if (n.z < 0) n.xy = (1 - abs(n.yx)) * sign(n.xy); n = normalize(n).
+	struct OctahedralSnorm16x2 {
+
+		static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_SNORM;
+		static constexpr bool NORMALIZED = false;
+		typedef int16_t Component;
+		std::array<int16_t, 2> data;
+
+		void encode(const float* value);
+	};
+};
+
+
+template<VertexSemantic Semantic, uint32_t Location, typename Encoding>
+struct VertexAttribute {
+
+	static constexpr VertexSemantic SEMANTIC = Semantic;
+	static constexpr uint32_t LOCATION = Location;
+	typedef Encoding EncodingType;
+};
+
+
+//A packed vertex described by a list of VertexAttributes. Offsets, stride and the Vulkan input descriptions are all
+//derived at compile time, e.g.
+//	typedef VertexLayout<VertexAttribute<VertexSemantic::Position, 0, VertexEncoding::Snorm16x4>,
+//		VertexAttribute<VertexSemantic::TexCoord, 2, VertexEncoding::Unorm16x2>> CompactVertex;
+//is a 12 byte vertex. Attributes are stored in the listed order, so list larger components first.
+template<typename... Attributes>
+struct VertexLayout {
+
+	static constexpr size_t ATTRIBUTE_COUNT = sizeof...(Attributes);
+	static constexpr uint32_t STRIDE = (0 + ... + static_cast<uint32_t>(sizeof(typename Attributes::EncodingType)));
+
+	unsigned char bytes[STRIDE];
+
+
+	static constexpr std::array<uint32_t, ATTRIBUTE_COUNT> getOffsets() {
+
+		std::array<uint32_t, ATTRIBUTE_COUNT> offsets{};
+		uint32_t sizes[] = { static_cast<uint32_t>(sizeof(typename Attributes::EncodingType))... };
+		uint32_t offset = 0;
+
+		for (size_t i = 0; i < ATTRIBUTE_COUNT; i++) {
+
+			offsets[i] = offset;
+			offset += sizes[i];
+		}
+
+		return offsets;
+	}
+
+	//The input assembler expects every attribute to be aligned to its component size.
+	static constexpr bool isAligned() {
+
+		std::array<uint32_t, ATTRIBUTE_COUNT> offsets = getOffsets();
+		uint32_t componentSizes[] = { static_cast<uint32_t>(sizeof(typename Attributes::EncodingType::Component))... };
+		bool aligned = true;
+
+		for (size_t i = 0; i < ATTRIBUTE_COUNT; i++) {
+			aligned = aligned && offsets[i] % componentSizes[i] == 0 && STRIDE % componentSizes[i] == 0;
+		}
+
+		return aligned;
+	}
+
+	static_assert(isAligned(), "Vertex attributes must be aligned to their component size; list larger components first.");
+
+
+	//Whether positions go through VertexQuantization (and the model matrix has to undo it).
+	static constexpr bool QUANTIZED_POSITIONS = (false || ... || (Attributes::SEMANTIC == VertexSemantic::Position && Attributes::EncodingType::NORMALIZED));
+
+
+	static VkVertexInputBindingDescription getBindingDescription(uint32_t binding = 0) {
+
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = binding;
+		bindingDescription.stride = STRIDE;
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescription;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT> getAttributeDescriptions(uint32_t binding = 0) {
+
+		std::array<uint32_t, ATTRIBUTE_COUNT> offsets = getOffsets();
+		uint32_t locations[] = { Attributes::LOCATION... };
+		VkFormat formats[] = { Attributes::EncodingType::FORMAT... };
+
+		std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT> attributeDescriptions{};
+
+		for (size_t i = 0; i < ATTRIBUTE_COUNT; i++) {
+
+			attributeDescriptions[i].binding = binding;
+			attributeDescriptions[i].location = locations[i];
+			attributeDescriptions[i].format = formats[i];
+			attributeDescriptions[i].offset = offsets[i];
+		}
+
+		return attributeDescriptions;
+	}
+
+
+	static VertexLayout encode(const VertexAttributeValues& values, const VertexQuantization& quantization) {
+
+		VertexLayout vertex;
+		std::array<uint32_t, ATTRIBUTE_COUNT> offsets = getOffsets();
+		size_t attributeIndex = 0;
+
+		(encodeAttribute<Attributes>(values, quantization, vertex.bytes + offsets[attributeIndex++]), ...);
+
+		return vertex;
+	}
+
+private:
+	template<typename Attribute>
+	static void encodeAttribute(const VertexAttributeValues& values, const VertexQuantization& quantization, unsigned char* destination) {
+
+		const float* value = values[Attribute::SEMANTIC];
+		float quantized[3];
+
+		if (Attribute::SEMANTIC == VertexSemantic::Position && Attribute::EncodingType::NORMALIZED) {
+
+			for (int i = 0; i < 3; i++) {
+				quantized[i] = (value[i] - quantization.positionOffset[i]) / quantization.positionScale[i];
+			}
+
+			value = quantized;
+		}
+
+		typename Attribute::EncodingType encoded;
+		encoded.encode(value);
+
+		memcpy(destination, encoded.data.data(), sizeof(encoded.data));
+	}
+};
@@ -0,0 +1,202 @@
+#include "VertexWelder.h"
+#include "Hash.h"
+#include "JobSystem.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+
+VertexWelder::VertexWelder(uint32_t threadCount){
+
+	if (threadCount == 0) {
+		threadCount = JobSystem::getDefault().getThreadCount();
+	}
+
+	this->threadCount = std::max(threadCount, 1u);
+}
+
+
+template<typename Function>
+void VertexWelder::parallelFor(uint32_t taskCount, Function function){
+
+	//With one task per job at minimum, every task becomes its own job unless there are more tasks than the system splits into.
+	JobSystem::getDefault().parallelFor(taskCount, 1, [&function](uint32_t begin, uint32_t end) {
+
+		for (uint32_t task = begin; task < end; task++) {
+			function(task);
+		}
+	});
+}
+
+
+void VertexWelder::weld(const void* corners, size_t cornerCount, size_t vertexSize, std::vector<uint32_t>& firstCorners, std::vector<uint32_t>& indices){
+
+	if (cornerCount >= EMPTY_SLOT) {
+
+		throw std::runtime_error("Too many vertices to weld with 32-bit indices!");
+	}
+
+
+	const char* vertexData = static_cast<const char*>(corners);
+
+	firstCorners.clear();
+	indices.resize(cornerCount);
+
+	if (cornerCount == 0) {
+		return;
+	}
+
+
+	//Every task hashes one contiguous chunk of corners and later welds one hash partition.
+	uint32_t taskCount = static_cast<uint32_t>(std::min<size_t>(threadCount, std::max<size_t>(cornerCount / MIN_CORNERS_PER_THREAD, 1)));
+	size_t chunkSize = (cornerCount + taskCount - 1) / taskCount;
+
+	auto partitionOf = [taskCount](uint64_t h) { return static_cast<uint32_t>(((h >> 32) * taskCount) >> 32); };
+
+
+	std::vector<uint64_t> hashes(cornerCount);
+	std::vector<size_t> scatterOffsets(static_cast<size_t>(taskCount) * taskCount, 0);
+
+	parallelFor(taskCount, [&](uint32_t chunk) {
+
+		size_t begin = chunk * chunkSize;
+		size_t end = std::min(begin + chunkSize, cornerCount);
+		size_t* counts = &scatterOffsets[static_cast<size_t>(chunk) * taskCount];
+
+		for (size_t c = begin; c < end; c++) {
+
+			hashes[c] = Hash::xxHash64(vertexData + c * vertexSize, vertexSize);
+			counts[partitionOf(hashes[c])]++;
+		}
+	});
+
+
+	//Partition-major prefix sum: each partition becomes one contiguous run, with its corners still in input order.
+	std::vector<size_t> partitionStarts(taskCount + 1);
+	size_t offset = 0;
+
+	for (uint32_t partition = 0; partition < taskCount; partition++) {
+
+		partitionStarts[partition] = offset;
+
+		for (uint32_t chunk = 0; chunk < taskCount; chunk++) {
+
+			size_t count = scatterOffsets[static_cast<size_t>(chunk) * taskCount + partition];
+			scatterOffsets[static_cast<size_t>(chunk) * taskCount + partition] = offset;
+			offset += count;
+		}
+	}
+
+	partitionStarts[taskCount] = offset;
+
+
+	std::vector<uint32_t> order(cornerCount);
+
+	parallelFor(taskCount, [&](uint32_t chunk) {
+
+		size_t begin = chunk * chunkSize;
+		size_t end = std::min(begin + chunkSize, cornerCount);
+		size_t* offsets = &scatterOffsets[static_cast<size_t>(chunk) * taskCount];
+
+		for (size_t c = begin; c < end; c++) {
+			order[offsets[partitionOf(hashes[c])]++] = static_cast<uint32_t>(c);
+		}
+	});
+
+
+	//Equal vertices always share a partition, so each one is welded independently. indices temporarily holds the
+	//corner each corner is a duplicate of (itself for first occurrences).
+	parallelFor(taskCount, [&](uint32_t partition) {
+
+		size_t begin = partitionStarts[partition];
+		size_t end = partitionStarts[partition + 1];
+
+		//At most half full, so probe sequences stay short.
+		size_t tableSize = 16;
+
+		while (tableSize < (end - begin) * 2) {
+			tableSize *= 2;
+		}
+
+		size_t mask = tableSize - 1;
+		std::vector<Slot> table(tableSize, Slot{ EMPTY_SLOT, 0 });
+
+
+		for (size_t i = begin; i < end; i++) {
+
+			uint32_t c = order[i];
+			uint64_t h = hashes[c];
+			uint32_t tag = static_cast<uint32_t>(h >> 32);
+			const char* vertex = vertexData + c * vertexSize;
+
+			for (size_t slot = h & mask;; slot = (slot + 1) & mask) {
+
+				Slot& entry = table[slot];
+
+				if (entry.corner == EMPTY_SLOT) {
+
+					entry = Slot{ c, tag };
+					indices[c] = c;
+					break;
+				}
+
+				if (entry.hashTag == tag && memcmp(vertexData + entry.corner * vertexSize, vertex, vertexSize) == 0) {
+
+					indices[c] = entry.corner;
+					break;
+				}
+			}
+		}
+	});
+
+
+	//Number the first occurrences in corner order. order is reused to map a first corner to its vertex index.
+	std::vector<size_t> chunkBases(taskCount + 1, 0);
+
+	parallelFor(taskCount, [&](uint32_t chunk) {
+
+		size_t begin = chunk * chunkSize;
+		size_t end = std::min(begin + chunkSize, cornerCount);
+		size_t count = 0;
+
+		for (size_t c = begin; c < end; c++) {
+			count += indices[c] == c;
+		}
+
+		chunkBases[chunk + 1] = count;
+	});
+
+	for (uint32_t chunk = 0; chunk < taskCount; chunk++) {
+		chunkBases[chunk + 1] += chunkBases[chunk];
+	}
+
+	firstCorners.resize(chunkBases[taskCount]);
+
+
+	parallelFor(taskCount, [&](uint32_t chunk) {
+
+		size_t begin = chunk * chunkSize;
+		size_t end = std::min(begin + chunkSize, cornerCount);
+		size_t next = chunkBases[chunk];
+
+		for (size_t c = begin; c < end; c++) {
+
+			if (indices[c] == c) {
+
+				firstCorners[next] = static_cast<uint32_t>(c);
+				order[c] = static_cast<uint32_t>(next++);
+			}
+		}
+	});
+
+	parallelFor(taskCount, [&](uint32_t chunk) {
+
+		size_t begin = chunk * chunkSize;
+		size_t end = std::min(begin + chunkSize, cornerCount);
+
+		for (size_t c = begin; c < end; c++) {
+			indices[c] = order[indices[c]];
+		}
+	});
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+
+//Merges bitwise-identical vertices. Corners are hashed (XXH64) in parallel, bucketed by the top bits of their hash and every
+//bucket is welded by its own job in a flat open-addressing table, so no locks are needed. Unique vertices keep the
+//order of their first occurrence, which makes the result identical to a serial hash map pass keyed on the vertex bytes.
+//Unlike float comparison, that keeps -0.0 apart from 0.0 and matches equal NaNs.
+class VertexWelder {
+
+public:
+	//threadCount 0 picks one task per job system thread (fewer for small meshes).
+	explicit VertexWelder(uint32_t threadCount = 0);
+
+	//The vertex type is compared and hashed as raw bytes, so it must not contain padding.
+	template<typename T>
+	void weld(const std::vector<T>& corners, std::vector<T>& uniqueVertices, std::vector<uint32_t>& indices) {
+
+		static_assert(std::is_trivially_copyable<T>::value, "VertexWelder compares vertices as raw bytes");
+
+		std::vector<uint32_t> firstCorners;
+
+		weld(corners.data(), corners.size(), sizeof(T), firstCorners, indices);
+
+
+		uniqueVertices.resize(firstCorners.size());
+
+		for (size_t i = 0; i < firstCorners.size(); i++) {
+			uniqueVertices[i] = corners[firstCorners[i]];
+		}
+	}
+
+	//Byte-level version: writes one index per corner and, for every unique vertex, the corner it was first seen at.
+	void weld(const void* corners, size_t cornerCount, size_t vertexSize, std::vector<uint32_t>& firstCorners, std::vector<uint32_t>& indices);
+
+	uint32_t getThreadCount() const { return threadCount; }
+
+private:
+	//Below this many corners per thread, splitting the work costs more than it saves.
+	static const size_t MIN_CORNERS_PER_THREAD = 32 * 1024;
+
+	static const uint32_t EMPTY_SLOT = ~0u;
+
+	uint32_t threadCount = 1;
+
+	//Table slots hold the corner index and the high hash bits, so most mismatches are rejected without touching the vertex.
+	struct Slot {
+
+		uint32_t corner;
+		uint32_t hashTag;
+	};
+
+	template<typename Function>
+	static void parallelFor(uint32_t taskCount, Function function);
+};